@@ -3,13 +3,53 @@
 #include <cstdlib>
 #include <pthread.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <android/log.h>
 
 #include "node.h"
+#include "rn-allocator.h"
 #include "rn-bridge.h"
+#include "rn-log.h"
+#include "rn-pool.h"
+#include "rn-recorder.h"
+#include "rn-runtime.h"
+#include "rn-threads.h"
+
+// cache the environment variable for the threads running node to call into java.
+// Each Node environment runs on its own thread, attached to the VM separately.
+thread_local JNIEnv* cacheEnvPointer=NULL;
+
+// The Java VM and the module's class and methods, to call into Java from the
+// threads started natively. Threads attached to the VM can't look up the
+// application's classes, so it's done when the library is loaded.
+JavaVM* cachedJavaVM=NULL;
+jclass moduleClass=NULL;
+jmethodID sendMessageToApplicationMethod=NULL;
+jmethodID onNodeStoppedMethod=NULL;
+
+// Detaches the threads attached by rcv_message, like Node's worker threads,
+// when they exit.
+pthread_key_t detachThreadKey;
 
-// cache the environment variable for the thread running node to call into java
-JNIEnv* cacheEnvPointer=NULL;
+extern "C"
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    JNIEnv* env;
+    if (vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    cachedJavaVM = vm;
+    jclass cls = env->FindClass("com/janeasystems/rn_nodejs_mobile/RNNodeJsMobileModule");
+    if (cls == nullptr) {
+        return JNI_ERR;
+    }
+    moduleClass = (jclass)env->NewGlobalRef(cls);
+    env->DeleteLocalRef(cls);
+    sendMessageToApplicationMethod = env->GetStaticMethodID(moduleClass, "sendMessageToApplication", "(Ljava/lang/String;Ljava/lang/String;)V");
+    onNodeStoppedMethod = env->GetStaticMethodID(moduleClass, "onNodeStopped", "()V");
+    pthread_key_create(&detachThreadKey, [](void*) { cachedJavaVM->DetachCurrentThread(); });
+    return JNI_VERSION_1_6;
+}
 
 extern "C"
 JNIEXPORT void JNICALL
@@ -25,12 +65,109 @@ Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_sendMessageToNodeC
     env->ReleaseStringUTFChars(msg,nativeMessage);
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setNodeChannelLatencyBudget(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring channelName,
+        jint budgetMs) {
+    const char* nativeChannelName = env->GetStringUTFChars(channelName, 0);
+    rn_bridge_set_latency_budget(nativeChannelName, (uint32_t)budgetMs);
+    env->ReleaseStringUTFChars(channelName,nativeChannelName);
+}
+
 extern "C" int callintoNode(int argc, char *argv[])
 {
-    const int exit_code = node::Start(argc,argv);
+    const int exit_code = rn_runtime_start(argc,argv);
     return exit_code;
 }
 
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_stopNodeRuntime(
+        JNIEnv *env,
+        jobject /* this */) {
+    return jboolean(rn_runtime_stop());
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_configureBackgroundMode(
+        JNIEnv *env,
+        jobject /* this */,
+        jboolean enabled,
+        jboolean collectGarbage,
+        jint coalescingMs) {
+    rn_runtime_configure_background_mode(enabled, collectGarbage, coalescingMs);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setBackgroundMode(
+        JNIEnv *env,
+        jobject /* this */,
+        jboolean background) {
+    return jboolean(rn_runtime_set_background(background));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_notifyMemoryPressure(
+        JNIEnv *env,
+        jclass /* clazz */,
+        jint level) {
+    return jboolean(rn_runtime_memory_pressure((RNMemoryPressureLevel)level));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setStreamEntryScript(
+        JNIEnv *env,
+        jobject /* this */,
+        jboolean enabled) {
+    rn_runtime_set_stream_entry_script(enabled);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setPlatformWorkerThreads(
+        JNIEnv *env,
+        jobject /* this */,
+        jint count) {
+    rn_runtime_set_platform_worker_threads(count);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setUvThreadpoolSize(
+        JNIEnv *env,
+        jobject /* this */,
+        jint size) {
+    rn_runtime_set_uv_threadpool_size(size);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_configureFlightRecorder(
+        JNIEnv *env,
+        jobject /* this */,
+        jboolean enabled,
+        jint sizeKb,
+        jint payloadBytes) {
+    return jboolean(rn_recorder_configure(enabled, (size_t)sizeKb * 1024, (size_t)payloadBytes));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_configureArrayBufferAllocator(
+        JNIEnv *env,
+        jobject /* this */,
+        jboolean pooled,
+        jint limitMb) {
+    rn_allocator_configure(pooled, limitMb > 0 ? (size_t)limitMb * 1024 * 1024 : 0);
+}
+
 #if defined(__arm__)
     #define CURRENT_ABI_NAME "armeabi-v7a"
 #elif defined(__aarch64__)
@@ -47,7 +184,7 @@ extern "C"
 JNIEXPORT jstring JNICALL
 Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_getCurrentABIName(
     JNIEnv *env,
-    jobject /* this */) {
+    jclass /* clazz */) {
     return env->NewStringUTF(CURRENT_ABI_NAME);
 }
 
@@ -55,66 +192,161 @@ extern "C"
 JNIEXPORT void JNICALL
 Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_registerNodeDataDirPath(
     JNIEnv *env,
-    jobject /* this */,
+    jclass /* clazz */,
     jstring dataDir) {
   const char* nativeDataDir = env->GetStringUTFChars(dataDir, 0);
   rn_register_node_data_dir_path(nativeDataDir);
   env->ReleaseStringUTFChars(dataDir, nativeDataDir);
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_registerStartupSnapshot(
+    JNIEnv *env,
+    jclass /* clazz */,
+    jstring blobPath,
+    jstring projectPath) {
+  const char* nativeBlobPath = env->GetStringUTFChars(blobPath, 0);
+  const char* nativeProjectPath = env->GetStringUTFChars(projectPath, 0);
+  rn_runtime_set_startup_snapshot(nativeBlobPath, nativeProjectPath);
+  env->ReleaseStringUTFChars(blobPath, nativeBlobPath);
+  env->ReleaseStringUTFChars(projectPath, nativeProjectPath);
+}
+
 #define APPNAME "RNBRIDGE"
 
 void rcv_message(const char* channel_name, const char* msg) {
   JNIEnv *env=cacheEnvPointer;
-  if(!env) return;
-  jclass cls2 = env->FindClass("com/janeasystems/rn_nodejs_mobile/RNNodeJsMobileModule");  // try to find the class
-  if(cls2 != nullptr) {
-    jmethodID m_sendMessage = env->GetStaticMethodID(cls2, "sendMessageToApplication", "(Ljava/lang/String;Ljava/lang/String;)V");  // find method
-    if(m_sendMessage != nullptr) {
-        jstring java_channel_name=env->NewStringUTF(channel_name);
-        jstring java_msg=env->NewStringUTF(msg);
-        env->CallStaticVoidMethod(cls2, m_sendMessage, java_channel_name, java_msg);                      // call method
-        env->DeleteLocalRef(java_channel_name);
-        env->DeleteLocalRef(java_msg);
+  if(!env && cachedJavaVM) {
+    // A thread started by Node itself, like a worker thread. It stays
+    // attached until it exits.
+    if (cachedJavaVM->AttachCurrentThread(&env, NULL) == JNI_OK) {
+      cacheEnvPointer = env;
+      pthread_setspecific(detachThreadKey, env);
     }
   }
-  env->DeleteLocalRef(cls2);
+  if(!env || !sendMessageToApplicationMethod) return;
+  jstring java_channel_name=env->NewStringUTF(channel_name);
+  jstring java_msg=env->NewStringUTF(msg);
+  env->CallStaticVoidMethod(moduleClass, sendMessageToApplicationMethod, java_channel_name, java_msg);
+  env->DeleteLocalRef(java_channel_name);
+  env->DeleteLocalRef(java_msg);
+}
+
+// Attaches the Node thread to the Java VM, so the bridge can call into Java.
+void attach_node_thread() {
+    JNIEnv* env = NULL;
+    if (cachedJavaVM->AttachCurrentThread(&env, NULL) == JNI_OK) {
+        cacheEnvPointer = env;
+    }
+}
+
+// Tells Java the runtime has exited and been freed, so it can be started
+// again, and detaches the Node thread from the Java VM.
+void detach_node_thread() {
+    JNIEnv* env = cacheEnvPointer;
+    if (env) {
+        env->CallStaticVoidMethod(moduleClass, onNodeStoppedMethod);
+        cacheEnvPointer = NULL;
+        cachedJavaVM->DetachCurrentThread();
+    }
+}
+
+// Arguments of the Node thread. libuv needs them in contiguous memory, which
+// isn't freed as it may be kept for the process title.
+struct NodeThreadArgs {
+    int argc;
+    char** argv;
+};
+
+void *node_thread_func(void* arg) {
+    NodeThreadArgs* node_args = (NodeThreadArgs*)arg;
+    attach_node_thread();
+    callintoNode(node_args->argc, node_args->argv);
+    delete node_args;
+    detach_node_thread();
+    return 0;
+}
+
+void *prewarm_thread_func(void*) {
+    attach_node_thread();
+    rn_runtime_prewarm();
+    detach_node_thread();
+    return 0;
+}
+
+// Arguments of the thread of a named environment.
+struct EnvironmentThreadArgs {
+    std::string name;
+    int argc;
+    char** argv;
+};
+
+// Runs a named environment. Its exit is reported to the application on the
+// environment's system channel, as the main runtime's onNodeStopped doesn't
+// apply to it.
+void *environment_thread_func(void* arg) {
+    EnvironmentThreadArgs* env_args = (EnvironmentThreadArgs*)arg;
+    attach_node_thread();
+    int exit_code = rn_runtime_start_environment(env_args->name.c_str(), env_args->argc, env_args->argv);
+    std::string system_channel = env_args->name + RN_BRIDGE_NAMESPACE_SEPARATOR "_SYSTEM_";
+    rcv_message(system_channel.c_str(), ("exit|" + std::to_string(exit_code)).c_str());
+    delete env_args;
+    if (cacheEnvPointer) {
+        cacheEnvPointer = NULL;
+        cachedJavaVM->DetachCurrentThread();
+    }
+    return 0;
 }
 
 // Start threads to redirect stdout and stderr to logcat.
 int pipe_stdout[2];
 int pipe_stderr[2];
-pthread_t thread_stdout;
-pthread_t thread_stderr;
 const char *ADBTAG = "NODEJS-MOBILE";
 
-void *thread_stderr_func(void*) {
-    ssize_t redirect_size;
-    char buf[2048];
-    while((redirect_size = read(pipe_stderr[0], buf, sizeof buf - 1)) > 0) {
-        //__android_log will add a new line anyway.
-        if(buf[redirect_size - 1] == '\n')
-            --redirect_size;
-        buf[redirect_size] = 0;
-        __android_log_write(ANDROID_LOG_ERROR, ADBTAG, buf);
+// Node's output is buffered here while logcat is slow to take it, up to
+// this size per stream, and then dropped rather than blocking Node.
+const size_t kLogBufferSize = 256 * 1024;
+const uint32_t kLogLinesPerSecond = 1000;
+const uint32_t kLogBurstLines = 5000;
+RNLogForwarder* logForwarder = NULL;
+int stdoutStream = 0;
+int stderrStream = 0;
+
+void logcat_sink(const RNLogRecord* records, size_t count, void*) {
+    for (size_t i = 0; i < count; i++) {
+        __android_log_write(records[i].level, ADBTAG, records[i].message);
+        rn_recorder_log(records[i].level, records[i].message, records[i].length);
     }
+}
+
+void *thread_stderr_func(void*) {
+    rn_log_read_fd(logForwarder, stderrStream, pipe_stderr[0]);
     return 0;
 }
 
 void *thread_stdout_func(void*) {
-    ssize_t redirect_size;
-    char buf[2048];
-    while((redirect_size = read(pipe_stdout[0], buf, sizeof buf - 1)) > 0) {
-        //__android_log will add a new line anyway.
-        if(buf[redirect_size - 1] == '\n')
-            --redirect_size;
-        buf[redirect_size] = 0;
-        __android_log_write(ANDROID_LOG_INFO, ADBTAG, buf);
-    }
+    rn_log_read_fd(logForwarder, stdoutStream, pipe_stdout[0]);
+    return 0;
+}
+
+void *thread_log_writer_func(void*) {
+    rn_log_run(logForwarder);
     return 0;
 }
 
 int start_redirecting_stdout_stderr() {
+    // The redirection outlives the runtime, so it is set up only once even
+    // when node is restarted.
+    static bool redirecting = false;
+    if (redirecting)
+        return 0;
+    redirecting = true;
+
+    logForwarder = rn_log_create(logcat_sink, NULL, kLogLinesPerSecond, kLogBurstLines);
+    stdoutStream = rn_log_add_stream(logForwarder, RN_LOG_INFO, kLogBufferSize);
+    stderrStream = rn_log_add_stream(logForwarder, RN_LOG_ERROR, kLogBufferSize);
+
     //set stdout as unbuffered.
     setvbuf(stdout, 0, _IONBF, 0);
     pipe(pipe_stdout);
@@ -125,46 +357,43 @@ int start_redirecting_stdout_stderr() {
     pipe(pipe_stderr);    
     dup2(pipe_stderr[1], STDERR_FILENO);
 
-    if(pthread_create(&thread_stdout, 0, thread_stdout_func, 0) == -1)
+#ifdef F_SETPIPE_SZ
+    // Absorbs bursts written faster than the pipes are read. Best effort,
+    // as the system limits the size.
+    fcntl(pipe_stdout[1], F_SETPIPE_SZ, 1024 * 1024);
+    fcntl(pipe_stderr[1], F_SETPIPE_SZ, 1024 * 1024);
+#endif
+
+    if(rn_thread_start(RN_THREAD_ROLE_LOG_FORWARDING, RN_THREAD_LOG_WRITER, thread_log_writer_func, 0) != 0)
+        return -1;
+
+    if(rn_thread_start(RN_THREAD_ROLE_LOG_FORWARDING, RN_THREAD_STDOUT, thread_stdout_func, 0) != 0)
         return -1;
-    pthread_detach(thread_stdout);
 
-    if(pthread_create(&thread_stderr, 0, thread_stderr_func, 0) == -1)
+    if(rn_thread_start(RN_THREAD_ROLE_LOG_FORWARDING, RN_THREAD_STDERR, thread_stderr_func, 0) != 0)
         return -1;
-    pthread_detach(thread_stderr);
 
     return 0;
 }
 
 //node's libUV requires all arguments being on contiguous memory.
-extern "C" jint JNICALL
-Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeWithArguments(
-        JNIEnv *env,
-        jobject /* this */,
-        jobjectArray arguments,
-        jstring modulesPath,
-        jboolean option_redirectOutputToLogcat) {
-
-    //Set the builtin_modules path to NODE_PATH.
-    const char* path_path = env->GetStringUTFChars(modulesPath, 0);
-    setenv("NODE_PATH", path_path, 1);
-    env->ReleaseStringUTFChars(modulesPath, path_path);
-
-    //argc
+char** copy_arguments(JNIEnv *env, jobjectArray arguments, int* argc) {
     jsize argument_count = env->GetArrayLength(arguments);
 
     //Compute byte size need for all arguments in contiguous memory.
     int c_arguments_size = 0;
     for (int i = 0; i < argument_count ; i++) {
-        c_arguments_size += strlen(env->GetStringUTFChars((jstring)env->GetObjectArrayElement(arguments, i), 0));
+        jstring argument = (jstring)env->GetObjectArrayElement(arguments, i);
+        c_arguments_size += env->GetStringUTFLength(argument);
         c_arguments_size++; // for '\0'
+        env->DeleteLocalRef(argument);
     }
 
     //Stores arguments in contiguous memory.
     char* args_buffer=(char*)calloc(c_arguments_size, sizeof(char));
 
-    //argv to pass into node.
-    char* argv[argument_count];
+    //argv to pass into node, used by the Node thread.
+    char** argv=(char**)calloc(argument_count + 1, sizeof(char*));
 
     //To iterate through the expected start position of each argument in args_buffer.
     char* current_args_position=args_buffer;
@@ -172,7 +401,8 @@ Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeWithArgum
     //Populate the args_buffer and argv.
     for (int i = 0; i < argument_count ; i++)
     {
-        const char* current_argument = env->GetStringUTFChars((jstring)env->GetObjectArrayElement(arguments, i), 0);
+        jstring argument = (jstring)env->GetObjectArrayElement(arguments, i);
+        const char* current_argument = env->GetStringUTFChars(argument, 0);
 
         //Copy current argument to its expected position in args_buffer
         strncpy(current_args_position, current_argument, strlen(current_argument));
@@ -182,11 +412,33 @@ Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeWithArgum
 
         //Increment to the next argument's expected position.
         current_args_position += strlen(current_args_position)+1;
+
+        env->ReleaseStringUTFChars(argument, current_argument);
+        env->DeleteLocalRef(argument);
     }
 
-    rn_register_bridge_cb(&rcv_message);
+    *argc = argument_count;
+    return argv;
+}
 
-    cacheEnvPointer=env;
+extern "C" jint JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeWithArguments(
+        JNIEnv *env,
+        jobject /* this */,
+        jobjectArray arguments,
+        jstring modulesPath,
+        jboolean option_redirectOutputToLogcat) {
+
+    //Set the builtin_modules path to NODE_PATH.
+    const char* path_path = env->GetStringUTFChars(modulesPath, 0);
+    setenv("NODE_PATH", path_path, 1);
+    env->ReleaseStringUTFChars(modulesPath, path_path);
+
+    //argc and argv
+    int argument_count = 0;
+    char** argv = copy_arguments(env, arguments, &argument_count);
+
+    rn_register_bridge_cb(&rcv_message);
 
     //Start threads to show stdout and stderr in logcat.
     if (option_redirectOutputToLogcat) {
@@ -195,7 +447,156 @@ Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeWithArgum
         }
     }
 
-    //Start node, with argc and argv.
-    return jint(callintoNode(argument_count,argv));
+    //A pre-warmed runtime already runs on its own thread. Wait for it to exit.
+    if (rn_runtime_is_prewarmed()) {
+        return jint(callintoNode(argument_count,argv));
+    }
+
+    //Start node, with argc and argv, on a thread configured by the startup options.
+    NodeThreadArgs* node_args = new NodeThreadArgs{ argument_count, argv };
+    if (rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_MAIN, node_thread_func, node_args) != 0) {
+        __android_log_write(ANDROID_LOG_ERROR, ADBTAG, "Couldn't start the Node thread.");
+        delete node_args;
+        env->CallStaticVoidMethod(moduleClass, onNodeStoppedMethod);
+        return jint(-1);
+    }
+    return jint(0);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_startNodeEnvironment(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring name,
+        jobjectArray arguments,
+        jstring modulesPath,
+        jboolean option_redirectOutputToLogcat) {
+
+    //Environments share the process' NODE_PATH with the main runtime.
+    const char* path_path = env->GetStringUTFChars(modulesPath, 0);
+    setenv("NODE_PATH", path_path, 1);
+    env->ReleaseStringUTFChars(modulesPath, path_path);
+
+    const char* nativeName = env->GetStringUTFChars(name, 0);
+    EnvironmentThreadArgs* env_args = new EnvironmentThreadArgs{ nativeName, 0, NULL };
+    env->ReleaseStringUTFChars(name, nativeName);
+    env_args->argv = copy_arguments(env, arguments, &env_args->argc);
+
+    rn_register_bridge_cb(&rcv_message);
+
+    if (option_redirectOutputToLogcat) {
+        if (start_redirecting_stdout_stderr()==-1) {
+            __android_log_write(ANDROID_LOG_ERROR, ADBTAG, "Couldn't start redirecting stdout and stderr to logcat.");
+        }
+    }
+
+    if (rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_ENVIRONMENT, environment_thread_func, env_args) != 0) {
+        __android_log_write(ANDROID_LOG_ERROR, ADBTAG, "Couldn't start the thread of a Node environment.");
+        delete env_args;
+        return jint(-1);
+    }
+    return jint(0);
+}
 
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_stopNodeEnvironment(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring name) {
+    const char* nativeName = env->GetStringUTFChars(name, 0);
+    bool stopped = rn_runtime_stop_environment(nativeName);
+    env->ReleaseStringUTFChars(name, nativeName);
+    return jboolean(stopped);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_setWorkerPoolSize(
+        JNIEnv *env,
+        jobject /* this */,
+        jint size) {
+    return jint(rn_pool_set_size(size));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_submitWorkerPoolJob(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring jobId,
+        jstring module,
+        jstring args,
+        jstring replyChannel) {
+    const char* nativeJobId = env->GetStringUTFChars(jobId, 0);
+    const char* nativeModule = env->GetStringUTFChars(module, 0);
+    const char* nativeArgs = env->GetStringUTFChars(args, 0);
+    const char* nativeReplyChannel = env->GetStringUTFChars(replyChannel, 0);
+    rn_pool_submit(nativeJobId, nativeModule, nativeArgs, nativeReplyChannel);
+    env->ReleaseStringUTFChars(jobId, nativeJobId);
+    env->ReleaseStringUTFChars(module, nativeModule);
+    env->ReleaseStringUTFChars(args, nativeArgs);
+    env->ReleaseStringUTFChars(replyChannel, nativeReplyChannel);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_clearWorkerPool(
+        JNIEnv *env,
+        jobject /* this */) {
+    return jint(rn_pool_clear());
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_prewarmNodeRuntime(
+        JNIEnv *env,
+        jclass /* clazz */,
+        jstring modulesPath) {
+
+    //Set the builtin_modules path to NODE_PATH, which the bootstrap reads.
+    const char* path_path = env->GetStringUTFChars(modulesPath, 0);
+    setenv("NODE_PATH", path_path, 1);
+    env->ReleaseStringUTFChars(modulesPath, path_path);
+
+    rn_register_bridge_cb(&rcv_message);
+
+    //Node keeps running on this thread once started.
+    return jint(rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_MAIN, prewarm_thread_func, 0));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_configureThreads(
+        JNIEnv *env,
+        jobject /* this */,
+        jstring role,
+        jint stackSizeKb,
+        jstring priority,
+        jdouble affinityMask) {
+    const char* nativeRole = env->GetStringUTFChars(role, 0);
+    const char* nativePriority = env->GetStringUTFChars(priority, 0);
+    bool configured = rn_threads_configure(nativeRole, (size_t)stackSizeKb, nativePriority, (uint64_t)affinityMask);
+    env->ReleaseStringUTFChars(role, nativeRole);
+    env->ReleaseStringUTFChars(priority, nativePriority);
+    return jboolean(configured);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_applyThreadConfiguration(
+        JNIEnv *env,
+        jclass /* clazz */,
+        jint role) {
+    rn_thread_apply_config((RNThreadRole)role);
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_com_janeasystems_rn_1nodejs_1mobile_RNNodeJsMobileModule_getThreadStackSize(
+        JNIEnv *env,
+        jclass /* clazz */,
+        jint role) {
+    return jlong(rn_thread_stack_size((RNThreadRole)role));
 }
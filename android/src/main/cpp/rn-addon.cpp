@@ -0,0 +1,146 @@
+#include "node.h"
+#include "rn-addon.h"
+#include "rn-bridge.h"
+
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * C interface of the bridge for Node native addons.
+ *
+ * The messages are built here the way rn-bridge's MessageCodec serializes
+ * them, then sent with rn_bridge_emit, the path of the messages sent by
+ * JavaScript.
+ */
+
+namespace {
+
+const char kSystemChannel[] = "_SYSTEM_";
+const char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Whether `channel` is the system channel of an environment, which only
+// carries the plugin's own messages.
+bool IsSystemChannel(const char* channel) {
+    size_t length = strlen(channel);
+    size_t system_length = strlen(kSystemChannel);
+    if (length < system_length || strcmp(channel + length - system_length, kSystemChannel) != 0) {
+        return false;
+    }
+    return length == system_length ||
+           strncmp(channel + length - system_length - strlen(RN_BRIDGE_NAMESPACE_SEPARATOR),
+                   RN_BRIDGE_NAMESPACE_SEPARATOR, strlen(RN_BRIDGE_NAMESPACE_SEPARATOR)) == 0;
+}
+
+// Appends `value` to `out` as a JSON string.
+void AppendJsonString(std::string& out, const char* value, size_t length) {
+    out += '"';
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)value[i];
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += (char)c;
+                }
+        }
+    }
+    out += '"';
+}
+
+// The envelope of MessageCodec.serialize: the event, and its arguments as a
+// JSON string.
+std::string Envelope(const char* event, const char* args_json, size_t args_length) {
+    std::string envelope;
+    envelope.reserve(args_length + args_length / 8 + strlen(event) + 32);
+    envelope += "{\"event\":";
+    AppendJsonString(envelope, event, strlen(event));
+    envelope += ",\"payload\":";
+    AppendJsonString(envelope, args_json, args_length);
+    envelope += '}';
+    return envelope;
+}
+
+int SendRaw(const char* channel, const char* message) {
+    if (channel == nullptr || message == nullptr || IsSystemChannel(channel)) {
+        return RN_BRIDGE_ADDON_INVALID_ARGUMENT;
+    }
+    rn_bridge_emit(channel, message);
+    return RN_BRIDGE_ADDON_OK;
+}
+
+int PostEvent(const char* channel, const char* event, const char* args_json) {
+    if (channel == nullptr || event == nullptr || IsSystemChannel(channel)) {
+        return RN_BRIDGE_ADDON_INVALID_ARGUMENT;
+    }
+    if (args_json == nullptr) {
+        args_json = "[]";
+    }
+    // The arguments are parsed by the application; only their shape is
+    // checked here.
+    const char* start = args_json + strspn(args_json, " \t\r\n");
+    if (*start != '[') {
+        return RN_BRIDGE_ADDON_INVALID_ARGUMENT;
+    }
+    rn_bridge_emit(channel, Envelope(event, args_json, strlen(args_json)).c_str());
+    return RN_BRIDGE_ADDON_OK;
+}
+
+int PostBuffer(const char* channel, const char* event, const void* data, size_t length) {
+    if (channel == nullptr || event == nullptr || (data == nullptr && length > 0) || IsSystemChannel(channel)) {
+        return RN_BRIDGE_ADDON_INVALID_ARGUMENT;
+    }
+    // ["<base64>"], which needs no escaping.
+    const unsigned char* bytes = (const unsigned char*)data;
+    std::string args;
+    args.reserve((length + 2) / 3 * 4 + 4);
+    args += "[\"";
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t group = (uint32_t)bytes[i] << 16;
+        if (i + 1 < length) {
+            group |= (uint32_t)bytes[i + 1] << 8;
+        }
+        if (i + 2 < length) {
+            group |= bytes[i + 2];
+        }
+        args += kBase64Alphabet[(group >> 18) & 0x3f];
+        args += kBase64Alphabet[(group >> 12) & 0x3f];
+        args += i + 1 < length ? kBase64Alphabet[(group >> 6) & 0x3f] : '=';
+        args += i + 2 < length ? kBase64Alphabet[group & 0x3f] : '=';
+    }
+    args += "\"]";
+    rn_bridge_emit(channel, Envelope(event, args.c_str(), args.size()).c_str());
+    return RN_BRIDGE_ADDON_OK;
+}
+
+const rn_bridge_addon_api addonApi = {
+    RN_BRIDGE_ADDON_API_VERSION,
+    SendRaw,
+    PostEvent,
+    PostBuffer,
+};
+
+void Method_GetAddonApi(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    args.GetReturnValue().Set(v8::External::New(isolate, (void*)&addonApi));
+}
+
+}  // namespace
+
+const rn_bridge_addon_api* rn_bridge_addon_api_get(void) {
+    return &addonApi;
+}
+
+void rn_addon_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "getAddonApi", Method_GetAddonApi);
+}
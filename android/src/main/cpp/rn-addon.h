@@ -0,0 +1,11 @@
+#ifndef SRC_RN_ADDON_H_
+#define SRC_RN_ADDON_H_
+
+#include "node.h"
+#include "rn-bridge-addon.h"
+
+// Registers the method returning the rn_bridge_addon_api table on the
+// rn_bridge binding.
+void rn_addon_init(v8::Local<v8::Object> exports);
+
+#endif
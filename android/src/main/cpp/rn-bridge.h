@@ -1,9 +1,93 @@
 #ifndef SRC_RN_BRIDGE_H_
 #define SRC_RN_BRIDGE_H_
 
+#include <cstddef>
+#include <cstdint>
+
 typedef void (*rn_bridge_cb)(const char* channelName, const char* message);
 void rn_register_bridge_cb(rn_bridge_cb);
 void rn_bridge_notify(const char* channelName, const char *message);
+
+// Handle of a channel to Node, valid for the life of the process, which
+// saves looking the channel up by name for each message.
+typedef struct RNBridgeChannel* rn_bridge_channel;
+
+// Returns the handle of the channel named `channelName` on the native side,
+// which Node may register later, or null if `channelName` is null.
+rn_bridge_channel rn_bridge_get_channel(const char* channelName);
+
+// Gives a buffer of rn_bridge_send_buffer back to its producer.
+typedef void (*rn_bridge_free_cb)(void* data, size_t length, void* user_data);
+
+// Sends `length` bytes at `data` to Node without copying them: the channel
+// emits a 'buffer' event with a Buffer over `data`. The bridge owns the
+// buffer until `free_cb` is called, once, when the JavaScript side releases
+// it, when V8 collects it or when its environment is freed, including while
+// the buffer is still queued for the channel's environment. That can happen
+// on any thread, including V8's background threads. `free_cb` can be null.
+// Returns false, and keeps the buffer with the caller, if the channel or
+// `data` is null or the channel is the system channel.
+bool rn_bridge_send_buffer(rn_bridge_channel channel, void* data, size_t length,
+                           rn_bridge_free_cb free_cb, void* user_data);
 void rn_register_node_data_dir_path(const char* path);
+// The registered data directory, or nullptr.
+const char* rn_bridge_data_dir();
+
+// Sends a message to the application on `channelName`, as is, whichever
+// environment calls it. Can be called from any thread; the messages a
+// thread sends reach the application in the order it sent them.
+void rn_bridge_emit(const char* channelName, const char* message);
+
+// Native listener of the messages Node sends on a channel, called with the
+// `data` it was registered with.
+typedef void (*rn_bridge_listener)(const char* channelName, const char* message, void* data);
+
+// Runs `task(task_data)` on the thread of the executor's choice, e.g. by
+// posting it to the event loop of a native component. `executor_data` is
+// the one given to rn_bridge_add_listener.
+typedef void (*rn_bridge_executor)(void (*task)(void* task_data), void* task_data, void* executor_data);
+
+// Registers a native listener for the messages Node sends on `channelName`,
+// the name the native side knows the channel by (e.g. "<name>/<channel>"
+// for a named environment). The messages of a channel with native listeners
+// are given to them, in full, and no longer to the callback registered with
+// rn_register_bridge_cb, so they skip the application's JavaScript. Without
+// an executor, the listener is called on the thread sending the message,
+// usually the Node thread, and must return quickly. With one, each message
+// is copied and handed to the executor. Returns the id of the listener, for
+// rn_bridge_remove_listener, or 0 if `channelName` or `listener` is null.
+uint64_t rn_bridge_add_listener(const char* channelName, rn_bridge_listener listener, void* data,
+                                rn_bridge_executor executor, void* executor_data);
+
+// Unregisters a native listener. Messages already handed to its executor
+// aren't delivered to it, but a call without executor may still be running
+// on another thread. Returns false if no listener has this id.
+bool rn_bridge_remove_listener(uint64_t id);
+
+// Sets how long messages to Node on `channelName` may wait to be delivered
+// together with the next ones, so a steady trickle of messages doesn't wake
+// the Node thread up for each. 0, the default, delivers each right away.
+void rn_bridge_set_latency_budget(const char* channelName, uint32_t budget_ms);
+
+// Delays the delivery of messages to Node by up to `delay_ms`, so messages
+// queued in the meantime are delivered by a single wakeup of the Node
+// thread. Messages of the system channel aren't delayed. 0 delivers the
+// queued messages right away and stops delaying the next ones.
+void rn_bridge_set_coalescing_delay(uint32_t delay_ms);
+
+namespace v8 { class Isolate; }
+// Closes the channels' event loop handles before the environment running in
+// `isolate` is freed. Queued messages are kept for the next environment.
+void rn_bridge_release_channels(v8::Isolate* isolate);
+
+// Separator between the name of an environment started with
+// rn_runtime_start_environment and the names of its channels.
+#define RN_BRIDGE_NAMESPACE_SEPARATOR "/"
+
+// Makes the channels registered and used by the environment running in
+// `isolate` named "<name>/<channel>" on the native side, so each
+// environment has its own channels. Set before the environment runs any
+// JavaScript; rn_bridge_release_channels clears it.
+void rn_bridge_set_namespace(v8::Isolate* isolate, const char* name);
 
 #endif
@@ -0,0 +1,129 @@
+#include "node.h"
+#include "rn-capture.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Bridge traffic capture.
+ *
+ * Messages are written by the threads sending them, under a lock, to a
+ * buffered file. Capturing is meant for short sessions reproducing a
+ * workload, not to be left on like the flight recorder.
+ */
+
+std::atomic<bool> rn_capture_active(false);
+
+namespace {
+
+std::mutex captureMutex;
+FILE* captureFile = nullptr;
+std::map<std::string, uint64_t> channelIndexes;
+std::chrono::steady_clock::time_point lastRecord;
+
+void WriteVarint(uint64_t value) {
+    uint8_t bytes[10];
+    int count = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        bytes[count++] = value != 0 ? (byte | 0x80) : byte;
+    } while (value != 0);
+    fwrite(bytes, 1, count, captureFile);
+}
+
+void WriteString(const char* data, size_t length) {
+    WriteVarint(length);
+    fwrite(data, 1, length, captureFile);
+}
+
+void CloseCapture() {
+    if (captureFile != nullptr) {
+        fclose(captureFile);
+        captureFile = nullptr;
+    }
+    channelIndexes.clear();
+}
+
+void Method_StartCapture(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected a file path.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::String::Utf8Value path(isolate, args[0]);
+    if (!rn_capture_start(*path)) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "Could not create the capture file.").ToLocalChecked()
+        ));
+    }
+}
+
+void Method_StopCapture(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    rn_capture_stop();
+}
+
+void Method_IsCapturing(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    args.GetReturnValue().Set(rn_capture_enabled());
+}
+
+}  // namespace
+
+bool rn_capture_start(const char* path) {
+    std::lock_guard<std::mutex> lock(captureMutex);
+    rn_capture_active = false;
+    CloseCapture();
+    captureFile = fopen(path, "wb");
+    if (captureFile == nullptr) {
+        return false;
+    }
+    setvbuf(captureFile, nullptr, _IOFBF, 64 * 1024);
+    fwrite(RN_CAPTURE_MAGIC, 1, strlen(RN_CAPTURE_MAGIC), captureFile);
+    lastRecord = std::chrono::steady_clock::now();
+    rn_capture_active = true;
+    return true;
+}
+
+void rn_capture_stop() {
+    std::lock_guard<std::mutex> lock(captureMutex);
+    rn_capture_active = false;
+    CloseCapture();
+}
+
+void rn_capture_message(RNCaptureDirection direction, const char* channel, const char* message) {
+    if (!rn_capture_enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(captureMutex);
+    if (captureFile == nullptr) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto delta = std::chrono::duration_cast<std::chrono::microseconds>(now - lastRecord);
+    lastRecord = now;
+
+    WriteVarint((uint64_t)direction);
+    WriteVarint((uint64_t)delta.count());
+    auto it = channelIndexes.find(channel);
+    if (it != channelIndexes.end()) {
+        WriteVarint(it->second);
+    } else {
+        uint64_t index = channelIndexes.size();
+        channelIndexes[channel] = index;
+        WriteVarint(index);
+        WriteString(channel, strlen(channel));
+    }
+    WriteString(message, strlen(message));
+}
+
+void rn_capture_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "startCapture", Method_StartCapture);
+    NODE_SET_METHOD(exports, "stopCapture", Method_StopCapture);
+    NODE_SET_METHOD(exports, "isCapturing", Method_IsCapturing);
+}
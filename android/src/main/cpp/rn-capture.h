@@ -0,0 +1,46 @@
+#ifndef SRC_RN_CAPTURE_H_
+#define SRC_RN_CAPTURE_H_
+
+#include "node.h"
+
+#include <atomic>
+
+// Bridge traffic capture. Writes every message crossing the bridge, in full
+// and with its time, to a file that scripts/replay-bridge-capture.js can
+// replay against the Node project on a host.
+//
+// The file starts with the 8 bytes "RNCAPTR1", followed by one record per
+// message, made of unsigned LEB128 varints and bytes:
+//   direction       0: to Node, 1: to the application
+//   delta_us        time since the previous record, or since the start
+//   channel_index   index of the channel in the order channels first
+//                   appeared; a new index is followed by:
+//     name_length, name
+//   message_length, message
+
+#define RN_CAPTURE_MAGIC "RNCAPTR1"
+
+enum RNCaptureDirection {
+    RN_CAPTURE_TO_NODE = 0,
+    RN_CAPTURE_TO_APP = 1,
+};
+
+extern std::atomic<bool> rn_capture_active;
+
+inline bool rn_capture_enabled() {
+    return rn_capture_active.load(std::memory_order_relaxed);
+}
+
+// Starts capturing to `path`, ending the capture in progress if any.
+// Returns false if the file can't be created.
+bool rn_capture_start(const char* path);
+
+// Ends the capture and closes its file.
+void rn_capture_stop();
+
+void rn_capture_message(RNCaptureDirection direction, const char* channel, const char* message);
+
+// Registers the capture methods on the rn_bridge binding.
+void rn_capture_init(v8::Local<v8::Object> exports);
+
+#endif
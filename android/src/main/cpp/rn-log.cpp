@@ -0,0 +1,325 @@
+#include "rn-log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+/**
+ * Log forwarder.
+ *
+ * Each stream has a single-producer, single-consumer ring buffer: the
+ * reading thread only moves `head` and the writer thread only moves `tail`,
+ * so appending never waits for the writer. A line that doesn't fit is
+ * dropped as a whole, or cut short if part of it was already appended, for
+ * which one byte of the ring is always kept free.
+ */
+
+namespace {
+
+const size_t kMinBufferSize = 4096;
+// How long a line without line break waits for the rest of it.
+const std::chrono::milliseconds kPartialLineDelay(100);
+
+struct LogStream {
+    RNLogLevel default_level;
+    std::vector<char> ring;
+    size_t mask;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    // Used by the producer only. Whether the last byte appended isn't a
+    // line break, and whether the rest of the current line is dropped.
+    bool line_open = false;
+    bool dropping = false;
+    // Used by the writer only. The line read so far, and when it last grew.
+    std::string pending;
+    std::chrono::steady_clock::time_point pending_updated;
+};
+
+struct LogLine {
+    RNLogLevel level;
+    size_t offset;
+    size_t length;
+};
+
+}  // namespace
+
+struct RNLogForwarder {
+    RNLogSink sink;
+    void* data;
+    std::vector<std::unique_ptr<LogStream>> streams;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool signaled = false;
+    bool stopping = false;
+    std::atomic<uint64_t> dropped{0};
+    // Used by the writer only.
+    double lines_per_second;
+    double burst_lines;
+    double tokens;
+    std::chrono::steady_clock::time_point refilled;
+    uint64_t reported_dropped = 0;
+    std::string text;
+    std::vector<LogLine> lines;
+};
+
+namespace {
+
+void CopyToRing(LogStream& stream, size_t position, const char* data, size_t length) {
+    size_t offset = position & stream.mask;
+    size_t first = std::min(length, stream.ring.size() - offset);
+    memcpy(&stream.ring[offset], data, first);
+    memcpy(&stream.ring[0], data + first, length - first);
+}
+
+void Signal(RNLogForwarder* forwarder) {
+    std::lock_guard<std::mutex> lock(forwarder->mutex);
+    forwarder->signaled = true;
+    forwarder->wakeup.notify_one();
+}
+
+RNLogLevel LevelForPriority(char priority) {
+    if (priority <= '3') return RN_LOG_ERROR;
+    if (priority == '4') return RN_LOG_WARN;
+    if (priority <= '6') return RN_LOG_INFO;
+    return RN_LOG_DEBUG;
+}
+
+void AddLine(RNLogForwarder* forwarder, RNLogLevel level, const char* line, size_t length) {
+    forwarder->lines.push_back({ level, forwarder->text.size(), length });
+    forwarder->text.append(line, length);
+    forwarder->text.push_back('\0');
+}
+
+// Adds a complete line to the batch, unless the rate limit drops it.
+void EmitLine(RNLogForwarder* forwarder, LogStream& stream, const std::string& line) {
+    if (forwarder->lines_per_second > 0) {
+        if (forwarder->tokens < 1) {
+            forwarder->dropped++;
+            return;
+        }
+        forwarder->tokens -= 1;
+    }
+    uint64_t dropped = forwarder->dropped.load();
+    if (dropped != forwarder->reported_dropped) {
+        char notice[64];
+        int length = snprintf(notice, sizeof notice, "%llu log lines dropped",
+            (unsigned long long)(dropped - forwarder->reported_dropped));
+        AddLine(forwarder, RN_LOG_WARN, notice, (size_t)length);
+        forwarder->reported_dropped = dropped;
+    }
+    RNLogLevel level = stream.default_level;
+    size_t start = 0;
+    size_t length = line.size();
+    if (length >= 3 && line[0] == '<' && line[1] >= '0' && line[1] <= '7' && line[2] == '>') {
+        level = LevelForPriority(line[1]);
+        start = 3;
+    }
+    if (length > start && line[length - 1] == '\r') {
+        length--;
+    }
+    AddLine(forwarder, level, line.data() + start, length - start);
+}
+
+// Gives the start of a line too long for the sink as a line of its own,
+// without splitting a UTF-8 sequence.
+void SplitLongLine(RNLogForwarder* forwarder, LogStream& stream) {
+    while (stream.pending.size() >= RN_LOG_MAX_LINE_LENGTH) {
+        size_t cut = RN_LOG_MAX_LINE_LENGTH;
+        while (cut > 0 && (stream.pending[cut] & 0xC0) == 0x80) {
+            cut--;
+        }
+        if (cut == 0) {
+            cut = RN_LOG_MAX_LINE_LENGTH;
+        }
+        EmitLine(forwarder, stream, stream.pending.substr(0, cut));
+        stream.pending.erase(0, cut);
+    }
+}
+
+// Moves what the stream's ring buffer holds to the batch. Returns whether
+// anything was read.
+bool DrainStream(RNLogForwarder* forwarder, LogStream& stream) {
+    size_t head = stream.head.load(std::memory_order_acquire);
+    size_t tail = stream.tail.load(std::memory_order_relaxed);
+    if (head == tail) {
+        return false;
+    }
+    while (tail != head) {
+        size_t offset = tail & stream.mask;
+        size_t available = std::min(head - tail, stream.ring.size() - offset);
+        const char* data = &stream.ring[offset];
+        const char* end = data + available;
+        while (data < end) {
+            const char* newline = (const char*)memchr(data, '\n', end - data);
+            const char* segment_end = newline != nullptr ? newline : end;
+            stream.pending.append(data, segment_end - data);
+            SplitLongLine(forwarder, stream);
+            if (newline == nullptr) {
+                break;
+            }
+            EmitLine(forwarder, stream, stream.pending);
+            stream.pending.clear();
+            data = newline + 1;
+        }
+        tail += available;
+    }
+    stream.tail.store(tail, std::memory_order_release);
+    return true;
+}
+
+}  // namespace
+
+RNLogForwarder* rn_log_create(RNLogSink sink, void* data, uint32_t lines_per_second, uint32_t burst_lines) {
+    RNLogForwarder* forwarder = new RNLogForwarder();
+    forwarder->sink = sink;
+    forwarder->data = data;
+    forwarder->lines_per_second = lines_per_second;
+    forwarder->burst_lines = std::max(burst_lines, 1u);
+    forwarder->tokens = forwarder->burst_lines;
+    forwarder->refilled = std::chrono::steady_clock::now();
+    return forwarder;
+}
+
+int rn_log_add_stream(RNLogForwarder* forwarder, RNLogLevel default_level, size_t buffer_size) {
+    size_t size = kMinBufferSize;
+    while (size < buffer_size) {
+        size <<= 1;
+    }
+    std::unique_ptr<LogStream> stream(new LogStream());
+    stream->default_level = default_level;
+    stream->ring.resize(size);
+    stream->mask = size - 1;
+    forwarder->streams.push_back(std::move(stream));
+    return (int)forwarder->streams.size() - 1;
+}
+
+void rn_log_append(RNLogForwarder* forwarder, int index, const char* data, size_t length) {
+    LogStream& stream = *forwarder->streams[index];
+    size_t head = stream.head.load(std::memory_order_relaxed);
+    size_t free_space = stream.ring.size() - (head - stream.tail.load(std::memory_order_acquire));
+    bool appended = false;
+    const char* end = data + length;
+    while (data < end) {
+        const char* newline = (const char*)memchr(data, '\n', end - data);
+        const char* segment_end = newline != nullptr ? newline + 1 : end;
+        size_t segment_length = segment_end - data;
+        if (stream.dropping) {
+            if (newline != nullptr) {
+                stream.dropping = false;
+                forwarder->dropped++;
+            }
+        } else if (segment_length + 1 <= free_space) {
+            CopyToRing(stream, head, data, segment_length);
+            head += segment_length;
+            free_space -= segment_length;
+            stream.line_open = newline == nullptr;
+            appended = true;
+        } else {
+            // What was appended of the line is given as it is.
+            if (stream.line_open) {
+                CopyToRing(stream, head, "\n", 1);
+                head++;
+                free_space--;
+                stream.line_open = false;
+                appended = true;
+            }
+            if (newline != nullptr) {
+                forwarder->dropped++;
+            } else {
+                stream.dropping = true;
+            }
+        }
+        data = segment_end;
+    }
+    if (appended) {
+        stream.head.store(head, std::memory_order_release);
+        Signal(forwarder);
+    }
+}
+
+void rn_log_read_fd(RNLogForwarder* forwarder, int stream, int fd) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t size = read(fd, buffer, sizeof buffer);
+        if (size > 0) {
+            rn_log_append(forwarder, stream, buffer, (size_t)size);
+        } else if (size < 0 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+}
+
+void rn_log_run(RNLogForwarder* forwarder) {
+    std::vector<RNLogRecord> records;
+    bool has_partial_line = false;
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(forwarder->mutex);
+            auto ready = [forwarder] { return forwarder->signaled || forwarder->stopping; };
+            if (has_partial_line) {
+                forwarder->wakeup.wait_for(lock, kPartialLineDelay, ready);
+            } else {
+                forwarder->wakeup.wait(lock, ready);
+            }
+            forwarder->signaled = false;
+            stopping = forwarder->stopping;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - forwarder->refilled;
+        forwarder->tokens = std::min(forwarder->burst_lines,
+            forwarder->tokens + elapsed.count() * forwarder->lines_per_second);
+        forwarder->refilled = now;
+
+        has_partial_line = false;
+        for (auto& stream : forwarder->streams) {
+            if (DrainStream(forwarder, *stream)) {
+                stream->pending_updated = now;
+            }
+            if (stream->pending.empty()) {
+                continue;
+            }
+            if (stopping || now - stream->pending_updated >= kPartialLineDelay) {
+                EmitLine(forwarder, *stream, stream->pending);
+                stream->pending.clear();
+            } else {
+                has_partial_line = true;
+            }
+        }
+
+        if (!forwarder->lines.empty()) {
+            records.clear();
+            for (const LogLine& line : forwarder->lines) {
+                records.push_back({ line.level, forwarder->text.data() + line.offset, line.length });
+            }
+            forwarder->sink(records.data(), records.size(), forwarder->data);
+            forwarder->lines.clear();
+            forwarder->text.clear();
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void rn_log_stop(RNLogForwarder* forwarder) {
+    std::lock_guard<std::mutex> lock(forwarder->mutex);
+    forwarder->stopping = true;
+    forwarder->wakeup.notify_one();
+}
+
+uint64_t rn_log_dropped_lines(RNLogForwarder* forwarder) {
+    return forwarder->dropped.load();
+}
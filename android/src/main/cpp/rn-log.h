@@ -0,0 +1,74 @@
+#ifndef SRC_RN_LOG_H_
+#define SRC_RN_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Forwards the output of Node, written to pipes, to a log sink. The threads
+// reading the pipes only copy what they read to a ring buffer per stream,
+// so a slow sink never makes the pipes fill up and Node's writes to stdout
+// and stderr block. A writer thread splits the buffered output into lines
+// and hands them to the sink in batches. Doesn't depend on Android, so it
+// can run on any POSIX host with another sink.
+
+// Same values as android_LogPriority.
+enum RNLogLevel {
+    RN_LOG_DEBUG = 3,
+    RN_LOG_INFO = 4,
+    RN_LOG_WARN = 5,
+    RN_LOG_ERROR = 6,
+};
+
+struct RNLogRecord {
+    RNLogLevel level;
+    // Null-terminated, without the line break.
+    const char* message;
+    size_t length;
+};
+
+// Receives a batch of lines, on the writer thread. The records are only
+// valid during the call.
+typedef void (*RNLogSink)(const RNLogRecord* records, size_t count, void* data);
+
+struct RNLogForwarder;
+
+// Longest line given to the sink, in bytes. Longer lines are split. Fits in
+// a logcat entry.
+#define RN_LOG_MAX_LINE_LENGTH 4000
+
+// Creates a forwarder. At most `lines_per_second` lines are given to the
+// sink, after a burst of `burst_lines`. The lines over the limit are
+// dropped and counted, and the count is logged once lines get through
+// again.
+RNLogForwarder* rn_log_create(RNLogSink sink, void* data, uint32_t lines_per_second, uint32_t burst_lines);
+
+// Adds a stream, with a ring buffer of `buffer_size` bytes, rounded up to a
+// power of two. Its lines are logged at `default_level`, unless they start
+// with a syslog priority prefix, from "<0>" to "<7>": "<3>" and lower are
+// errors, "<4>" warnings, "<5>" and "<6>" information and "<7>" debug
+// messages. Returns the stream's index. Streams must be added before the
+// writer runs.
+int rn_log_add_stream(RNLogForwarder* forwarder, RNLogLevel default_level, size_t buffer_size);
+
+// Copies output of a stream to its ring buffer, without blocking. The
+// lines that don't fit are dropped and counted. A stream must be appended
+// to by a single thread.
+void rn_log_append(RNLogForwarder* forwarder, int stream, const char* data, size_t length);
+
+// Appends what is read from `fd` to a stream, until the end of the file or
+// a read error.
+void rn_log_read_fd(RNLogForwarder* forwarder, int stream, int fd);
+
+// Gives the buffered lines to the sink until rn_log_stop is called, and then
+// the remaining ones. A line without line break is given once no more of it
+// came for a while.
+void rn_log_run(RNLogForwarder* forwarder);
+
+// Makes rn_log_run return once the buffers are empty.
+void rn_log_stop(RNLogForwarder* forwarder);
+
+// The number of lines dropped so far, because of the rate limit or because
+// a ring buffer was full.
+uint64_t rn_log_dropped_lines(RNLogForwarder* forwarder);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SRC_RN_RECORDER_H_
+#define SRC_RN_RECORDER_H_
+
+#include "node.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Flight recorder. Keeps the latest bridge messages, log lines and runtime
+// events in a fixed-size ring of records in a memory-mapped file in the data
+// directory, so they are still there after the process dies. Records are
+// written without locks, so recording can be left on.
+
+#define RN_RECORDER_FILE "nodejs-flight-recorder.bin"
+// The recording of the previous process that recorded, moved aside when the
+// recorder is turned on.
+#define RN_RECORDER_PREVIOUS_FILE "nodejs-flight-recorder.previous.bin"
+
+// Most bytes of a message's payload a record can keep.
+#define RN_RECORDER_MAX_PAYLOAD 192
+
+enum RNRecordKind {
+    RN_RECORD_TO_NODE = 1,
+    RN_RECORD_TO_APP,
+    RN_RECORD_LOG,
+    RN_RECORD_EVENT,
+};
+
+extern std::atomic<bool> rn_recorder_active;
+
+inline bool rn_recorder_enabled() {
+    return rn_recorder_active.load(std::memory_order_relaxed);
+}
+
+// Turns recording on or off. The first time it's turned on, the recording
+// file is created in the data directory, with room for `size_bytes`, and
+// the recording of the previous process is kept as
+// RN_RECORDER_PREVIOUS_FILE. The first `payload_bytes` of each message are
+// recorded, up to RN_RECORDER_MAX_PAYLOAD. The size only applies to the
+// file's creation. Returns false if the file couldn't be created.
+bool rn_recorder_configure(bool enabled, size_t size_bytes, size_t payload_bytes);
+
+// Current time, as recorded, in microseconds since the Unix epoch.
+uint64_t rn_recorder_now_us();
+
+// Records a message crossing the bridge. `latency_us` is how long a message
+// to Node was queued.
+void rn_recorder_message(RNRecordKind kind, const char* channel, const char* message, uint64_t latency_us);
+
+// Records a line of Node's output, at a RNLogLevel.
+void rn_recorder_log(int level, const char* line, size_t length);
+
+// Records a runtime event, e.g. "start" or "exit|1".
+void rn_recorder_event(const char* event);
+
+// Adds the methods reading the recordings to the rn_bridge binding.
+void rn_recorder_init(v8::Local<v8::Object> exports);
+
+#endif
@@ -0,0 +1,208 @@
+#include "node.h"
+#include "rn-streaming.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Streaming compilation of the entry script.
+ *
+ * Node reads and compiles the entry script on its main thread after the
+ * bootstrap. For a large bundle, V8 can instead parse and compile it on a
+ * platform worker while it's being read, so most of the work overlaps with
+ * the end of the bootstrap and the preloaded modules. The script is wrapped
+ * like Node wraps CommonJS modules, and the resulting function is given to
+ * the CommonJS loader when it loads the main module.
+ */
+
+namespace {
+
+const char kWrapperPrefix[] = "(function (exports, require, module, __filename, __dirname) { ";
+const char kWrapperSuffix[] = "\n})";
+const size_t kChunkSize = 64 * 1024;
+
+// Runs the main module with the CommonJS loader, replacing the compilation
+// of its file by the streamed wrapper, if any.
+const char kRunMainSource[] =
+    "(function (process, require, compiledWrapper) {\n"
+    "  const { Module } = require('internal/modules/cjs/loader');\n"
+    "  const { makeRequireFunction } = require('internal/modules/cjs/helpers');\n"
+    "  const fs = require('fs');\n"
+    "  const path = require('path');\n"
+    "  process.argv[1] = path.resolve(process.argv[1]);\n"
+    "  if (compiledWrapper !== undefined) {\n"
+    "    const mainPath = fs.realpathSync(process.argv[1]);\n"
+    "    const compile = Module.prototype._compile;\n"
+    "    Module.prototype._compile = function (content, filename) {\n"
+    "      if (filename !== mainPath) {\n"
+    "        return compile.call(this, content, filename);\n"
+    "      }\n"
+    "      Module.prototype._compile = compile;\n"
+    "      const require = makeRequireFunction(this, null);\n"
+    "      return Reflect.apply(compiledWrapper, this.exports,\n"
+    "        [this.exports, require, this, filename, path.dirname(filename)]);\n"
+    "    };\n"
+    "  }\n"
+    "  Module.runMain(process.argv[1]);\n"
+    "})";
+
+}  // namespace
+
+struct RNStreamedScript {
+    std::string filename;
+    // The wrapped source, as it was given to V8.
+    std::string source;
+    std::unique_ptr<v8::ScriptCompiler::StreamedSource> streamed;
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    bool done = false;
+};
+
+namespace {
+
+class FileSourceStream : public v8::ScriptCompiler::ExternalSourceStream {
+public:
+    FileSourceStream(FILE* file, RNStreamedScript* script) : file(file), script(script) {}
+
+    ~FileSourceStream() override {
+        fclose(this->file);
+    }
+
+    // Called on the worker thread until it returns 0.
+    size_t GetMoreData(const uint8_t** src) override {
+        std::string chunk;
+        if (!this->prefixSent) {
+            chunk = kWrapperPrefix;
+            this->prefixSent = true;
+        } else if (!this->fileEnded) {
+            chunk.resize(kChunkSize);
+            chunk.resize(fread(&chunk[0], 1, kChunkSize, this->file));
+            if (this->script->source.size() == sizeof(kWrapperPrefix) - 1 &&
+                chunk.compare(0, 2, "#!") == 0) {
+                // A hashbang is only valid at the start of a script. Turned
+                // into a comment so the line numbers don't change.
+                chunk[0] = '/';
+                chunk[1] = '/';
+            }
+            if (chunk.size() < kChunkSize) {
+                this->fileEnded = true;
+                chunk += kWrapperSuffix;
+            }
+        }
+        if (chunk.empty()) {
+            return 0;
+        }
+        this->script->source += chunk;
+        uint8_t* data = new uint8_t[chunk.size()];
+        memcpy(data, chunk.data(), chunk.size());
+        *src = data;
+        return chunk.size();
+    }
+
+private:
+    FILE* file;
+    RNStreamedScript* script;
+    bool prefixSent = false;
+    bool fileEnded = false;
+};
+
+class StreamingTask : public v8::Task {
+public:
+    StreamingTask(RNStreamedScript* script, v8::ScriptCompiler::ScriptStreamingTask* task)
+        : script(script), task(task) {}
+
+    void Run() override {
+        this->task->Run();
+        this->script->doneMutex.lock();
+        this->script->done = true;
+        // Notified before unlocking: the script is freed as soon as the
+        // waiting thread sees `done`.
+        this->script->doneCondition.notify_all();
+        this->script->doneMutex.unlock();
+    }
+
+private:
+    RNStreamedScript* script;
+    std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> task;
+};
+
+void WaitUntilStreamed(RNStreamedScript* script) {
+    std::unique_lock<std::mutex> lock(script->doneMutex);
+    script->doneCondition.wait(lock, [script] { return script->done; });
+}
+
+// Compiles the streamed script and runs it, which returns the wrapper
+// function. Returns an empty handle if the script doesn't compile.
+v8::MaybeLocal<v8::Value> CompileStreamedWrapper(v8::Isolate* isolate, RNStreamedScript* script) {
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::TryCatch try_catch(isolate);
+    v8::Local<v8::String> full_source;
+    v8::Local<v8::String> filename;
+    v8::Local<v8::Script> compiled;
+    if (!v8::String::NewFromUtf8(isolate, script->source.data(), v8::NewStringType::kNormal,
+                                 (int)script->source.size()).ToLocal(&full_source) ||
+        !v8::String::NewFromUtf8(isolate, script->filename.c_str()).ToLocal(&filename)) {
+        return v8::MaybeLocal<v8::Value>();
+    }
+    v8::ScriptOrigin origin(isolate, filename);
+    if (!v8::ScriptCompiler::Compile(context, script->streamed.get(), full_source, origin).ToLocal(&compiled)) {
+        return v8::MaybeLocal<v8::Value>();
+    }
+    return compiled->Run(context);
+}
+
+}  // namespace
+
+RNStreamedScript* rn_streaming_start(v8::Isolate* isolate, node::MultiIsolatePlatform* platform, const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+    RNStreamedScript* script = new RNStreamedScript();
+    script->filename = filename;
+    script->streamed.reset(new v8::ScriptCompiler::StreamedSource(
+        std::unique_ptr<v8::ScriptCompiler::ExternalSourceStream>(new FileSourceStream(file, script)),
+        v8::ScriptCompiler::StreamedSource::UTF8));
+    v8::ScriptCompiler::ScriptStreamingTask* task =
+        v8::ScriptCompiler::StartStreaming(isolate, script->streamed.get());
+    platform->CallOnWorkerThread(std::unique_ptr<v8::Task>(new StreamingTask(script, task)));
+    return script;
+}
+
+v8::MaybeLocal<v8::Value> rn_streaming_run_main(RNStreamedScript* script, const node::StartExecutionCallbackInfo& info) {
+    v8::Isolate* isolate = info.process_object->GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::EscapableHandleScope scope(isolate);
+
+    // Without a wrapper, Node compiles the file itself and reports the
+    // errors of the streamed compilation.
+    v8::Local<v8::Value> wrapper = v8::Undefined(isolate);
+    if (script != nullptr) {
+        WaitUntilStreamed(script);
+        v8::Local<v8::Value> compiled;
+        if (CompileStreamedWrapper(isolate, script).ToLocal(&compiled)) {
+            wrapper = compiled;
+        }
+    }
+
+    v8::Local<v8::String> run_main_source =
+        v8::String::NewFromUtf8(isolate, kRunMainSource).ToLocalChecked();
+    v8::Local<v8::Value> run_main;
+    if (!v8::Script::Compile(context, run_main_source).ToLocalChecked()->Run(context).ToLocal(&run_main)) {
+        return v8::MaybeLocal<v8::Value>();
+    }
+    v8::Local<v8::Value> argv[] = { info.process_object, info.native_require, wrapper };
+    return scope.EscapeMaybe(run_main.As<v8::Function>()->Call(context, v8::Undefined(isolate), 3, argv));
+}
+
+void rn_streaming_finish(RNStreamedScript* script) {
+    if (script == nullptr) {
+        return;
+    }
+    WaitUntilStreamed(script);
+    delete script;
+}
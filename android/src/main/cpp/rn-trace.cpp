@@ -0,0 +1,374 @@
+#include "node.h"
+#include "rn-trace.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#if !defined(__APPLE__)
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Each thread that records events gets its own fixed-size ring buffer, so
+ * recording never takes a lock. Every slot carries a sequence number that the
+ * exporter uses to skip slots that are being overwritten while it reads them.
+ * The buffer of a thread that exits is kept for export until a new thread
+ * needs one once all kMaxThreads are taken. Its index then carries on, so
+ * the sequence numbers stay unique, from the new thread's first_index.
+ */
+
+std::atomic<bool> rn_trace_active(false);
+
+namespace {
+
+const size_t kEventsPerThread = 8192;
+const size_t kMaxThreads = 64;
+// Beyond that, new strings are traced as kOverflowString.
+const size_t kMaxInternedStrings = 1024;
+const char kOverflowString[] = "(other)";
+// Strings interned by each thread, looked up without the lock.
+const size_t kMaxCachedStrings = 64;
+// Thread id used for events recorded on behalf of the React Native JS thread.
+const uint64_t kReactNativeTid = 0;
+
+struct TraceEvent {
+    std::atomic<uint64_t> seq{0};
+    uint64_t ts_us;
+    uint64_t trace_id;
+    const char* name;
+    const char* channel;
+    char phase;
+    bool react_native;
+};
+
+struct TraceBuffer {
+    std::atomic<uint64_t> head{0};
+    // The owner fields are set under buffersMutex.
+    uint64_t first_index = 0;
+    uint64_t tid = 0;
+    char thread_name[32] = {0};
+    TraceEvent events[kEventsPerThread];
+};
+
+std::atomic<uint64_t> nextTraceId(1);
+std::mutex buffersMutex;
+std::vector<TraceBuffer*> buffers;
+// Buffers of exited threads, oldest first.
+std::vector<TraceBuffer*> freeBuffers;
+// Bumped when a buffer is freed, for the threads that found none.
+std::atomic<uint64_t> freedBufferCount(0);
+std::mutex internMutex;
+std::set<std::string> internedStrings;
+thread_local TraceBuffer* currentBuffer = nullptr;
+thread_local bool bufferUnavailable = false;
+thread_local uint64_t seenFreedBufferCount = 0;
+thread_local bool threadExiting = false;
+thread_local std::map<std::string, const char*> cachedStrings;
+
+// Gives the thread's buffer back when the thread exits.
+struct BufferOwner {
+    TraceBuffer* buffer = nullptr;
+
+    ~BufferOwner() {
+        threadExiting = true;
+        currentBuffer = nullptr;
+        if (buffer == nullptr) {
+            return;
+        }
+        buffersMutex.lock();
+        freeBuffers.push_back(buffer);
+        buffersMutex.unlock();
+        freedBufferCount.fetch_add(1, std::memory_order_release);
+    }
+};
+thread_local BufferOwner bufferOwner;
+
+uint64_t NowUs() {
+    // Wall clock, so events recorded by JS with Date.now() line up.
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t CurrentThreadId() {
+#if defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return tid;
+#else
+    return (uint64_t)syscall(SYS_gettid);
+#endif
+}
+
+TraceBuffer* GetThreadBuffer() {
+    if (currentBuffer != nullptr || threadExiting) {
+        return currentBuffer;
+    }
+    if (bufferUnavailable && freedBufferCount.load(std::memory_order_acquire) == seenFreedBufferCount) {
+        return nullptr;
+    }
+    seenFreedBufferCount = freedBufferCount.load(std::memory_order_acquire);
+    buffersMutex.lock();
+    TraceBuffer* buffer = nullptr;
+    if (buffers.size() < kMaxThreads) {
+        buffer = new TraceBuffer();
+        buffers.push_back(buffer);
+    } else if (!freeBuffers.empty()) {
+        buffer = freeBuffers.front();
+        freeBuffers.erase(freeBuffers.begin());
+        buffer->first_index = buffer->head.load(std::memory_order_relaxed);
+    }
+    if (buffer != nullptr) {
+        buffer->tid = CurrentThreadId();
+#if defined(__APPLE__)
+        pthread_getname_np(pthread_self(), buffer->thread_name, sizeof(buffer->thread_name));
+#else
+        prctl(PR_GET_NAME, buffer->thread_name, 0, 0, 0);
+#endif
+        bufferOwner.buffer = buffer;
+        currentBuffer = buffer;
+    }
+    bufferUnavailable = buffer == nullptr;
+    buffersMutex.unlock();
+    return currentBuffer;
+}
+
+void RecordEvent(const char* name, char phase, uint64_t trace_id, const char* channel, uint64_t ts_us, bool react_native) {
+    TraceBuffer* buffer = GetThreadBuffer();
+    if (buffer == nullptr) {
+        return;
+    }
+    uint64_t index = buffer->head.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[index % kEventsPerThread];
+    // Odd sequence numbers flag a slot that is being written.
+    event.seq.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.ts_us = ts_us;
+    event.trace_id = trace_id;
+    event.name = name;
+    event.channel = channel;
+    event.phase = phase;
+    event.react_native = react_native;
+    event.seq.store(index * 2 + 2, std::memory_order_release);
+    buffer->head.store(index + 1, std::memory_order_release);
+}
+
+void WriteJsonString(FILE* file, const char* str) {
+    fputc('"', file);
+    for (const char* c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void WriteThreadName(FILE* file, bool& first, int pid, uint64_t tid, const char* name) {
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%llu,\"args\":{\"name\":",
+        first ? "" : ",", pid, (unsigned long long)tid);
+    WriteJsonString(file, name);
+    fputs("}}", file);
+    first = false;
+}
+
+void WriteEvent(FILE* file, bool& first, int pid, uint64_t tid, const TraceEvent& event) {
+    fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+    WriteJsonString(file, event.name);
+    fprintf(file, ",\"cat\":\"bridge\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%llu",
+        event.phase, (unsigned long long)event.ts_us, pid, (unsigned long long)tid);
+    if (event.phase == 's' || event.phase == 't' || event.phase == 'f') {
+        // Flow events link all the steps of one message's journey.
+        fprintf(file, ",\"id\":%llu", (unsigned long long)event.trace_id);
+        if (event.phase == 'f') {
+            fputs(",\"bp\":\"e\"", file);
+        }
+    } else if (event.phase == 'i') {
+        fputs(",\"s\":\"t\"", file);
+    }
+    fprintf(file, ",\"args\":{\"trace_id\":%llu", (unsigned long long)event.trace_id);
+    if (event.channel != nullptr) {
+        fputs(",\"channel\":", file);
+        WriteJsonString(file, event.channel);
+    }
+    fputs("}}", file);
+    first = false;
+}
+
+const char* StringArgument(v8::Isolate* isolate, v8::Local<v8::Value> value) {
+    v8::String::Utf8Value str(isolate, value);
+    return rn_trace_intern(*str ? std::string(*str) : std::string());
+}
+
+// traceEvent(name, phase, traceId[, timestampUs[, reactNative]])
+void Method_TraceEvent(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    if (!rn_trace_enabled() || args.Length() < 3) {
+        return;
+    }
+    v8::Isolate* isolate = args.GetIsolate();
+    const char* name = StringArgument(isolate, args[0]);
+    v8::String::Utf8Value phase(isolate, args[1]);
+    uint64_t trace_id = args[2]->IsNumber() ? (uint64_t)args[2].As<v8::Number>()->Value() : 0;
+    uint64_t ts_us = (args.Length() > 3 && args[3]->IsNumber()) ? (uint64_t)args[3].As<v8::Number>()->Value() : NowUs();
+    bool react_native = args.Length() > 4 && args[4]->IsTrue();
+    if (*phase == nullptr || phase.length() != 1) {
+        return;
+    }
+    RecordEvent(name, (*phase)[0], trace_id, nullptr, ts_us, react_native);
+}
+
+void Method_StartTracing(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    rn_trace_start();
+}
+
+void Method_StopTracing(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    rn_trace_stop();
+}
+
+void Method_IsTracing(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    args.GetReturnValue().Set(rn_trace_enabled());
+}
+
+void Method_ExportTrace(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected a file path.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::String::Utf8Value path(isolate, args[0]);
+    int events = rn_trace_export(*path);
+    if (events < 0) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "Could not write the trace file.").ToLocalChecked()
+        ));
+        return;
+    }
+    args.GetReturnValue().Set(v8::Integer::New(isolate, events));
+}
+
+}  // namespace
+
+void rn_trace_start() {
+    rn_trace_active.store(true, std::memory_order_relaxed);
+}
+
+void rn_trace_stop() {
+    rn_trace_active.store(false, std::memory_order_relaxed);
+}
+
+uint64_t rn_trace_next_id() {
+    return nextTraceId.fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* rn_trace_intern(const std::string& name) {
+    auto cached = cachedStrings.find(name);
+    if (cached != cachedStrings.end()) {
+        return cached->second;
+    }
+    const char* interned = kOverflowString;
+    internMutex.lock();
+    auto it = internedStrings.find(name);
+    if (it != internedStrings.end()) {
+        interned = it->c_str();
+    } else if (internedStrings.size() < kMaxInternedStrings) {
+        interned = internedStrings.insert(name).first->c_str();
+    }
+    internMutex.unlock();
+    if (cachedStrings.size() >= kMaxCachedStrings) {
+        cachedStrings.clear();
+    }
+    cachedStrings[name] = interned;
+    return interned;
+}
+
+void rn_trace_event(const char* name, char phase, uint64_t trace_id, const char* channel) {
+    if (!rn_trace_enabled()) {
+        return;
+    }
+    RecordEvent(name, phase, trace_id, channel, NowUs(), false);
+}
+
+int rn_trace_export(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return -1;
+    }
+    int pid = (int)getpid();
+    int written = 0;
+    bool first = true;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    WriteThreadName(file, first, pid, kReactNativeTid, "react-native JS");
+
+    // The owners of the buffers, as they were when the export started.
+    struct BufferSnapshot {
+        TraceBuffer* buffer;
+        uint64_t first_index;
+        uint64_t head;
+        uint64_t tid;
+        char thread_name[32];
+    };
+    std::vector<BufferSnapshot> snapshot;
+    buffersMutex.lock();
+    for (TraceBuffer* buffer : buffers) {
+        BufferSnapshot entry = { buffer, buffer->first_index, buffer->head.load(std::memory_order_acquire), buffer->tid, {0} };
+        memcpy(entry.thread_name, buffer->thread_name, sizeof(entry.thread_name));
+        snapshot.push_back(entry);
+    }
+    buffersMutex.unlock();
+
+    for (const BufferSnapshot& entry : snapshot) {
+        TraceBuffer* buffer = entry.buffer;
+        WriteThreadName(file, first, pid, entry.tid, entry.thread_name);
+        uint64_t head = entry.head;
+        uint64_t start = head > kEventsPerThread ? head - kEventsPerThread : 0;
+        if (start < entry.first_index) {
+            start = entry.first_index;
+        }
+        for (uint64_t index = start; index < head; index++) {
+            const TraceEvent& slot = buffer->events[index % kEventsPerThread];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != index * 2 + 2) {
+                continue;
+            }
+            TraceEvent event;
+            event.ts_us = slot.ts_us;
+            event.trace_id = slot.trace_id;
+            event.name = slot.name;
+            event.channel = slot.channel;
+            event.phase = slot.phase;
+            event.react_native = slot.react_native;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != seq) {
+                // Overwritten while being copied.
+                continue;
+            }
+            WriteEvent(file, first, pid, event.react_native ? kReactNativeTid : entry.tid, event);
+            written++;
+        }
+    }
+    fputs("\n]}\n", file);
+    fclose(file);
+    return written;
+}
+
+void rn_trace_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "traceEvent", Method_TraceEvent);
+    NODE_SET_METHOD(exports, "startTracing", Method_StartTracing);
+    NODE_SET_METHOD(exports, "stopTracing", Method_StopTracing);
+    NODE_SET_METHOD(exports, "isTracing", Method_IsTracing);
+    NODE_SET_METHOD(exports, "exportTrace", Method_ExportTrace);
+}
@@ -7,14 +7,18 @@ import com.facebook.react.bridge.ReactMethod;
 import com.facebook.react.modules.core.RCTNativeAppEventEmitter;
 import com.facebook.react.module.annotations.ReactModule;
 import com.facebook.react.bridge.WritableMap;
+import com.facebook.react.bridge.ReadableArray;
 import com.facebook.react.bridge.ReadableMap;
 import com.facebook.react.bridge.ReadableType;
 import com.facebook.react.bridge.Arguments;
 import com.facebook.react.bridge.LifecycleEventListener;
+import com.facebook.react.bridge.Promise;
 import javax.annotation.Nullable;
 import android.util.Log;
 
+import android.content.ComponentCallbacks2;
 import android.content.Context;
+import android.content.res.Configuration;
 import android.content.res.AssetManager;
 import android.content.pm.PackageInfo;
 import android.content.pm.PackageManager;
@@ -24,7 +28,10 @@ import android.system.ErrnoException;
 
 import java.io.*;
 import java.util.*;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
 import java.util.concurrent.Semaphore;
+import java.util.concurrent.ThreadFactory;
 
 @ReactModule(name = "RNNodeJsMobile")
 public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements LifecycleEventListener {
@@ -37,13 +44,34 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
   private static final String SHARED_PREFS = "NODEJS_MOBILE_PREFS";
   private static final String LAST_UPDATED_TIME = "NODEJS_MOBILE_APK_LastUpdateTime";
   private static final String BUILTIN_NATIVE_ASSETS_PREFIX = "nodejs-native-assets-";
+  private static final String STARTUP_SNAPSHOT_ASSETS_PREFIX = "nodejs-snapshot-";
+  private static final String STARTUP_SNAPSHOT_DIR = "nodejs-snapshot";
+  private static final String STARTUP_SNAPSHOT_FILE = "startup.blob";
+  private static final String CODE_CACHE_PRELOAD = "code-cache/index.js";
+  private static final String WORKER_POOL_SCRIPT = "worker-pool/index.js";
+  // Must match RN_POOL_ENVIRONMENT_PREFIX in rn-pool.h.
+  private static final String WORKER_POOL_ENVIRONMENT_PREFIX = "_pool";
   private static final String SYSTEM_CHANNEL = "_SYSTEM_";
+  private static final int DEFAULT_FLIGHT_RECORDER_SIZE_KB = 1024;
+  private static final int DEFAULT_FLIGHT_RECORDER_PAYLOAD_BYTES = 64;
+  // Must match the names in rn-threads.h, which group CPU usage by thread.
+  private static final String BRIDGE_THREAD_NAME = "nodejs-bridge";
+  // Waits for the assets to be copied before node's thread is started.
+  private static final String START_THREAD_NAME = "nodejs-start";
+  // Must match RNThreadRole in rn-threads.h.
+  private static final int THREAD_ROLE_BRIDGE = 2;
+  private static final String[] THREAD_ROLES = { "node", "logForwarding", "bridge" };
+  // Must match RNMemoryPressureLevel in rn-runtime.h.
+  private static final int MEMORY_PRESSURE_MODERATE = 1;
+  private static final int MEMORY_PRESSURE_CRITICAL = 2;
 
   private static String trashDirPath;
   private static String filesDirPath;
   private static String nodeJsProjectPath;
   private static String builtinModulesPath;
   private static String nativeAssetsPath;
+  private static String startupSnapshotAssetsPath;
+  private static String startupSnapshotDirPath;
 
   private static long lastUpdateTime = 1;
   private static long previousLastUpdateTime = 0;
@@ -64,23 +92,102 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
   public static RNNodeJsMobileModule _instance = null;
 
   // We just want one instance of node running in the background.
-  public static boolean _startedNodeAlready = false;
+  public static volatile boolean _startedNodeAlready = false;
+
+  private static boolean _prewarmedNode = false;
+
+  private static boolean _memoryCallbacksRegistered = false;
+
+  // Delivers node's messages to React Native, in order, on a thread
+  // configured like the other bridge threads.
+  private static final ExecutorService bridgeExecutor = Executors.newSingleThreadExecutor(new ThreadFactory() {
+    @Override
+    public Thread newThread(final Runnable runnable) {
+      return new Thread(null, new Runnable() {
+        @Override
+        public void run() {
+          applyThreadConfiguration(THREAD_ROLE_BRIDGE);
+          runnable.run();
+        }
+      }, BRIDGE_THREAD_NAME, getThreadStackSize(THREAD_ROLE_BRIDGE));
+    }
+  });
 
   public RNNodeJsMobileModule(ReactApplicationContext reactContext) {
     super(reactContext);
     this.reactContext = reactContext;
     reactContext.addLifecycleEventListener(this);
-    filesDirPath = reactContext.getFilesDir().getAbsolutePath();
+    initRuntimePaths(reactContext);
+    registerMemoryCallbacks(reactContext);
+    asyncInit();
+  }
+
+  // Forwards the memory pressure reported by the system to the runtime, as
+  // long as the application runs. Registered once, on the application
+  // context, as new module instances are created on reload.
+  private static synchronized void registerMemoryCallbacks(Context context) {
+    if (_memoryCallbacksRegistered) {
+      return;
+    }
+    _memoryCallbacksRegistered = true;
+    context.getApplicationContext().registerComponentCallbacks(new ComponentCallbacks2() {
+      @Override
+      public void onTrimMemory(int level) {
+        if (level >= TRIM_MEMORY_COMPLETE || level == TRIM_MEMORY_RUNNING_CRITICAL) {
+          notifyMemoryPressure(MEMORY_PRESSURE_CRITICAL);
+        } else if (level != TRIM_MEMORY_UI_HIDDEN) {
+          // The UI being hidden says nothing about the available memory.
+          notifyMemoryPressure(MEMORY_PRESSURE_MODERATE);
+        }
+      }
+
+      @Override
+      public void onLowMemory() {
+        notifyMemoryPressure(MEMORY_PRESSURE_CRITICAL);
+      }
+
+      @Override
+      public void onConfigurationChanged(Configuration newConfig) {
+      }
+    });
+  }
+
+  /**
+   * Bootstraps Node on its own thread before nodejs.start() is called, so
+   * starting only has to load the main script. Meant to be called as early
+   * as possible, e.g. from Application.onCreate(). The started runtime keeps
+   * running on that thread. A start with options it can't take, i.e. Node
+   * options other than -r and -e, heap sizes, streamEntryScript or another
+   * ArrayBuffer allocator, discards it and starts a new runtime on the
+   * thread instead.
+   */
+  public static void prewarm(Context context) {
+    synchronized (RNNodeJsMobileModule.class) {
+      if (_prewarmedNode || _startedNodeAlready) {
+        return;
+      }
+      _prewarmedNode = true;
+    }
+    initRuntimePaths(context);
+    // Node's thread keeps running until the runtime started with
+    // nodejs.start() exits.
+    prewarmNodeRuntime(nodeJsProjectPath + ":" + builtinModulesPath);
+  }
+
+  private static void initRuntimePaths(Context context) {
+    filesDirPath = context.getFilesDir().getAbsolutePath();
 
     // The paths where we expect the node project assets to be at runtime.
     nodeJsProjectPath = filesDirPath + "/" + NODEJS_PROJECT_DIR;
     builtinModulesPath = filesDirPath + "/" + NODEJS_BUILTIN_MODULES;
     trashDirPath = filesDirPath + "/" + TRASH_DIR;
     nativeAssetsPath = BUILTIN_NATIVE_ASSETS_PREFIX + getCurrentABIName();
+    startupSnapshotAssetsPath = STARTUP_SNAPSHOT_ASSETS_PREFIX + getCurrentABIName();
+    startupSnapshotDirPath = filesDirPath + "/" + STARTUP_SNAPSHOT_DIR;
 
     // Sets the TMPDIR environment to the cacheDir, to be used in Node as os.tmpdir
     try {
-      Os.setenv("TMPDIR", reactContext.getCacheDir().getAbsolutePath(), true);
+      Os.setenv("TMPDIR", context.getCacheDir().getAbsolutePath(), true);
     } catch (ErrnoException e) {
       e.printStackTrace();
     }
@@ -88,7 +195,8 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
     // Register the filesDir as the Node data dir.
     registerNodeDataDirPath(filesDirPath);
 
-    asyncInit();
+    // The first start boots from the snapshot if it's present and up to date.
+    registerStartupSnapshot(startupSnapshotDirPath + "/" + STARTUP_SNAPSHOT_FILE, nodeJsProjectPath);
   }
 
   private void asyncInit() {
@@ -139,6 +247,143 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
     }
   }
 
+  private boolean extractCodeCacheOption(ReadableMap options)
+  {
+    final String OPTION_NAME = "codeCache";
+    if( (options != null) &&
+        options.hasKey(OPTION_NAME) &&
+        !options.isNull(OPTION_NAME) &&
+        (options.getType(OPTION_NAME) == ReadableType.Boolean)
+      ) {
+      return options.getBoolean(OPTION_NAME);
+    } else {
+      return false;
+    }
+  }
+
+  private boolean extractStreamEntryScriptOption(ReadableMap options)
+  {
+    final String OPTION_NAME = "streamEntryScript";
+    if( (options != null) &&
+        options.hasKey(OPTION_NAME) &&
+        !options.isNull(OPTION_NAME) &&
+        (options.getType(OPTION_NAME) == ReadableType.Boolean)
+      ) {
+      return options.getBoolean(OPTION_NAME);
+    } else {
+      return false;
+    }
+  }
+
+  // Extracts a tuning option applied by the native side, 0 if it isn't set.
+  private int extractIntegerOption(ReadableMap options, String optionName)
+  {
+    if( (options != null) &&
+        options.hasKey(optionName) &&
+        !options.isNull(optionName) &&
+        (options.getType(optionName) == ReadableType.Number)
+      ) {
+      return options.getInt(optionName);
+    } else {
+      return 0;
+    }
+  }
+
+  // Configures the threads of each role set in the threads option, which
+  // index.js has validated.
+  private void setThreadOptions(ReadableMap options)
+  {
+    final String OPTION_NAME = "threads";
+    if( (options == null) ||
+        !options.hasKey(OPTION_NAME) ||
+        (options.getType(OPTION_NAME) != ReadableType.Map)
+      ) {
+      return;
+    }
+    ReadableMap threads = options.getMap(OPTION_NAME);
+    for (String role : THREAD_ROLES) {
+      if (!threads.hasKey(role) || (threads.getType(role) != ReadableType.Map)) {
+        continue;
+      }
+      ReadableMap thread = threads.getMap(role);
+      final String priority = (thread.hasKey("priority") && !thread.isNull("priority")) ? thread.getString("priority") : "";
+      final double affinityMask = thread.hasKey("affinityMask") ? thread.getDouble("affinityMask") : 0;
+      if (!configureThreads(role, extractIntegerOption(thread, "stackSizeKb"), priority, affinityMask)) {
+        Log.w(TAG, "Invalid configuration of the " + role + " threads.");
+      }
+    }
+  }
+
+  private boolean extractBooleanOption(ReadableMap options, String optionName)
+  {
+    if( (options != null) &&
+        options.hasKey(optionName) &&
+        !options.isNull(optionName) &&
+        (options.getType(optionName) == ReadableType.Boolean)
+      ) {
+      return options.getBoolean(optionName);
+    } else {
+      return false;
+    }
+  }
+
+  // Applies the options of the runtime that aren't node arguments.
+  private void setRuntimeOptions(ReadableMap options)
+  {
+    setThreadOptions(options);
+    final String COALESCING_OPTION = "backgroundCoalescingMs";
+    configureBackgroundMode(
+      extractBooleanOption(options, "backgroundMode"),
+      extractBooleanOption(options, "backgroundGc"),
+      (options != null && options.hasKey(COALESCING_OPTION) && !options.isNull(COALESCING_OPTION)) ?
+        extractIntegerOption(options, COALESCING_OPTION) : -1
+    );
+    setStreamEntryScript(extractStreamEntryScriptOption(options));
+    configureArrayBufferAllocator(
+      extractBooleanOption(options, "pooledArrayBuffers"),
+      extractIntegerOption(options, "arrayBufferLimitMb")
+    );
+    final int flightRecorderSizeKb = extractIntegerOption(options, "flightRecorderSizeKb");
+    final String PAYLOAD_OPTION = "flightRecorderPayloadBytes";
+    final boolean recording = configureFlightRecorder(
+      extractBooleanOption(options, "flightRecorder"),
+      flightRecorderSizeKb > 0 ? flightRecorderSizeKb : DEFAULT_FLIGHT_RECORDER_SIZE_KB,
+      (options != null && options.hasKey(PAYLOAD_OPTION) && !options.isNull(PAYLOAD_OPTION)) ?
+        extractIntegerOption(options, PAYLOAD_OPTION) : DEFAULT_FLIGHT_RECORDER_PAYLOAD_BYTES
+    );
+    if (!recording) {
+      Log.e(TAG, "Couldn't create the flight recording file.");
+    }
+    final int platformWorkerThreads = extractIntegerOption(options, "platformWorkerThreads");
+    if (platformWorkerThreads > 0) {
+      setPlatformWorkerThreads(platformWorkerThreads);
+    }
+    final int uvThreadpoolSize = extractIntegerOption(options, "uvThreadpoolSize");
+    if (uvThreadpoolSize > 0) {
+      setUvThreadpoolSize(uvThreadpoolSize);
+    }
+  }
+
+  // Adds the node options built from the startup options by index.js, and
+  // the modules to load before the main script, to node's arguments.
+  private void addNodeArguments(List<String> command, ReadableMap options)
+  {
+    final String EXEC_ARGV = "execArgv";
+    if( (options != null) &&
+        options.hasKey(EXEC_ARGV) &&
+        (options.getType(EXEC_ARGV) == ReadableType.Array)
+      ) {
+      ReadableArray execArgv = options.getArray(EXEC_ARGV);
+      for (int i = 0; i < execArgv.size(); i++) {
+        command.add(execArgv.getString(i));
+      }
+    }
+    if (extractCodeCacheOption(options)) {
+      command.add("-r");
+      command.add(builtinModulesPath + "/" + CODE_CACHE_PRELOAD);
+    }
+  }
+
   @ReactMethod
   public void startNodeWithScript(String script, ReadableMap options) throws Exception {
     // A New module instance may have been created due to hot reload.
@@ -147,21 +392,26 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
       _startedNodeAlready = true;
 
       final boolean redirectOutputToLogcat = extractRedirectOutputToLogcatOption(options);
-      final String scriptToRun = new String(script);
+      setRuntimeOptions(options);
+
+      final List<String> command = new ArrayList<String>();
+
+      command.add("node");
+      addNodeArguments(command, options);
+      command.add("-e");
+      command.add(script);
 
       new Thread(new Runnable() {
         @Override
         public void run() {
           waitForInit();
-          startNodeWithArguments(new String[]{"node",
-            "-e",
-            scriptToRun
-            },
+          startNodeWithArguments(
+            command.toArray(new String[0]),
             nodeJsProjectPath + ":" + builtinModulesPath,
             redirectOutputToLogcat
           );
         }
-      }).start();
+      }, START_THREAD_NAME).start();
     }
   }
 
@@ -173,19 +423,25 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
       _startedNodeAlready = true;
 
       final boolean redirectOutputToLogcat = extractRedirectOutputToLogcatOption(options);
+      setRuntimeOptions(options);
+
+      final List<String> command = new ArrayList<String>();
+
+      command.add("node");
+      addNodeArguments(command, options);
+      command.add(nodeJsProjectPath + "/" + mainFileName);
 
       new Thread(new Runnable() {
         @Override
         public void run() {
           waitForInit();
-          startNodeWithArguments(new String[]{"node",
-            nodeJsProjectPath + "/" + mainFileName
-            },
+          startNodeWithArguments(
+            command.toArray(new String[0]),
             nodeJsProjectPath + ":" + builtinModulesPath,
             redirectOutputToLogcat
           );
         }
-      }).start();
+      }, START_THREAD_NAME).start();
     }
   }
 
@@ -206,11 +462,13 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
       final List<String> command = new ArrayList<String>();
 
       command.add("node");
+      addNodeArguments(command, options);
       command.add(absoluteScriptPath);
 
       command.addAll(args);
 
       final boolean redirectOutputToLogcat = extractRedirectOutputToLogcatOption(options);
+      setRuntimeOptions(options);
 
       new Thread(new Runnable() {
         @Override
@@ -222,15 +480,119 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
             redirectOutputToLogcat
           );
         }
-      }).start();
+      }, START_THREAD_NAME).start();
+    }
+  }
+
+  @ReactMethod
+  public void stopNode() {
+    // Node's thread resets the started flag once the runtime is freed.
+    stopNodeRuntime();
+  }
+
+  // Starts a named environment next to the main runtime. Only the node
+  // options and the code cache apply to it, the other startup options being
+  // process-wide. Its exit is reported on its own system channel.
+  @ReactMethod
+  public void startEnvironment(final String name, final String mainFileName, ReadableMap options) {
+    // A New module instance may have been created due to hot reload.
+    _instance = this;
+
+    final boolean redirectOutputToLogcat = extractRedirectOutputToLogcatOption(options);
+    final List<String> command = new ArrayList<String>();
+
+    command.add("node");
+    addNodeArguments(command, options);
+    command.add(nodeJsProjectPath + "/" + mainFileName);
+
+    new Thread(new Runnable() {
+      @Override
+      public void run() {
+        waitForInit();
+        startEnvironmentThread(name, command.toArray(new String[0]), redirectOutputToLogcat);
+      }
+    }, START_THREAD_NAME).start();
+  }
+
+  // Starts the thread of a named environment, or reports its exit on its
+  // system channel, as its thread does, if the thread couldn't start.
+  private void startEnvironmentThread(String name, String[] arguments, boolean redirectOutputToLogcat) {
+    if (startNodeEnvironment(name, arguments, nodeJsProjectPath + ":" + builtinModulesPath, redirectOutputToLogcat) != 0) {
+      sendMessageToApplication(name + "/" + SYSTEM_CHANNEL, "exit|-1");
+    }
+  }
+
+  @ReactMethod
+  public void stopEnvironment(String name) {
+    stopNodeEnvironment(name);
+  }
+
+  // Starts the workers of the worker pool, each in its own environment.
+  // A size of 0 starts a worker per core. Resolves with the number of
+  // workers once the size is set; each worker then reports on its system
+  // channel that it's attached, or its exit.
+  @ReactMethod
+  public void startWorkerPool(int size, ReadableMap options, Promise promise) {
+    // A New module instance may have been created due to hot reload.
+    _instance = this;
+
+    final int poolSize = setWorkerPoolSize(size > 0 ? size : Runtime.getRuntime().availableProcessors());
+    if (poolSize < 0) {
+      promise.reject("EBUSY", "The workers of the previous worker pool are still running.");
+      return;
+    }
+    final boolean redirectOutputToLogcat = extractRedirectOutputToLogcatOption(options);
+    final List<List<String>> commands = new ArrayList<List<String>>();
+    for (int i = 0; i < poolSize; i++) {
+      final List<String> command = new ArrayList<String>();
+      command.add("node");
+      addNodeArguments(command, options);
+      command.add(builtinModulesPath + "/" + WORKER_POOL_SCRIPT);
+      command.add(String.valueOf(i));
+      command.add(nodeJsProjectPath);
+      commands.add(command);
+    }
+
+    new Thread(new Runnable() {
+      @Override
+      public void run() {
+        waitForInit();
+        for (int i = 0; i < commands.size(); i++) {
+          startEnvironmentThread(
+            WORKER_POOL_ENVIRONMENT_PREFIX + i,
+            commands.get(i).toArray(new String[0]),
+            redirectOutputToLogcat
+          );
+        }
+      }
+    }, START_THREAD_NAME).start();
+    promise.resolve(poolSize);
+  }
+
+  // Drops the jobs no worker has taken, and stops the workers.
+  @ReactMethod
+  public void stopWorkerPool(int size) {
+    clearWorkerPool();
+    for (int i = 0; i < size; i++) {
+      stopNodeEnvironment(WORKER_POOL_ENVIRONMENT_PREFIX + i);
     }
   }
 
+  @ReactMethod
+  public void submitPoolJob(String jobId, String module, String args, String replyChannel) {
+    submitWorkerPoolJob(jobId, module, args, replyChannel);
+  }
+
   @ReactMethod
   public void sendMessage(String channel, String msg) {
     sendMessageToNodeChannel(channel, msg);
   }
 
+  @ReactMethod
+  public void setChannelLatencyBudget(String channel, int budgetMs) {
+    setNodeChannelLatencyBudget(channel, budgetMs);
+  }
+
   // Sends an event through the App Event Emitter.
   private void sendEvent(String eventName,
                          @Nullable WritableMap params) {
@@ -254,10 +616,13 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
     if (nodeIsReadyForAppEvents) {
       sendMessageToNodeChannel(SYSTEM_CHANNEL, "pause");
     }
+    setBackgroundMode(true);
   }
 
   @Override
   public void onHostResume() {
+    // Restores the foreground latency before the resume event is handled.
+    setBackgroundMode(false);
     if (nodeIsReadyForAppEvents) {
       sendMessageToNodeChannel(SYSTEM_CHANNEL, "resume");
     }
@@ -280,7 +645,7 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
       final RNNodeJsMobileModule _moduleInstance = _instance;
       final String _channelNameToPass = new String(channelName);
       final String _msgToPass = new String(msg);
-      new Thread(new Runnable() {
+      bridgeExecutor.execute(new Runnable() {
         @Override
         public void run() {
           WritableMap params = Arguments.createMap();
@@ -288,18 +653,65 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
           params.putString("message", _msgToPass);
           _moduleInstance.sendEvent("nodejs-mobile-react-native-message", params);
         }
-      }).start();
+      });
     }
   }
 
-  public native void registerNodeDataDirPath(String dataDir);
+  public static native void registerNodeDataDirPath(String dataDir);
+
+  public static native void registerStartupSnapshot(String blobPath, String projectPath);
 
-  public native String getCurrentABIName();
+  public static native String getCurrentABIName();
 
   public native Integer startNodeWithArguments(String[] arguments, String modulesPath, boolean option_redirectOutputToLogcat);
 
+  public native boolean stopNodeRuntime();
+
+  public native int startNodeEnvironment(String name, String[] arguments, String modulesPath, boolean option_redirectOutputToLogcat);
+
+  public native boolean stopNodeEnvironment(String name);
+
+  public native int setWorkerPoolSize(int size);
+
+  public native void submitWorkerPoolJob(String jobId, String module, String args, String replyChannel);
+
+  public native int clearWorkerPool();
+
+  private static native boolean notifyMemoryPressure(int level);
+
+  private static native int prewarmNodeRuntime(String modulesPath);
+
+  public native void setStreamEntryScript(boolean enabled);
+
+  public native void setPlatformWorkerThreads(int count);
+
+  public native void setUvThreadpoolSize(int size);
+
+  public native void configureArrayBufferAllocator(boolean pooled, int limitMb);
+
+  public native boolean configureFlightRecorder(boolean enabled, int sizeKb, int payloadBytes);
+
+  public native void configureBackgroundMode(boolean enabled, boolean collectGarbage, int coalescingMs);
+
+  public native boolean setBackgroundMode(boolean background);
+
+  public native boolean configureThreads(String role, int stackSizeKb, String priority, double affinityMask);
+
+  private static native void applyThreadConfiguration(int role);
+
+  private static native long getThreadStackSize(int role);
+
   public native void sendMessageToNodeChannel(String channelName, String msg);
 
+  public native void setNodeChannelLatencyBudget(String channelName, int budgetMs);
+
+  // Called from JNI on Node's thread once the runtime has exited and been freed, so
+  // it can be started again.
+  private static void onNodeStopped() {
+    nodeIsReadyForAppEvents = false;
+    _startedNodeAlready = false;
+  }
+
   private void waitForInit() {
     if (!initCompleted) {
       try {
@@ -358,6 +770,18 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
     }
   }
 
+  // Copies the startup snapshot built for this ABI, if the app has one.
+  private void copyStartupSnapshot() throws IOException {
+    File snapshotDirReference = new File(startupSnapshotDirPath);
+    if (snapshotDirReference.exists()) {
+      deleteFolderRecursively(snapshotDirReference);
+    }
+    String[] snapshotFiles = assetManager.list(startupSnapshotAssetsPath);
+    if (snapshotFiles != null && snapshotFiles.length > 0) {
+      copyAssetFolder(startupSnapshotAssetsPath, startupSnapshotDirPath);
+    }
+  }
+
   private boolean copyNativeAssetsFrom() throws IOException {
     // Load the additional asset folder and files lists
     ArrayList<String> nativeDirs = readFileFromAssets(nativeAssetsPath + "/dir.list");
@@ -414,6 +838,8 @@ public class RNNodeJsMobileModule extends ReactContextBaseJavaModule implements
 
     copyNativeAssetsFrom();
 
+    copyStartupSnapshot();
+
     // Do the builtin-modules copy too.
     // If a previous built-in modules folder is present, delete it.
     File modulesDirReference = new File(builtinModulesPath);
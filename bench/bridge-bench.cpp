@@ -0,0 +1,332 @@
+#include "uv.h"
+#include "rn-bridge.h"
+#include "rn-runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Host benchmark of the bridge core.
+ *
+ * Runs bridge-bench.js in the embedded runtime and drives it through the
+ * "bench" channel. Each run sends a number of messages, either to Node from
+ * native producer threads, or to the application from the JavaScript main
+ * thread and worker threads, round-robin over the benchmark channels.
+ *
+ * Every message starts with the time it was sent, as RN_BENCH_STAMP_LENGTH
+ * hex digits of nanoseconds since the run's base time, both taken from
+ * uv_hrtime, which process.hrtime uses too. The receiving side takes the
+ * latency of each message from it. The producers send as fast as they can,
+ * so the latencies include the time messages wait in the queues.
+ */
+
+#ifndef RN_BENCH_SCRIPT
+#define RN_BENCH_SCRIPT "bridge-bench.js"
+#endif
+
+#define RN_BENCH_CONTROL_CHANNEL "bench"
+#define RN_BENCH_STAMP_LENGTH 11
+// Must match MAX_CHANNELS in bridge-bench.js.
+#define RN_BENCH_MAX_CHANNELS 1000
+
+namespace {
+
+enum class Direction { kToNode, kToApp };
+
+struct Run {
+    Direction direction;
+    size_t payload;
+    int channels;
+    int producers;
+    size_t count;
+};
+
+struct Result {
+    double elapsed_ms;
+    double p50_us;
+    double p99_us;
+};
+
+// Messages of the control channel from bridge-bench.js.
+std::mutex controlMutex;
+std::condition_variable controlCondition;
+std::deque<std::string> controlMessages;
+
+// State of the running to-app run, written by the threads sending to the
+// application.
+uint64_t runBase = 0;
+size_t runCount = 0;
+std::vector<uint64_t> latencies;
+std::atomic<size_t> received(0);
+std::atomic<uint64_t> lastReceived(0);
+std::mutex doneMutex;
+std::condition_variable doneCondition;
+
+uint64_t ParseStamp(const char* message) {
+    uint64_t value = 0;
+    for (int i = 0; i < RN_BENCH_STAMP_LENGTH && message[i] != '\0'; i++) {
+        char c = message[i];
+        value = value * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+    return value;
+}
+
+void WriteStamp(char* message, uint64_t offset_ns) {
+    char stamp[RN_BENCH_STAMP_LENGTH + 1];
+    snprintf(stamp, sizeof(stamp), "%0*llx", RN_BENCH_STAMP_LENGTH, (unsigned long long)offset_ns);
+    memcpy(message, stamp, RN_BENCH_STAMP_LENGTH);
+}
+
+void OnMessage(const char* channelName, const char* message) {
+    if (strcmp(channelName, RN_BENCH_CONTROL_CHANNEL) == 0) {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        controlMessages.push_back(message);
+        controlCondition.notify_one();
+        return;
+    }
+    uint64_t now = uv_hrtime();
+    size_t index = received.fetch_add(1);
+    if (index >= runCount) {
+        return;
+    }
+    uint64_t sent = runBase + ParseStamp(message);
+    latencies[index] = now > sent ? now - sent : 0;
+    uint64_t last = lastReceived.load();
+    while (now > last && !lastReceived.compare_exchange_weak(last, now)) {
+    }
+    if (index + 1 == runCount) {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        doneCondition.notify_one();
+    }
+}
+
+std::string WaitControl() {
+    std::unique_lock<std::mutex> lock(controlMutex);
+    controlCondition.wait(lock, [] { return !controlMessages.empty(); });
+    std::string message = controlMessages.front();
+    controlMessages.pop_front();
+    return message;
+}
+
+void SendControl(const std::string& message) {
+    rn_bridge_notify(RN_BENCH_CONTROL_CHANNEL, message.c_str());
+}
+
+std::string ChannelName(int index) {
+    return "bench-" + std::to_string(index);
+}
+
+double Percentile(std::vector<uint64_t>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(fraction * values.size());
+    index = std::min(values.size() - 1, index > 0 ? index - 1 : 0);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+void Produce(uint64_t base, size_t payload, int channels, size_t first, size_t count) {
+    std::vector<std::string> names;
+    for (int i = 0; i < channels; i++) {
+        names.push_back(ChannelName(i));
+    }
+    std::string message(std::max(payload, (size_t)RN_BENCH_STAMP_LENGTH), 'x');
+    for (size_t i = first; i < first + count; i++) {
+        WriteStamp(&message[0], uv_hrtime() - base);
+        rn_bridge_notify(names[i % channels].c_str(), message.c_str());
+    }
+}
+
+// bridge-bench.js takes the latencies of the messages to Node, and replies
+// "done|<time of the last message>|<p50 ns>|<p99 ns>".
+Result RunToNode(const Run& run) {
+    uint64_t base = uv_hrtime();
+    SendControl("arm|to-node|" + std::to_string(run.channels) + "|" + std::to_string(run.count) + "|" +
+                std::to_string(base));
+    WaitControl();
+
+    uint64_t start = uv_hrtime();
+    std::vector<std::thread> producers;
+    size_t share = run.count / run.producers;
+    for (int i = 0; i < run.producers; i++) {
+        size_t first = i * share;
+        size_t count = i + 1 == run.producers ? run.count - first : share;
+        producers.emplace_back(Produce, base, run.payload, run.channels, first, count);
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    std::string done = WaitControl();
+    unsigned long long last = 0;
+    double p50 = 0;
+    double p99 = 0;
+    sscanf(done.c_str(), "done|%llu|%lf|%lf", &last, &p50, &p99);
+    return { (last - start) / 1e6, p50 / 1000, p99 / 1000 };
+}
+
+Result RunToApp(const Run& run) {
+    SendControl("arm|to-app|" + std::to_string(run.channels) + "|" + std::to_string(run.count) + "|" +
+                std::to_string(run.payload) + "|" + std::to_string(run.producers));
+    WaitControl();
+
+    latencies.assign(run.count, 0);
+    runCount = run.count;
+    received = 0;
+    lastReceived = 0;
+    runBase = uv_hrtime();
+    SendControl("go|" + std::to_string(runBase));
+    {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [] { return received.load() >= runCount; });
+    }
+    // The workers are stopped before the next run.
+    WaitControl();
+
+    Result result = { (lastReceived.load() - runBase) / 1e6, 0, 0 };
+    result.p50_us = Percentile(latencies, 0.5);
+    result.p99_us = Percentile(latencies, 0.99);
+    return result;
+}
+
+void PrintResult(const Run& run, const Result& result) {
+    double seconds = result.elapsed_ms / 1000;
+    printf("%-8s %10zu %9d %10d %9zu %12.0f %10.1f %10.1f %10.1f\n",
+           run.direction == Direction::kToNode ? "to-node" : "to-app",
+           run.payload, run.channels, run.producers, run.count,
+           seconds > 0 ? run.count / seconds : 0,
+           seconds > 0 ? run.count * (double)run.payload / seconds / (1024 * 1024) : 0,
+           result.p50_us, result.p99_us);
+    fflush(stdout);
+}
+
+size_t MessageCount(size_t payload, size_t max_count, size_t max_bytes) {
+    return std::max((size_t)8, std::min(max_count, max_bytes / payload));
+}
+
+// Node's libuv requires all arguments in contiguous memory, which it keeps
+// pointing to after the runtime exits, so it's never freed.
+char** CopyArguments(const std::vector<std::string>& args) {
+    size_t size = 0;
+    for (const std::string& arg : args) {
+        size += arg.size() + 1;
+    }
+    char* buffer = (char*)calloc(size, sizeof(char));
+    char** argv = (char**)calloc(args.size() + 1, sizeof(char*));
+    char* position = buffer;
+    for (size_t i = 0; i < args.size(); i++) {
+        memcpy(position, args[i].c_str(), args[i].size() + 1);
+        argv[i] = position;
+        position += args[i].size() + 1;
+    }
+    return argv;
+}
+
+void Usage() {
+    fprintf(stderr,
+            "Usage: rn-bridge-bench [--quick] [--direction to-node|to-app] [--payload <bytes>]\n"
+            "         [--channels <count>] [--producers <count>] [--count <messages>] [--script <path>]\n"
+            "Runs the payload, channel and producer sweeps, or a single run if any of\n"
+            "--payload, --channels, --producers or --count is given.\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    bool quick = false;
+    bool single = false;
+    const char* script = RN_BENCH_SCRIPT;
+    std::vector<Direction> directions = { Direction::kToNode, Direction::kToApp };
+    Run custom = { Direction::kToNode, 256, 1, 1, 0 };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--direction" && has_value) {
+            std::string value = argv[++i];
+            if (value != "to-node" && value != "to-app") {
+                Usage();
+                return 1;
+            }
+            directions = { value == "to-node" ? Direction::kToNode : Direction::kToApp };
+        } else if (arg == "--payload" && has_value) {
+            custom.payload = std::max(1L, atol(argv[++i]));
+            single = true;
+        } else if (arg == "--channels" && has_value) {
+            custom.channels = std::min(RN_BENCH_MAX_CHANNELS, std::max(1, atoi(argv[++i])));
+            single = true;
+        } else if (arg == "--producers" && has_value) {
+            custom.producers = std::max(1, atoi(argv[++i]));
+            single = true;
+        } else if (arg == "--count" && has_value) {
+            custom.count = std::max(1L, atol(argv[++i]));
+            single = true;
+        } else if (arg == "--script" && has_value) {
+            script = argv[++i];
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+
+    size_t max_count = quick ? 10000 : 100000;
+    size_t max_bytes = (quick ? 32 : 256) * 1024 * 1024;
+    std::vector<Run> runs;
+    for (Direction direction : directions) {
+        if (single) {
+            Run run = custom;
+            run.direction = direction;
+            if (run.count == 0) {
+                run.count = MessageCount(run.payload, max_count, max_bytes);
+            }
+            runs.push_back(run);
+            continue;
+        }
+        for (size_t payload : { 16, 256, 4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 }) {
+            runs.push_back({ direction, payload, 1, 1, MessageCount(payload, max_count, max_bytes) });
+        }
+        for (int channels : { 1, 10, 100, 1000 }) {
+            runs.push_back({ direction, 256, channels, 1, max_count });
+        }
+        for (int producers : { 1, 2, 4, 8 }) {
+            runs.push_back({ direction, 256, 10, producers, max_count });
+        }
+    }
+
+    rn_register_bridge_cb(&OnMessage);
+    int exit_code = 0;
+    std::thread node([&exit_code, script] {
+        exit_code = rn_runtime_start(2, CopyArguments({ "node", script }));
+        // Unblocks the main thread if the script fails to start.
+        std::lock_guard<std::mutex> lock(controlMutex);
+        controlMessages.push_back("exit");
+        controlCondition.notify_one();
+    });
+
+    if (WaitControl() != "ready") {
+        node.join();
+        fprintf(stderr, "%s exited with code %d.\n", script, exit_code);
+        return 1;
+    }
+
+    printf("%-8s %10s %9s %10s %9s %12s %10s %10s %10s\n",
+           "", "payload", "channels", "producers", "messages", "msgs/s", "MB/s", "p50 (us)", "p99 (us)");
+    for (const Run& run : runs) {
+        PrintResult(run, run.direction == Direction::kToNode ? RunToNode(run) : RunToApp(run));
+    }
+
+    rn_runtime_stop();
+    node.join();
+    return 0;
+}
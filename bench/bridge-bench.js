@@ -0,0 +1,144 @@
+const {Worker, isMainThread, parentPort, workerData} = require('worker_threads');
+
+// Node side of rn-bridge-bench, see bridge-bench.cpp. It uses the rn_bridge
+// binding directly, so the runs measure the bridge core rather than the
+// rn-bridge module.
+//
+// Control messages on the "bench" channel:
+//   arm|to-node|<channels>|<count>|<base>  replies "ready", then
+//     "done|<time of the last message>|<p50 ns>|<p99 ns>" once <count>
+//     messages have arrived.
+//   arm|to-app|<channels>|<count>|<payload>|<producers>  replies "ready"
+//     once the producers are set up.
+//   go|<base>  sends the messages of the armed to-app run, then replies
+//     "stopped".
+
+const binding = process._linkedBinding('rn_bridge');
+
+const CONTROL_CHANNEL = 'bench';
+const MAX_CHANNELS = 1000; // Must match RN_BENCH_MAX_CHANNELS in bridge-bench.cpp.
+const STAMP_LENGTH = 11; // Must match RN_BENCH_STAMP_LENGTH in bridge-bench.cpp.
+
+function channelName(index) {
+  return 'bench-' + index;
+}
+
+// Sends `count` messages of `payload` bytes, starting at the `first` one,
+// stamped with their time since `base`.
+function produce(base, channels, first, count, payload) {
+  const padding = 'x'.repeat(Math.max(0, payload - STAMP_LENGTH));
+  const names = [];
+  for (let i = 0; i < channels; i++) {
+    names.push(channelName(i));
+  }
+  for (let i = first; i < first + count; i++) {
+    const stamp = Number(process.hrtime.bigint() - base).toString(16).padStart(STAMP_LENGTH, '0');
+    binding.sendMessage(names[i % channels], stamp + padding);
+  }
+}
+
+function percentile(sorted, fraction) {
+  const index = Math.max(0, Math.ceil(fraction * sorted.length) - 1);
+  return sorted[Math.min(sorted.length - 1, index)];
+}
+
+function main() {
+  const send = (message) => binding.sendMessage(CONTROL_CHANNEL, message);
+
+  // The to-node run.
+  let base = 0n;
+  let expected = 0;
+  let received = 0;
+  let latencies = new Float64Array(0);
+  const onMessage = (channel, message) => {
+    const now = process.hrtime.bigint();
+    if (received >= expected) {
+      return;
+    }
+    latencies[received++] = Number(now - base) - parseInt(message.slice(0, STAMP_LENGTH), 16);
+    if (received === expected) {
+      latencies.sort();
+      send('done|' + now + '|' + percentile(latencies, 0.5) + '|' + percentile(latencies, 0.99));
+    }
+  };
+  for (let i = 0; i < MAX_CHANNELS; i++) {
+    binding.registerChannel(channelName(i), onMessage);
+  }
+
+  // The to-app run.
+  let armed = null;
+  let workers = [];
+  const stopWorkers = () => {
+    workers.forEach((worker) => worker.terminate());
+    workers = [];
+  };
+
+  const armToApp = (channels, count, payload, producers) => {
+    armed = {channels, count, payload};
+    if (producers === 1) {
+      send('ready');
+      return;
+    }
+    const share = Math.floor(count / producers);
+    let pending = producers;
+    for (let i = 0; i < producers; i++) {
+      const first = i * share;
+      const worker = new Worker(__filename, {
+        workerData: {channels, first, count: i + 1 === producers ? count - first : share, payload},
+      });
+      worker.once('message', () => {
+        if (--pending === 0) {
+          send('ready');
+        }
+      });
+      workers.push(worker);
+    }
+  };
+
+  const go = (runBase) => {
+    if (workers.length === 0) {
+      produce(runBase, armed.channels, 0, armed.count, armed.payload);
+      send('stopped');
+      return;
+    }
+    let pending = workers.length;
+    workers.forEach((worker) => {
+      worker.once('message', () => {
+        if (--pending === 0) {
+          stopWorkers();
+          send('stopped');
+        }
+      });
+      worker.postMessage(runBase);
+    });
+  };
+
+  binding.registerChannel(CONTROL_CHANNEL, (channel, message) => {
+    const fields = message.split('|');
+    if (fields[0] === 'arm' && fields[1] === 'to-node') {
+      expected = parseInt(fields[3], 10);
+      base = BigInt(fields[4]);
+      received = 0;
+      latencies = new Float64Array(expected);
+      send('ready');
+    } else if (fields[0] === 'arm' && fields[1] === 'to-app') {
+      stopWorkers();
+      armToApp(...fields.slice(2, 6).map((field) => parseInt(field, 10)));
+    } else if (fields[0] === 'go') {
+      go(BigInt(fields[1]));
+    }
+  });
+  send('ready');
+}
+
+if (isMainThread) {
+  main();
+} else {
+  // A to-app producer: reports it's ready, then sends its share of the
+  // messages once it gets the base time.
+  parentPort.once('message', (base) => {
+    produce(base, workerData.channels, workerData.first, workerData.count, workerData.payload);
+    parentPort.postMessage('sent');
+  });
+  parentPort.postMessage('ready');
+}
@@ -0,0 +1,175 @@
+const fs = require('fs');
+const path = require('path');
+const {execFileSync} = require('child_process');
+
+// Generates a synthetic nodejs-project for the startup benchmark, with a
+// configurable number of modules, bytes of JavaScript and native addons.
+//
+// The modules form a tree that main.js requires from its root, each made of
+// functions that are only compiled when called, like most of the code of a
+// real project, and one that's called while the module loads. The addons
+// are copies of a minimal Node-API addon, built with the host's C compiler,
+// each loaded from its own file. main.js marks its start and the end of its
+// loading on the "startup-bench" channel, then requires rn-bridge, which
+// sends "ready-for-app-events". With `snapshot`, a snapshot.js bundle of the
+// same modules is generated too, for scripts/build-startup-snapshot.js.
+//
+// Usage: generate-startup-project.js <output dir> [--modules <count>]
+//   [--bytes <total JS bytes>] [--addons <count>] [--snapshot] [--cc <compiler>]
+
+const STARTUP_CHANNEL = 'startup-bench'; // Must match RN_STARTUP_CHANNEL in startup-bench.cpp.
+const NODE_HEADERS = path.join(__dirname, '..', 'android', 'libnode', 'include', 'node');
+
+const ADDON_SOURCE = `#include <node_api.h>
+
+NAPI_MODULE_INIT() {
+  return exports;
+}
+`;
+
+function functionSource(moduleIndex, index) {
+  const name = 'f' + moduleIndex + '_' + index;
+  return `function ${name}(input) {
+  const values = [];
+  for (let i = 0; i < input.length; i++) {
+    if (input[i] % ${(index % 7) + 2} === 0) {
+      values.push({index: i, value: input[i] * ${index + 1}, label: 'item-${moduleIndex}-${index}-' + i});
+    }
+  }
+  return values.reduce((sum, entry) => sum + entry.value, 0);
+}
+`;
+}
+
+// The children of module `index` in the tree are 2 * index + 1 and
+// 2 * index + 2.
+function moduleSource(index, count, size) {
+  const children = [2 * index + 1, 2 * index + 2].filter((child) => child < count);
+  let source = "'use strict';\n";
+  children.forEach((child) => {
+    source += `const m${child} = require('./m-${child}.js');\n`;
+  });
+  const functions = [];
+  while (functions.length === 0 || source.length < size) {
+    const body = functionSource(index, functions.length);
+    functions.push('f' + index + '_' + functions.length);
+    source += body;
+  }
+  const total = ['f' + index + '_0([1, 2, 3, 4, 5, 6, 7, 8])'].concat(children.map((child) => `m${child}.total`));
+  source += `module.exports = {${functions.join(', ')}, total: ${total.join(' + ')}};\n`;
+  return source;
+}
+
+function markSource() {
+  return `const binding = process._linkedBinding('rn_bridge');
+const mark = (name) => binding.sendMessage('${STARTUP_CHANNEL}', name + '|' + process.hrtime.bigint());
+`;
+}
+
+function mainSource(modules, addons) {
+  let source = "'use strict';\n" + markSource() + "mark('main');\n";
+  if (modules > 0) {
+    source += "require('./lib/m-0.js');\n";
+  }
+  for (let i = 0; i < addons; i++) {
+    source += `require('./addons/addon-${i}.node');\n`;
+  }
+  return source + "mark('loaded');\nrequire('rn-bridge');\n";
+}
+
+// A single-file bundle of the modules, loaded while the snapshot is built.
+// Its main function only loads the addons and rn-bridge.
+function snapshotSource(sources, addons) {
+  let source = "'use strict';\nconst v8 = require('v8');\nconst definitions = [\n";
+  sources.forEach((moduleSource) => {
+    source += 'function (module, exports, require) {\n' + moduleSource + '},\n';
+  });
+  source += `];
+const loaded = [];
+function load(index) {
+  if (!loaded[index]) {
+    loaded[index] = {exports: {}};
+    definitions[index](loaded[index], loaded[index].exports, (file) => load(Number(/m-(\\d+)\\.js$/.exec(file)[1])));
+  }
+  return loaded[index].exports;
+}
+if (definitions.length > 0) {
+  load(0);
+}
+v8.startupSnapshot.setDeserializeMainFunction(() => {
+${markSource()}  mark('main');
+  const projectRequire = require('module').createRequire(process.argv[1]);
+`;
+  for (let i = 0; i < addons; i++) {
+    source += `  projectRequire('./addons/addon-${i}.node');\n`;
+  }
+  return source + "  mark('loaded');\n  projectRequire('rn-bridge');\n});\n";
+}
+
+function generateProject(dir, options) {
+  const modules = Math.max(0, options.modules);
+  const size = modules > 0 ? Math.ceil(options.bytes / modules) : 0;
+  fs.mkdirSync(path.join(dir, 'lib'), {recursive: true});
+
+  const sources = [];
+  for (let i = 0; i < modules; i++) {
+    sources.push(moduleSource(i, modules, size));
+    fs.writeFileSync(path.join(dir, 'lib', 'm-' + i + '.js'), sources[i]);
+  }
+
+  if (options.addons > 0) {
+    const addonsDir = path.join(dir, 'addons');
+    fs.mkdirSync(addonsDir, {recursive: true});
+    fs.writeFileSync(path.join(addonsDir, 'addon.c'), ADDON_SOURCE);
+    const library = path.join(addonsDir, 'addon.so');
+    execFileSync(options.cc, ['-shared', '-fPIC', '-O2', '-I' + NODE_HEADERS, '-o', library, path.join(addonsDir, 'addon.c')], {
+      stdio: 'inherit',
+    });
+    // Separate files, so each addon is loaded on its own.
+    for (let i = 0; i < options.addons; i++) {
+      fs.copyFileSync(library, path.join(addonsDir, 'addon-' + i + '.node'));
+    }
+  }
+
+  fs.writeFileSync(path.join(dir, 'main.js'), mainSource(modules, options.addons));
+  if (options.snapshot) {
+    fs.writeFileSync(path.join(dir, 'snapshot.js'), snapshotSource(sources, options.addons));
+  }
+  return dir;
+}
+
+function parseOptions(args, options) {
+  const rest = [];
+  for (let i = 0; i < args.length; i++) {
+    if (args[i] === '--modules') {
+      options.modules = parseInt(args[++i], 10) || 0;
+    } else if (args[i] === '--bytes') {
+      options.bytes = parseInt(args[++i], 10) || 0;
+    } else if (args[i] === '--addons') {
+      options.addons = parseInt(args[++i], 10) || 0;
+    } else if (args[i] === '--snapshot') {
+      options.snapshot = true;
+    } else if (args[i] === '--cc') {
+      options.cc = args[++i];
+    } else {
+      rest.push(args[i]);
+    }
+  }
+  return rest;
+}
+
+const DEFAULT_OPTIONS = {modules: 200, bytes: 2 * 1024 * 1024, addons: 0, snapshot: false, cc: 'cc'};
+
+module.exports = {generateProject, parseOptions, DEFAULT_OPTIONS};
+
+if (require.main === module) {
+  const options = Object.assign({}, DEFAULT_OPTIONS);
+  const rest = parseOptions(process.argv.slice(2), options);
+  if (rest.length !== 1) {
+    console.error(
+      'Usage: generate-startup-project.js <output dir> [--modules <count>] [--bytes <total JS bytes>] [--addons <count>] [--snapshot] [--cc <compiler>]',
+    );
+    process.exit(1);
+  }
+  generateProject(path.resolve(rest[0]), options);
+}
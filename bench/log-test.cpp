@@ -0,0 +1,188 @@
+#include "rn-log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Host test of the log forwarder.
+ *
+ * Runs the forwarder's writer on a thread with a sink that records the
+ * lines it gets, and checks how the appended output is split into lines,
+ * leveled, rate limited and flushed.
+ */
+
+namespace {
+
+struct Line {
+    RNLogLevel level;
+    std::string message;
+};
+
+struct CapturingSink {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Line> lines;
+};
+
+void Capture(const RNLogRecord* records, size_t count, void* data) {
+    CapturingSink* sink = (CapturingSink*)data;
+    std::lock_guard<std::mutex> lock(sink->mutex);
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(records[i].message) != records[i].length) {
+            fprintf(stderr, "record length doesn't match its message\n");
+        }
+        sink->lines.push_back({ records[i].level, std::string(records[i].message, records[i].length) });
+    }
+    sink->changed.notify_all();
+}
+
+// A forwarder with one stream, whose writer runs until the test ends.
+struct Forwarder {
+    CapturingSink sink;
+    RNLogForwarder* forwarder;
+    int stream;
+    std::thread writer;
+
+    Forwarder(uint32_t lines_per_second, uint32_t burst_lines) {
+        this->forwarder = rn_log_create(Capture, &this->sink, lines_per_second, burst_lines);
+        this->stream = rn_log_add_stream(this->forwarder, RN_LOG_INFO, 64 * 1024);
+        this->writer = std::thread(rn_log_run, this->forwarder);
+    };
+
+    void append(const std::string& text) {
+        rn_log_append(this->forwarder, this->stream, text.data(), text.size());
+    };
+
+    // Returns the lines once there are at least `count`, or after `timeout`.
+    std::vector<Line> wait(size_t count, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(this->sink.mutex);
+        this->sink.changed.wait_for(lock, timeout, [&] { return this->sink.lines.size() >= count; });
+        return this->sink.lines;
+    };
+
+    std::vector<Line> stop() {
+        rn_log_stop(this->forwarder);
+        this->writer.join();
+        std::lock_guard<std::mutex> lock(this->sink.mutex);
+        return this->sink.lines;
+    };
+
+    ~Forwarder() {
+        if (this->writer.joinable()) {
+            this->stop();
+        }
+    };
+};
+
+int failures = 0;
+
+void Check(bool condition, const char* test, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAILED %s: %s\n", test, what);
+        failures++;
+    }
+}
+
+void CheckLines(const std::vector<Line>& lines, const std::vector<Line>& expected, const char* test) {
+    bool same = lines.size() == expected.size();
+    for (size_t i = 0; same && i < lines.size(); i++) {
+        same = lines[i].level == expected[i].level && lines[i].message == expected[i].message;
+    }
+    if (!same) {
+        fprintf(stderr, "FAILED %s: got %zu lines\n", test, lines.size());
+        for (const Line& line : lines) {
+            fprintf(stderr, "  %d %.80s (%zu bytes)\n", (int)line.level, line.message.c_str(), line.message.size());
+        }
+        failures++;
+    }
+}
+
+void TestLineSplitting() {
+    Forwarder forwarder(0, 0);
+    forwarder.append("first\nsec");
+    forwarder.append("ond\r\n\nthird");
+    CheckLines(forwarder.stop(), {
+        { RN_LOG_INFO, "first" },
+        { RN_LOG_INFO, "second" },
+        { RN_LOG_INFO, "" },
+        { RN_LOG_INFO, "third" },
+    }, "line splitting");
+}
+
+void TestLongLines() {
+    Forwarder forwarder(0, 0);
+    forwarder.append(std::string(9000, 'a') + "\n");
+    // A two byte sequence across the limit goes to the next line.
+    forwarder.append(std::string(RN_LOG_MAX_LINE_LENGTH - 1, 'b') + "\xC3\xA9" + "c\n");
+    CheckLines(forwarder.stop(), {
+        { RN_LOG_INFO, std::string(RN_LOG_MAX_LINE_LENGTH, 'a') },
+        { RN_LOG_INFO, std::string(RN_LOG_MAX_LINE_LENGTH, 'a') },
+        { RN_LOG_INFO, std::string(9000 - 2 * RN_LOG_MAX_LINE_LENGTH, 'a') },
+        { RN_LOG_INFO, std::string(RN_LOG_MAX_LINE_LENGTH - 1, 'b') },
+        { RN_LOG_INFO, "\xC3\xA9" "c" },
+    }, "long lines");
+}
+
+void TestLevels() {
+    Forwarder forwarder(0, 0);
+    forwarder.append("<0>emergency\n<3>error\n<4>warning\n<5>notice\n<6>info\n<7>debug\n<8>not a priority\n<3\n");
+    CheckLines(forwarder.stop(), {
+        { RN_LOG_ERROR, "emergency" },
+        { RN_LOG_ERROR, "error" },
+        { RN_LOG_WARN, "warning" },
+        { RN_LOG_INFO, "notice" },
+        { RN_LOG_INFO, "info" },
+        { RN_LOG_DEBUG, "debug" },
+        { RN_LOG_INFO, "<8>not a priority" },
+        { RN_LOG_INFO, "<3" },
+    }, "levels");
+}
+
+void TestRateLimit() {
+    Forwarder forwarder(1000, 2);
+    forwarder.append("1\n2\n3\n4\n5\n");
+    forwarder.wait(2, std::chrono::milliseconds(1000));
+    Check(rn_log_dropped_lines(forwarder.forwarder) == 3, "rate limit", "3 lines counted as dropped");
+    // Refills the bucket.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    forwarder.append("6\n");
+    CheckLines(forwarder.stop(), {
+        { RN_LOG_INFO, "1" },
+        { RN_LOG_INFO, "2" },
+        { RN_LOG_WARN, "3 log lines dropped" },
+        { RN_LOG_INFO, "6" },
+    }, "rate limit");
+}
+
+void TestPartialLineFlush() {
+    Forwarder forwarder(0, 0);
+    auto start = std::chrono::steady_clock::now();
+    forwarder.append("no line break");
+    std::vector<Line> lines = forwarder.wait(1, std::chrono::milliseconds(2000));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    CheckLines(lines, { { RN_LOG_INFO, "no line break" } }, "partial line flush");
+    Check(elapsed >= std::chrono::milliseconds(100), "partial line flush", "waited 100 ms for the rest of the line");
+    Check(elapsed < std::chrono::milliseconds(1000), "partial line flush", "flushed without more output");
+}
+
+}  // namespace
+
+int main() {
+    TestLineSplitting();
+    TestLongLines();
+    TestLevels();
+    TestRateLimit();
+    TestPartialLineFlush();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("log forwarder tests passed\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "uv.h"
+#include "rn-bridge.h"
+#include "rn-runtime.h"
+#include "rn-threads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+/**
+ * Startup benchmark launcher.
+ *
+ * Starts a nodejs-project the way native-lib.cpp does: NODE_PATH set to the
+ * project and the built-in modules, the data directory registered, and
+ * rn_runtime_start called on a Node thread started by rn_thread_start. The
+ * first run of the process is a cold start, the next ones restart the
+ * runtime in the same process. Prints one JSON object per run, with the
+ * duration of each startup phase up to "ready-for-app-events", in ms:
+ *   processInit  until the process-wide initialization is done
+ *   environment  until the isolate, context and Environment are created
+ *   bootstrap    until the main script starts, including the -r modules
+ *   modules      until the main script has loaded its modules
+ *   ready        until rn-bridge sends "ready-for-app-events"
+ * The main script marks its start and the end of its loading with "main"
+ * and "loaded" messages on the RN_STARTUP_CHANNEL channel, as the projects
+ * of bench/generate-startup-project.js do. Phases that didn't run, e.g.
+ * the process initialization of a restart, are null.
+ */
+
+#ifndef RN_BENCH_BUILTIN_MODULES
+#define RN_BENCH_BUILTIN_MODULES "builtin_modules"
+#endif
+
+#define RN_STARTUP_CHANNEL "startup-bench"
+#define RN_STARTUP_TIMEOUT_SECONDS 120
+
+namespace {
+
+const char kSystemChannel[] = "_SYSTEM_";
+const char kReadyMessage[] = "ready-for-app-events";
+const char kCodeCachePreload[] = "code-cache/index.js";
+
+struct NodeThreadArgs {
+    std::vector<std::string> args;
+};
+
+// Marks of the current run, from the bridge callback.
+std::mutex runMutex;
+std::condition_variable runCondition;
+uint64_t mainMark = 0;
+uint64_t loadedMark = 0;
+uint64_t readyMark = 0;
+bool nodeExited = false;
+int nodeExitCode = 0;
+
+void OnMessage(const char* channelName, const char* message) {
+    uint64_t now = uv_hrtime();
+    std::lock_guard<std::mutex> lock(runMutex);
+    if (strcmp(channelName, kSystemChannel) == 0 && strcmp(message, kReadyMessage) == 0) {
+        readyMark = now;
+        runCondition.notify_all();
+    } else if (strcmp(channelName, RN_STARTUP_CHANNEL) == 0) {
+        // "<mark>|<process.hrtime.bigint()>"
+        const char* separator = strchr(message, '|');
+        uint64_t time = separator != nullptr ? strtoull(separator + 1, nullptr, 10) : now;
+        if (strncmp(message, "main|", 5) == 0) {
+            mainMark = time;
+        } else if (strncmp(message, "loaded|", 7) == 0) {
+            loadedMark = time;
+        }
+    }
+}
+
+// Node's libuv requires all arguments in contiguous memory, which it keeps
+// pointing to after the runtime exits, so it's never freed.
+char** CopyArguments(const std::vector<std::string>& args) {
+    size_t size = 0;
+    for (const std::string& arg : args) {
+        size += arg.size() + 1;
+    }
+    char* buffer = (char*)calloc(size, sizeof(char));
+    char** argv = (char**)calloc(args.size() + 1, sizeof(char*));
+    char* position = buffer;
+    for (size_t i = 0; i < args.size(); i++) {
+        memcpy(position, args[i].c_str(), args[i].size() + 1);
+        argv[i] = position;
+        position += args[i].size() + 1;
+    }
+    return argv;
+}
+
+void* NodeThread(void* arg) {
+    NodeThreadArgs* thread_args = (NodeThreadArgs*)arg;
+    int argc = (int)thread_args->args.size();
+    char** argv = CopyArguments(thread_args->args);
+    delete thread_args;
+    int exit_code = rn_runtime_start(argc, argv);
+    std::lock_guard<std::mutex> lock(runMutex);
+    nodeExited = true;
+    nodeExitCode = exit_code;
+    runCondition.notify_all();
+    return 0;
+}
+
+// A phase as "<ms>" from the previous mark that was set, or "null".
+std::string Phase(uint64_t mark, uint64_t& previous) {
+    if (mark == 0 || previous == 0) {
+        return "null";
+    }
+    char value[32];
+    snprintf(value, sizeof(value), "%.3f", mark > previous ? (mark - previous) / 1e6 : 0.0);
+    previous = mark;
+    return value;
+}
+
+void Usage() {
+    fprintf(stderr,
+            "Usage: rn-startup-bench <nodejs-project> [--main <file>] [--runs <count>] [--code-cache]\n"
+            "         [--stream-entry-script] [--snapshot <blob>] [--data-dir <dir>]\n"
+            "         [--settle-ms <ms>] [--builtin-modules <dir>]\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argv[1][0] == '-') {
+        Usage();
+        return 1;
+    }
+    std::string project = argv[1];
+    std::string main_file = "main.js";
+    std::string builtin_modules = RN_BENCH_BUILTIN_MODULES;
+    std::string data_dir = project + "/../data";
+    std::string snapshot;
+    bool code_cache = false;
+    bool stream_entry_script = false;
+    int runs = 1;
+    int settle_ms = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--main" && has_value) {
+            main_file = argv[++i];
+        } else if (arg == "--runs" && has_value) {
+            runs = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--code-cache") {
+            code_cache = true;
+        } else if (arg == "--stream-entry-script") {
+            stream_entry_script = true;
+        } else if (arg == "--snapshot" && has_value) {
+            snapshot = argv[++i];
+        } else if (arg == "--data-dir" && has_value) {
+            data_dir = argv[++i];
+        } else if (arg == "--settle-ms" && has_value) {
+            settle_ms = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--builtin-modules" && has_value) {
+            builtin_modules = argv[++i];
+        } else {
+            Usage();
+            return 1;
+        }
+    }
+
+    // As the Java and iOS sides do before starting Node.
+    std::string node_path = project + ":" + builtin_modules;
+    setenv("NODE_PATH", node_path.c_str(), 1);
+    rn_register_node_data_dir_path(data_dir.c_str());
+    rn_register_bridge_cb(&OnMessage);
+    rn_runtime_set_stream_entry_script(stream_entry_script);
+    if (!snapshot.empty()) {
+        rn_runtime_set_startup_snapshot(snapshot.c_str(), project.c_str());
+    }
+
+    for (int run = 0; run < runs; run++) {
+        NodeThreadArgs* thread_args = new NodeThreadArgs();
+        thread_args->args.push_back("node");
+        if (code_cache) {
+            thread_args->args.push_back("-r");
+            thread_args->args.push_back(builtin_modules + "/" + kCodeCachePreload);
+        }
+        thread_args->args.push_back(project + "/" + main_file);
+
+        {
+            std::lock_guard<std::mutex> lock(runMutex);
+            mainMark = loadedMark = readyMark = 0;
+            nodeExited = false;
+        }
+        uint64_t launched = uv_hrtime();
+        if (rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_MAIN, NodeThread, thread_args) != 0) {
+            fprintf(stderr, "Couldn't start the Node thread.\n");
+            delete thread_args;
+            return 1;
+        }
+
+        std::unique_lock<std::mutex> lock(runMutex);
+        bool ready = runCondition.wait_for(lock, std::chrono::seconds(RN_STARTUP_TIMEOUT_SECONDS),
+                                           [] { return readyMark != 0 || nodeExited; });
+        if (!ready || readyMark == 0) {
+            fprintf(stderr, nodeExited ? "Node.js exited with code %d before it was ready.\n"
+                                       : "Node.js wasn't ready in time.\n", nodeExitCode);
+            return 1;
+        }
+        uint64_t main_mark = mainMark;
+        uint64_t loaded_mark = loadedMark;
+        uint64_t ready_mark = readyMark;
+        lock.unlock();
+
+        RNStartupTimes times;
+        rn_runtime_get_startup_times(&times);
+        bool booted_from_snapshot = times.process_initialized == 0 && times.environment_created == 0;
+        uint64_t previous = launched;
+        std::string process_init = Phase(times.process_initialized, previous);
+        std::string environment = Phase(times.environment_created, previous);
+        std::string bootstrap = Phase(main_mark, previous);
+        std::string modules = Phase(loaded_mark, previous);
+        std::string ready_phase = Phase(ready_mark, previous);
+        printf("{\"run\":%d,\"snapshot\":%s,\"processInit\":%s,\"environment\":%s,\"bootstrap\":%s,"
+               "\"modules\":%s,\"ready\":%s,\"total\":%.3f}\n",
+               run, booted_from_snapshot ? "true" : "false", process_init.c_str(), environment.c_str(),
+               bootstrap.c_str(), modules.c_str(), ready_phase.c_str(), (ready_mark - launched) / 1e6);
+        fflush(stdout);
+
+        // Lets the project finish its startup work, e.g. writing its code cache.
+        std::this_thread::sleep_for(std::chrono::milliseconds(settle_ms));
+        if (booted_from_snapshot) {
+            // A runtime booted from a snapshot can't be stopped or restarted.
+            _exit(0);
+        }
+        rn_runtime_stop();
+        lock.lock();
+        runCondition.wait(lock, [] { return nodeExited; });
+    }
+    return 0;
+}
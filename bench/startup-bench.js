@@ -0,0 +1,208 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const {spawnSync} = require('child_process');
+const {generateProject, parseOptions, DEFAULT_OPTIONS} = require('./generate-startup-project');
+
+// Startup benchmark. Generates a synthetic nodejs-project, or uses the one
+// given, and starts it with rn-startup-bench in each startup mode: a new
+// process for each cold start, followed by warm restarts of the runtime in
+// the same process. Prints the median of each startup phase, and writes
+// every run and the summary as JSON.
+//
+// Modes:
+//   default              a plain start
+//   code-cache           the codeCache startup option, once the cache was
+//                        written by a first launch, which is reported too
+//   stream-entry-script  the streamEntryScript startup option
+//   snapshot             a startup snapshot, built with --snapshot-node, a
+//                        desktop node binary of the same version as libnode;
+//                        cold starts only, as the runtime can't restart
+//
+// Usage: startup-bench.js <rn-startup-bench> [--project <dir>] [--modules <count>]
+//   [--bytes <total JS bytes>] [--addons <count>] [--cold <runs>] [--warm <runs>]
+//   [--modes <mode,...>] [--snapshot-node <node>] [--output <file>]
+
+const MODES = ['default', 'code-cache', 'stream-entry-script', 'snapshot'];
+// Longer than FLUSH_DELAY_MS in code-cache/index.js, so the cache is written.
+const CODE_CACHE_SETTLE_MS = 4000;
+const PHASES = ['processInit', 'environment', 'bootstrap', 'modules', 'ready', 'total'];
+const SCRIPTS_DIR = path.join(__dirname, '..', 'scripts');
+const NODE_HEADERS = path.join(__dirname, '..', 'android', 'libnode', 'include', 'node');
+
+function readNodeVersion() {
+  const header = fs.readFileSync(path.join(NODE_HEADERS, 'node_version.h'), 'utf8');
+  const part = (name) => header.match(new RegExp('#define ' + name + ' (\\d+)'))[1];
+  return [part('NODE_MAJOR_VERSION'), part('NODE_MINOR_VERSION'), part('NODE_PATCH_VERSION')].join('.');
+}
+
+function percentile(values, fraction) {
+  const sorted = values.filter((value) => value !== null).sort((a, b) => a - b);
+  if (sorted.length === 0) {
+    return null;
+  }
+  return sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil(fraction * sorted.length) - 1))];
+}
+
+function launch(launcher, args) {
+  const result = spawnSync(launcher, args, {encoding: 'utf8', stdio: ['ignore', 'pipe', 'inherit']});
+  const runs = result.stdout
+    .split('\n')
+    .filter((line) => line.startsWith('{"run"'))
+    .map((line) => JSON.parse(line));
+  if (result.status !== 0 || runs.length === 0) {
+    throw new Error('rn-startup-bench ' + args.join(' ') + ' failed with status ' + result.status + '.');
+  }
+  return runs;
+}
+
+// Builds the snapshot as an application build does, for this host's ABI.
+function buildSnapshot(project, outputDir, node) {
+  const quote = (arg) => "'" + arg.replace(/'/g, "'\\''") + "'";
+  const builder = 'sh -c \'exec "$0" --snapshot-blob "$3" --build-snapshot "$2"\' ' + quote(node);
+  const result = spawnSync(
+    process.execPath,
+    [path.join(SCRIPTS_DIR, 'build-startup-snapshot.js'), 'unknown', project, NODE_HEADERS, outputDir, builder],
+    {stdio: 'inherit'},
+  );
+  if (result.status !== 0) {
+    throw new Error('The startup snapshot build failed.');
+  }
+  return path.join(outputDir, 'startup.blob');
+}
+
+function benchmark(launcher, options) {
+  const workDir = fs.mkdtempSync(path.join(os.tmpdir(), 'rn-startup-bench-'));
+  const project = options.project || generateProject(path.join(workDir, 'nodejs-project'), options.generator);
+  const results = [];
+  const record = (mode, runs, firstKind) => {
+    runs.forEach((run, index) => {
+      results.push(Object.assign({mode, kind: index === 0 ? firstKind : 'warm'}, run));
+    });
+  };
+
+  options.modes.forEach((mode) => {
+    const dataDir = path.join(workDir, 'data-' + mode);
+    fs.mkdirSync(dataDir, {recursive: true});
+    const args = [project, '--data-dir', dataDir];
+    let warm = options.warm;
+    if (mode === 'code-cache') {
+      args.push('--code-cache');
+      record(mode, launch(launcher, args.concat(['--settle-ms', String(CODE_CACHE_SETTLE_MS)])), 'first-launch');
+    } else if (mode === 'stream-entry-script') {
+      args.push('--stream-entry-script');
+    } else if (mode === 'snapshot') {
+      args.push('--snapshot', buildSnapshot(project, path.join(workDir, 'snapshot'), options.snapshotNode));
+      warm = 0;
+    }
+    for (let i = 0; i < options.cold; i++) {
+      const runs = launch(launcher, args.concat(['--runs', String(1 + warm)]));
+      if (mode === 'snapshot' && !runs[0].snapshot) {
+        throw new Error('The runtime started without the snapshot.');
+      }
+      record(mode, runs, 'cold');
+    }
+  });
+
+  const summary = [];
+  options.modes.forEach((mode) => {
+    ['first-launch', 'cold', 'warm'].forEach((kind) => {
+      const runs = results.filter((run) => run.mode === mode && run.kind === kind);
+      if (runs.length === 0) {
+        return;
+      }
+      const entry = {mode, kind, runs: runs.length};
+      PHASES.forEach((phase) => {
+        entry[phase] = percentile(runs.map((run) => run[phase]), 0.5);
+      });
+      entry.totalP90 = percentile(runs.map((run) => run.total), 0.9);
+      summary.push(entry);
+    });
+  });
+  return {project, results, summary};
+}
+
+function printSummary(summary) {
+  const format = (value) => (value === null ? '-' : value.toFixed(1));
+  const columns = ['mode', 'kind', 'runs'].concat(PHASES, ['totalP90']);
+  const rows = summary.map((entry) =>
+    columns.map((column) => (typeof entry[column] === 'string' || column === 'runs' ? String(entry[column]) : format(entry[column]))),
+  );
+  const widths = columns.map((column, i) => Math.max(column.length, ...rows.map((row) => row[i].length)));
+  const line = (cells) => cells.map((cell, i) => (i < 2 ? cell.padEnd(widths[i]) : cell.padStart(widths[i]))).join('  ');
+  console.log('Median phase durations, in ms:');
+  console.log(line(columns));
+  rows.forEach((row) => console.log(line(row)));
+}
+
+const args = process.argv.slice(2);
+const generator = Object.assign({}, DEFAULT_OPTIONS);
+const rest = parseOptions(args, generator);
+const options = {
+  generator,
+  project: null,
+  cold: 5,
+  warm: 5,
+  modes: ['default', 'code-cache', 'stream-entry-script'],
+  snapshotNode: null,
+  output: 'startup-bench-results.json',
+};
+const positional = [];
+for (let i = 0; i < rest.length; i++) {
+  if (rest[i] === '--project') {
+    options.project = path.resolve(rest[++i]);
+  } else if (rest[i] === '--cold') {
+    options.cold = Math.max(1, parseInt(rest[++i], 10) || 1);
+  } else if (rest[i] === '--warm') {
+    options.warm = Math.max(0, parseInt(rest[++i], 10) || 0);
+  } else if (rest[i] === '--modes') {
+    options.modes = rest[++i].split(',');
+  } else if (rest[i] === '--snapshot-node') {
+    options.snapshotNode = path.resolve(rest[++i]);
+  } else if (rest[i] === '--output') {
+    options.output = rest[++i];
+  } else {
+    positional.push(rest[i]);
+  }
+}
+if (options.snapshotNode && !args.includes('--modes')) {
+  options.modes.push('snapshot');
+}
+generator.snapshot = options.modes.includes('snapshot');
+
+const invalidMode = options.modes.find((mode) => !MODES.includes(mode));
+if (positional.length !== 1 || invalidMode || (generator.snapshot && !options.snapshotNode)) {
+  if (invalidMode) {
+    console.error('Unknown mode: ' + invalidMode + '.');
+  } else if (positional.length === 1) {
+    console.error('The snapshot mode needs --snapshot-node.');
+  }
+  console.error(
+    'Usage: startup-bench.js <rn-startup-bench> [--project <dir>] [--modules <count>] [--bytes <total JS bytes>]\n' +
+      '  [--addons <count>] [--cold <runs>] [--warm <runs>] [--modes <mode,...>] [--snapshot-node <node>] [--output <file>]',
+  );
+  process.exit(1);
+}
+
+const report = benchmark(path.resolve(positional[0]), options);
+printSummary(report.summary);
+fs.writeFileSync(
+  options.output,
+  JSON.stringify(
+    {
+      nodeVersion: readNodeVersion(),
+      config: {
+        project: report.project,
+        generated: options.project ? null : generator,
+        cold: options.cold,
+        warm: options.warm,
+        modes: options.modes,
+      },
+      summary: report.summary,
+      runs: report.results,
+    },
+    null,
+    2,
+  ),
+);
+console.log('Results written to ' + options.output + '.');
@@ -18,7 +18,88 @@ declare module "@comapeo/nodejs-mobile-react-native" {
      * @param options 
      */
     startWithScript: (scriptBody: string, options?: StartupOptions) => void
+    /**
+     * Stops the nodejs-mobile runtime. It can be started again once stopped
+     */
+    stop: () => void
     channel: Channel;
+    /**
+     * Returns the channel with the given name, shared with `rn_bridge.createChannel(name)`
+     * @param name must not start with `_` nor contain `/`
+     * @param options
+     */
+    createChannel: (name: string, options?: ChannelOptions) => Channel
+    /**
+     * Starts a file inside the nodejs-project directory in a new named environment,
+     * running next to the main runtime on its own thread
+     * @param name must not start with `_` nor contain `/`
+     * @param scriptFileName
+     * @param options only the Node options and `codeCache` apply
+     */
+    startEnvironment: (name: string, scriptFileName: string, options?: StartupOptions) => Environment
+    /**
+     * Starts the worker pool, with a worker per core if size is 0 or missing
+     * @param size from 0 to 64
+     * @param options only the Node options and `codeCache` apply
+     * @returns the number of workers
+     */
+    startWorkerPool: (size?: number, options?: StartupOptions) => Promise<number>
+    workerPool: WorkerPool;
+    profiler: Profiler;
+    tracing: Tracing;
+    capture: Capture;
+  }
+  export interface Tracing {
+    /**
+     * Starts recording the lifecycle of every message crossing the bridge
+     */
+    start: () => void
+    /**
+     * Stops recording. The recorded events can still be dumped
+     */
+    stop: () => void
+    /**
+     * Writes the recorded events as Chrome trace-event JSON inside the data directory.
+     * The path is raised as a `'trace'` event on `rn_bridge.app` in the nodejs-mobile side
+     */
+    dump: () => void
+  }
+  export interface Capture {
+    /**
+     * Starts writing every message crossing the bridge, with its time, to a file inside the data directory
+     */
+    start: () => void
+    /**
+     * Ends the capture. The file path is raised as a `'capture'` event on `rn_bridge.app` in the nodejs-mobile side
+     */
+    stop: () => void
+  }
+  export interface Profiler {
+    /**
+     * Starts the continuous sampling profiler of the nodejs-mobile runtime
+     * @param options
+     */
+    start: (options?: ProfilerOptions) => void
+    /**
+     * Stops sampling. The samples collected so far can still be dumped
+     */
+    stop: () => void
+    /**
+     * Writes the samples of the last minutes to a folded stacks file inside the data directory.
+     * The path is raised as a `'profile'` event on `rn_bridge.app` in the nodejs-mobile side
+     * @param minutes defaults to the history kept by the profiler
+     */
+    dump: (minutes?: number) => void
+  }
+
+  /**
+   * Optional options for `profiler.start`
+   */
+  export interface ProfilerOptions {
+    /** Samples per second, from 1 to 100. Defaults to 20 */
+    frequency?: number
+    /** Minutes of history to keep, from 1 to 30. Defaults to 5 */
+    minutes?: number
   }
   export interface Channel {
     /**
@@ -53,6 +134,58 @@ declare module "@comapeo/nodejs-mobile-react-native" {
      * @param message can be of type: `boolean`, `number`, `string`, `object`, or `array`
      */
     send: (...message: any[]) => void;
+    /**
+     * Lets the messages posted to the nodejs-mobile side wait up to `budgetMs`
+     * to be delivered together, 0 to deliver each right away
+     * @param budgetMs from 0 to 60000
+     */
+    setLatencyBudget: (budgetMs: number) => void;
+  }
+
+  export interface Environment {
+    environmentName: string;
+    /**
+     * The environment's `rn_bridge.channel`
+     */
+    channel: Channel;
+    /**
+     * Whether the environment was started and hasn't exited yet
+     */
+    running: boolean;
+    /**
+     * Returns the channel with the given name, shared with the environment's `rn_bridge.createChannel(name)`
+     */
+    createChannel: (name: string, options?: ChannelOptions) => Channel
+    /**
+     * Stops the environment, which then emits `exit`
+     */
+    stop: () => void
+    addListener: (event: "exit", callback: (exitCode: number) => void) => void
+    removeListener: (event: "exit", callback: (exitCode: number) => void) => void
+  }
+
+  export interface WorkerPool {
+    /**
+     * Number of workers, once started
+     */
+    size: number;
+    /**
+     * Calls the function exported by a module of the nodejs-project with the given arguments in a worker
+     * @param modulePath relative to the nodejs-project
+     * @returns the function's result
+     */
+    run: (modulePath: string, ...args: any[]) => Promise<any>
+    /**
+     * Stops the workers, rejecting the jobs that haven't completed
+     */
+    stop: () => void
+  }
+
+  export interface ChannelOptions {
+    /**
+     * How long messages to the nodejs-mobile side may wait to be delivered together, in ms
+     */
+    latencyBudgetMs?: number
   }
 
   /**
@@ -68,6 +201,98 @@ declare module "@comapeo/nodejs-mobile-react-native" {
    */
   export interface StartupOptions {
     redirectOutputToLogcat?: boolean
+    codeCache?: boolean
+    streamEntryScript?: boolean
+    /**
+     * Maximum size of the V8 old generation heap, in MB (`--max-old-space-size`)
+     */
+    maxOldSpaceSizeMb?: number
+    /**
+     * Maximum size of a V8 young generation semi-space, in MB (`--max-semi-space-size`)
+     */
+    maxSemiSpaceSizeMb?: number
+    /**
+     * Runs V8 without generating executable code (`--jitless`)
+     */
+    jitless?: boolean
+    /**
+     * Makes V8 favour memory use over speed (`--lite-mode`)
+     */
+    liteMode?: boolean
+    /**
+     * Runs the V8 garbage collector on the Node thread only (`--single-threaded-gc`)
+     */
+    singleThreadedGc?: boolean
+    /**
+     * Compiles functions only when they are first called (`--max-lazy`)
+     */
+    maxLazy?: boolean
+    /**
+     * Number of threads of the libuv threadpool (`UV_THREADPOOL_SIZE`)
+     */
+    uvThreadpoolSize?: number
+    /**
+     * Number of worker threads of the V8 platform
+     */
+    platformWorkerThreads?: number
+    /**
+     * Allocates ArrayBuffer memory from pools of reusable blocks
+     */
+    pooledArrayBuffers?: boolean
+    /**
+     * Most memory used by ArrayBuffers and Buffers, in MB
+     */
+    arrayBufferLimitMb?: number
+    /**
+     * Records the latest bridge messages, log lines and runtime events to a file
+     */
+    flightRecorder?: boolean
+    /**
+     * Size of the flight recording file, in KB. Defaults to 1024
+     */
+    flightRecorderSizeKb?: number
+    /**
+     * Bytes of each message's payload that are recorded. Defaults to 64
+     */
+    flightRecorderPayloadBytes?: number
+    /**
+     * Runs the runtime in background mode while the application is in the background
+     */
+    backgroundMode?: boolean
+    /**
+     * Runs a full garbage collection when entering background mode
+     */
+    backgroundGc?: boolean
+    /**
+     * Delay of the messages to Node while in background mode, in ms. Defaults to 1000
+     */
+    backgroundCoalescingMs?: number
+    /**
+     * Stack size, priority and CPU affinity of the threads of each role
+     */
+    threads?: {
+      node?: ThreadOptions
+      logForwarding?: ThreadOptions
+      bridge?: ThreadOptions
+    }
+  }
+
+  /**
+   * Configuration of the threads of a role
+   */
+  export interface ThreadOptions {
+    /**
+     * Stack size in KB, from 64 to 65536
+     */
+    stackSizeKb?: number
+    /**
+     * Scheduling priority: a QoS class on iOS, a nice value on Android
+     */
+    priority?: 'background' | 'utility' | 'default' | 'userInitiated' | 'userInteractive'
+    /**
+     * CPUs the threads may run on, from 0 to 31. Ignored on iOS
+     */
+    cpuAffinity?: number[]
   }
 
   const nodejs: NodeJs
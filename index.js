@@ -3,6 +3,7 @@ import { NativeModules, NativeAppEventEmitter } from 'react-native';
 var EventEmitter = require('react-native/Libraries/vendor/emitter/EventEmitter').default;
 
 const EVENT_CHANNEL = '_EVENTS_';
+const SYSTEM_CHANNEL = '_SYSTEM_';
 
 var channels = {};
 
@@ -18,6 +19,10 @@ class MessageCodec {
   constructor(_event, ..._payload) {
     this.event = _event;
     this.payload = JSON.stringify(_payload);
+    if (MessageCodec.tracing) {
+      // Wall clock time in microseconds, lines up with the native trace events.
+      this.ts = Date.now() * 1000;
+    }
   };
 
   // Serialize the message payload and the message.
@@ -37,6 +42,9 @@ class MessageCodec {
   };
 };
 
+// When set, serialized messages carry their send timestamp for tracing.
+MessageCodec.tracing = false;
+
 /**
  * Channel super class.
  */
@@ -56,6 +64,8 @@ class ChannelSuper extends EventEmitter {
 
 const { RNNodeJsMobile } = NativeModules;
 
+const MAX_LATENCY_BUDGET_MS = 60000;
+
 /**
  * Events channel class that supports user defined event types with
  * optional arguments. Allows to send any serializable
@@ -73,6 +83,15 @@ class EventChannel extends ChannelSuper {
     this.post('message', ...msg);
   };
 
+  // Lets the messages posted to Node wait up to budgetMs to be delivered
+  // together, 0 to deliver each right away.
+  setLatencyBudget(budgetMs) {
+    if (!Number.isInteger(budgetMs) || budgetMs < 0 || budgetMs > MAX_LATENCY_BUDGET_MS) {
+      throw new RangeError('nodejs-mobile-react-native: the latency budget must be an integer from 0 to ' + MAX_LATENCY_BUDGET_MS + '.');
+    }
+    RNNodeJsMobile.setChannelLatencyBudget(this.name, budgetMs);
+  };
+
   processData(data) {
     // The data contains the serialized message envelope.
     var envelope = MessageCodec.deserialize(data);
@@ -80,11 +99,127 @@ class EventChannel extends ChannelSuper {
   };
 };
 
+/*
+ * The options accepted by the start methods. Tuning options with a `flag`
+ * are passed to Node as command line options, in `execArgv`; the native
+ * side applies the others.
+ */
+const STARTUP_OPTIONS = {
+  redirectOutputToLogcat: { type: 'boolean' },
+  codeCache: { type: 'boolean' },
+  streamEntryScript: { type: 'boolean' },
+  maxOldSpaceSizeMb: { type: 'integer', min: 16, flag: '--max-old-space-size=' },
+  maxSemiSpaceSizeMb: { type: 'integer', min: 1, max: 256, flag: '--max-semi-space-size=' },
+  jitless: { type: 'boolean', flag: '--jitless' },
+  liteMode: { type: 'boolean', flag: '--lite-mode' },
+  singleThreadedGc: { type: 'boolean', flag: '--single-threaded-gc' },
+  maxLazy: { type: 'boolean', flag: '--max-lazy' },
+  uvThreadpoolSize: { type: 'integer', min: 1, max: 1024 },
+  platformWorkerThreads: { type: 'integer', min: 1, max: 32 },
+  pooledArrayBuffers: { type: 'boolean' },
+  arrayBufferLimitMb: { type: 'integer', min: 1 },
+  flightRecorder: { type: 'boolean' },
+  flightRecorderSizeKb: { type: 'integer', min: 64, max: 65536 },
+  flightRecorderPayloadBytes: { type: 'integer', min: 0, max: 192 },
+  threads: { type: 'threads' },
+  backgroundMode: { type: 'boolean' },
+  backgroundGc: { type: 'boolean' },
+  backgroundCoalescingMs: { type: 'integer', min: 0, max: 60000 },
+};
+
+const THREAD_ROLES = ['node', 'logForwarding', 'bridge'];
+const THREAD_PRIORITIES = ['background', 'utility', 'default', 'userInitiated', 'userInteractive'];
+const MAX_CPU = 31;
+
+// Validates the threads option and turns each CPU affinity into a mask.
+const normalizeThreadOptions=function(threads) {
+  const prefix = 'nodejs-mobile-react-native: startup option "threads';
+  if (typeof threads !== 'object') {
+    throw new TypeError(prefix + '" must be an object.');
+  }
+  const normalized = {};
+  Object.keys(threads).forEach(function(role) {
+    const thread = threads[role];
+    if (THREAD_ROLES.indexOf(role) === -1) {
+      // Possibly a role of a later version: ignored, like unknown options.
+      console.warn(prefix + '" has an unknown thread role "' + role + '", which is ignored.');
+      return;
+    }
+    if (thread === undefined || thread === null) {
+      return;
+    }
+    if (typeof thread !== 'object') {
+      throw new TypeError(prefix + '.' + role + '" must be an object.');
+    }
+    const config = {};
+    if (thread.stackSizeKb !== undefined) {
+      if (!Number.isInteger(thread.stackSizeKb) || thread.stackSizeKb < 64 || thread.stackSizeKb > 65536) {
+        throw new RangeError(prefix + '.' + role + '.stackSizeKb" must be an integer from 64 to 65536.');
+      }
+      config.stackSizeKb = thread.stackSizeKb;
+    }
+    if (thread.priority !== undefined) {
+      if (THREAD_PRIORITIES.indexOf(thread.priority) === -1) {
+        throw new TypeError(prefix + '.' + role + '.priority" must be one of ' + THREAD_PRIORITIES.join(', ') + '.');
+      }
+      config.priority = thread.priority;
+    }
+    if (thread.cpuAffinity !== undefined) {
+      if (!Array.isArray(thread.cpuAffinity) || thread.cpuAffinity.length === 0 ||
+          !thread.cpuAffinity.every(function(cpu) { return Number.isInteger(cpu) && cpu >= 0 && cpu <= MAX_CPU; })) {
+        throw new RangeError(prefix + '.' + role + '.cpuAffinity" must be a non-empty array of CPU indexes from 0 to ' + MAX_CPU + '.');
+      }
+      // Sent as a number, which holds the 32 bits exactly.
+      config.affinityMask = thread.cpuAffinity.filter(function(cpu, i, cpus) { return cpus.indexOf(cpu) === i; })
+        .reduce(function(mask, cpu) { return mask + Math.pow(2, cpu); }, 0);
+    }
+    normalized[role] = config;
+  });
+  return normalized;
+};
+
+// Validates the startup options and returns the options for the native side.
+// Unknown options are ignored with a warning.
+const normalizeStartupOptions=function(options) {
+  options = options || {};
+  const normalized = { execArgv: [] };
+  Object.keys(options).forEach(function(name) {
+    const value = options[name];
+    const spec = STARTUP_OPTIONS[name];
+    if (!spec) {
+      // Possibly an option of a later version, so it doesn't fail the start.
+      console.warn('nodejs-mobile-react-native: unknown startup option "' + name + '", which is ignored.');
+      return;
+    }
+    if (value === undefined || value === null) {
+      return;
+    }
+    if (spec.type === 'boolean' && typeof value !== 'boolean') {
+      throw new TypeError('nodejs-mobile-react-native: startup option "' + name + '" must be a boolean.');
+    }
+    if (spec.type === 'integer' && (!Number.isInteger(value) ||
+        value < spec.min || (spec.max !== undefined && value > spec.max))) {
+      throw new RangeError('nodejs-mobile-react-native: startup option "' + name + '" must be an integer ' +
+        (spec.max !== undefined ? 'from ' + spec.min + ' to ' + spec.max : 'of at least ' + spec.min) + '.');
+    }
+    if (spec.type === 'threads') {
+      normalized[name] = normalizeThreadOptions(value);
+    } else if (!spec.flag) {
+      normalized[name] = value;
+    } else if (spec.type === 'integer') {
+      normalized.execArgv.push(spec.flag + value);
+    } else if (value) {
+      normalized.execArgv.push(spec.flag);
+    }
+  });
+  return normalized;
+};
+
 const start=function(mainFileName, options) {
   if (typeof mainFileName !== 'string') {
     throw new Error('nodejs-mobile-react-native\'s start expects to receive the main .js entrypoint filename, e.g.: nodejs.start("main.js");');
   }
-  options = options || {};
+  options = normalizeStartupOptions(options);
   RNNodeJsMobile.startNodeProject(mainFileName, options);
 };
 
@@ -92,15 +227,69 @@ const startWithArgs=function(command, options) {
   if (typeof command !== 'string') {
     throw new Error('nodejs-mobile-react-native\'s startWithArgs expects to receive the main .js entrypoint filename with optional arguments, e.g.: nodejs.startWithArgs("main.js -c custom");');
   }
-  options = options || {};
+  options = normalizeStartupOptions(options);
   RNNodeJsMobile.startNodeProjectWithArgs(command, options);
 };
 
 const startWithScript=function(script, options) {
-  options = options || {};
+  options = normalizeStartupOptions(options);
   RNNodeJsMobile.startNodeWithScript(script, options);
 }
 
+// Stops the Node runtime. It can be started again once it has stopped.
+const stop=function() {
+  RNNodeJsMobile.stopNode();
+};
+
+/*
+ * Controls the continuous sampling profiler of the Node runtime.
+ * The commands are sent through the system channel and handled by rn-bridge.
+ */
+const profiler = {
+  start: function(options) {
+    options = options || {};
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL,
+      'profiler-start|' + (options.frequency || '') + '|' + (options.minutes || ''));
+  },
+  stop: function() {
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'profiler-stop');
+  },
+  dump: function(minutes) {
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'profiler-dump|' + (minutes || ''));
+  }
+};
+
+/*
+ * Controls the capture of the bridge traffic, which the Node side writes to
+ * a file that can be replayed on a host.
+ */
+const capture = {
+  start: function() {
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'capture-start');
+  },
+  stop: function() {
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'capture-stop');
+  }
+};
+
+/*
+ * Controls the tracing of bridge message lifecycles. The trace is written
+ * as Chrome trace-event JSON by the Node side of the bridge.
+ */
+const tracing = {
+  start: function() {
+    MessageCodec.tracing = true;
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'trace-start');
+  },
+  stop: function() {
+    MessageCodec.tracing = false;
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'trace-stop');
+  },
+  dump: function() {
+    RNNodeJsMobile.sendMessage(SYSTEM_CHANNEL, 'trace-dump');
+  }
+};
+
 /*
  * Dispatcher for all channels. This event is called by the plug-in
  * native code to deliver events from Node.
@@ -121,6 +310,317 @@ function registerChannel(channel) {
   channels[channel.name] = channel;
 };
 
+function unregisterChannel(channel) {
+  if (channels[channel.name] === channel) {
+    delete channels[channel.name];
+  }
+};
+
+const NAMESPACE_SEPARATOR = '/';
+
+// Channel and environment names are used as prefixes of the native channel
+// names, so they can't contain the namespace separator.
+const checkName=function(kind, name) {
+  if (typeof name !== 'string' || name.length === 0 || name.startsWith('_') ||
+      name.indexOf(NAMESPACE_SEPARATOR) !== -1) {
+    throw new TypeError('nodejs-mobile-react-native: ' + kind + ' names must be non-empty strings not starting with "_" nor containing "' + NAMESPACE_SEPARATOR + '".');
+  }
+};
+
+const getOrCreateChannel=function(name, options) {
+  var channel = channels[name];
+  if (!channel) {
+    channel = new EventChannel(name);
+    registerChannel(channel);
+  }
+  if (options && options.latencyBudgetMs !== undefined) {
+    channel.setLatencyBudget(options.latencyBudgetMs);
+  }
+  return channel;
+};
+
+// Returns the channel named `name`, created by the first call. The Node side
+// gets the same channel with rn_bridge.createChannel(name).
+const createChannel=function(name, options) {
+  checkName('channel', name);
+  return getOrCreateChannel(name, options);
+};
+
+/*
+ * A named Node environment, running next to the main one on its own thread.
+ * Its channels are namespaced by its name, so rn_bridge works unchanged in
+ * its scripts. Registered as the environment's system channel, to emit
+ * 'exit' with the exit code once the environment has stopped.
+ */
+class Environment extends ChannelSuper {
+  constructor(name) {
+    super(name + NAMESPACE_SEPARATOR + SYSTEM_CHANNEL);
+    this.environmentName = name;
+    this.channel = getOrCreateChannel(name + NAMESPACE_SEPARATOR + EVENT_CHANNEL);
+    this.running = false;
+  };
+
+  createChannel(name, options) {
+    checkName('channel', name);
+    return getOrCreateChannel(this.environmentName + NAMESPACE_SEPARATOR + name, options);
+  };
+
+  stop() {
+    RNNodeJsMobile.stopEnvironment(this.environmentName);
+  };
+
+  processData(data) {
+    // The other system messages are for the main runtime only.
+    if (data.startsWith('exit|')) {
+      this.running = false;
+      this.emitLocal('exit', parseInt(data.substring('exit|'.length), 10));
+    } else if (data === POOL_ATTACHED_MESSAGE) {
+      this.emitLocal('attached');
+    }
+  };
+};
+
+// Starts mainFileName in a new environment named `name`. Only the node
+// options and codeCache apply, the other startup options being process-wide.
+// An environment can be started again with the same name once it has exited.
+const startEnvironment=function(name, mainFileName, options) {
+  checkName('environment', name);
+  if (typeof mainFileName !== 'string') {
+    throw new Error('nodejs-mobile-react-native\'s startEnvironment expects to receive the environment name and its main .js entrypoint filename, e.g.: nodejs.startEnvironment("worker", "worker.js");');
+  }
+  options = normalizeStartupOptions(options);
+  var environment = channels[name + NAMESPACE_SEPARATOR + SYSTEM_CHANNEL];
+  if (!environment) {
+    environment = new Environment(name);
+    registerChannel(environment);
+  } else if (environment.running) {
+    throw new Error('nodejs-mobile-react-native: the environment "' + name + '" is already running.');
+  }
+  environment.running = true;
+  RNNodeJsMobile.startEnvironment(name, mainFileName, options);
+  return environment;
+};
+
+const POOL_CHANNEL = '_POOL_';
+// Must match RN_POOL_ENVIRONMENT_PREFIX in rn-pool.h.
+const POOL_ENVIRONMENT_PREFIX = '_pool';
+const MAX_POOL_SIZE = 64;
+// Must match RN_POOL_ATTACHED_MESSAGE in rn-pool.h.
+const POOL_ATTACHED_MESSAGE = 'pool-attached';
+
+/*
+ * Pool of Node environments running CPU-bound jobs, each on its own
+ * thread. The native side queues the jobs on the workers, which steal from
+ * each other when idle. Registered as the reply channel of the jobs.
+ */
+class WorkerPool extends ChannelSuper {
+  constructor() {
+    super(POOL_CHANNEL);
+    this.size = 0;
+    this._workers = [];
+    // 'starting', 'attached' or 'exited', for each worker of the last start.
+    this._states = [];
+    this._exitCodes = [];
+    this._onStateChange = null;
+    this._nextJobId = 1;
+    this._pending = new Map();
+    this._starting = null;
+    this._stopping = null;
+  };
+
+  // Starts `size` workers, one per core if 0 or missing. Returns a promise
+  // of the number of workers, resolved once they all take jobs, or rejected
+  // if one of them exits first, which stops the others.
+  start(size, options) {
+    if (size === undefined || size === null) {
+      size = 0;
+    }
+    if (!Number.isInteger(size) || size < 0 || size > MAX_POOL_SIZE) {
+      throw new RangeError('nodejs-mobile-react-native: the worker pool size must be an integer from 0 to ' + MAX_POOL_SIZE + '.');
+    }
+    if (this._starting !== null) {
+      throw new Error('nodejs-mobile-react-native: the worker pool is already started.');
+    }
+    options = normalizeStartupOptions(options);
+    // A restart waits for the workers of the previous start to exit.
+    const previous = this._stopping || Promise.resolve();
+    const starting = previous.then(() => {
+      // Registered before the start, so no message of the workers is missed.
+      const count = size > 0 ? size : MAX_POOL_SIZE;
+      this._workers = [];
+      this._states = [];
+      for (let i = 0; i < count; i++) {
+        this._workers.push(this._worker(i));
+        this._states.push('starting');
+      }
+      return RNNodeJsMobile.startWorkerPool(size, options).catch((err) => {
+        this._releaseWorkers(0);
+        this._states = [];
+        throw err;
+      });
+    }).then((poolSize) => {
+      this.size = poolSize;
+      this._releaseWorkers(poolSize);
+      this._states.length = poolSize;
+      return this._waitFor(() => {
+        const failed = this._states.indexOf('exited');
+        if (failed !== -1) {
+          throw new Error('nodejs-mobile-react-native: worker ' + failed + ' of the worker pool exited with code ' +
+            this._exitCodes[failed] + ' before it started.');
+        }
+        return this._states.every((state) => state === 'attached');
+      });
+    }).then(() => this.size);
+    this._starting = starting;
+    starting.catch(() => {
+      if (this._starting === starting) {
+        this.stop();
+      }
+    });
+    return starting;
+  };
+
+  // Runs the function exported by modulePath, relative to the
+  // nodejs-project, with `args` in a worker. Returns a promise of its result.
+  run(modulePath, ...args) {
+    if (this._starting === null) {
+      throw new Error('nodejs-mobile-react-native: the worker pool is not started.');
+    }
+    if (typeof modulePath !== 'string') {
+      throw new TypeError('nodejs-mobile-react-native: the worker pool expects a module path, e.g.: nodejs.workerPool.run("hash.js", data);');
+    }
+    const id = String(this._nextJobId++);
+    const serializedArgs = JSON.stringify(args);
+    const starting = this._starting;
+    return new Promise((resolve, reject) => {
+      this._pending.set(id, { resolve: resolve, reject: reject });
+      // Submitted once the pool has its size. A failed start rejects the job.
+      starting.then(() => {
+        if (this._pending.has(id)) {
+          RNNodeJsMobile.submitPoolJob(id, modulePath, serializedArgs, this.name);
+        }
+      }, () => {});
+    });
+  };
+
+  // Stops the workers. The jobs that haven't completed are rejected. A
+  // start that follows waits for the workers to exit.
+  stop() {
+    if (this._starting === null) {
+      return;
+    }
+    const starting = this._starting;
+    this._starting = null;
+    this._rejectPending('the worker pool was stopped.');
+    const stopping = starting.catch(() => {}).then(() => {
+      RNNodeJsMobile.stopWorkerPool(this._states.length);
+      return this._waitFor(() => this._states.every((state) => state === 'exited'));
+    }).then(() => {
+      if (this._stopping === stopping) {
+        this._stopping = null;
+      }
+    });
+    this._stopping = stopping;
+  };
+
+  // The environment of worker `index`.
+  _worker(index) {
+    const name = POOL_ENVIRONMENT_PREFIX + index;
+    let worker = channels[name + NAMESPACE_SEPARATOR + SYSTEM_CHANNEL];
+    if (!worker) {
+      worker = new Environment(name);
+      registerChannel(worker);
+      worker.addListener('attached', () => this._onWorkerState(index, 'attached'));
+      worker.addListener('exit', (code) => {
+        this._exitCodes[index] = code;
+        this._onWorkerState(index, 'exited');
+      });
+    }
+    worker.running = true;
+    return worker;
+  };
+
+  // Forgets the environments registered for the workers from `index` on,
+  // which weren't started.
+  _releaseWorkers(index) {
+    for (let i = index; i < this._workers.length; i++) {
+      this._workers[i].running = false;
+      unregisterChannel(this._workers[i]);
+    }
+    this._workers.length = Math.min(index, this._workers.length);
+  };
+
+  _onWorkerState(index, state) {
+    if (index >= this._states.length) {
+      return;
+    }
+    this._states[index] = state;
+    if (state === 'attached' && this._starting === null) {
+      // Started while the pool was being stopped.
+      this._workers[index].stop();
+    }
+    // With no worker left, the pending jobs would never complete.
+    if (state === 'exited' && this._states.every((workerState) => workerState === 'exited')) {
+      this._rejectPending('the workers of the worker pool exited.');
+    }
+    if (this._onStateChange !== null) {
+      this._onStateChange();
+    }
+  };
+
+  // Returns a promise resolved once `check` returns true, or rejected with
+  // what it throws, checked now and whenever a worker's state changes.
+  _waitFor(check) {
+    return new Promise((resolve, reject) => {
+      const onStateChange = () => {
+        let done;
+        try {
+          done = check();
+        } catch (err) {
+          this._onStateChange = null;
+          reject(err);
+          return;
+        }
+        if (done) {
+          this._onStateChange = null;
+          resolve();
+        }
+      };
+      this._onStateChange = onStateChange;
+      onStateChange();
+    });
+  };
+
+  _rejectPending(reason) {
+    const pending = this._pending;
+    this._pending = new Map();
+    pending.forEach((job) => job.reject(new Error('nodejs-mobile-react-native: ' + reason)));
+  };
+
+  processData(data) {
+    const reply = JSON.parse(data);
+    const job = this._pending.get(reply.id);
+    if (!job) {
+      return;
+    }
+    this._pending.delete(reply.id);
+    if (reply.error !== undefined) {
+      job.reject(new Error(reply.error));
+    } else {
+      job.resolve(reply.result);
+    }
+  };
+};
+
+const workerPool = new WorkerPool();
+registerChannel(workerPool);
+
+// Starts the worker pool. Only the node options and codeCache of `options`
+// apply to its workers.
+const startWorkerPool=function(size, options) {
+  return workerPool.start(size, options);
+};
+
 const eventChannel = new EventChannel(EVENT_CHANNEL);
 registerChannel(eventChannel);
 
@@ -128,7 +628,15 @@ const export_object = {
   start: start,
   startWithArgs: startWithArgs,
   startWithScript: startWithScript,
-  channel: eventChannel
+  stop: stop,
+  channel: eventChannel,
+  createChannel: createChannel,
+  startEnvironment: startEnvironment,
+  startWorkerPool: startWorkerPool,
+  workerPool: workerPool,
+  profiler: profiler,
+  tracing: tracing,
+  capture: capture
 };
 
 module.exports = export_object;
@@ -0,0 +1,211 @@
+const crypto = require('crypto');
+const fs = require('fs');
+const Module = require('module');
+const path = require('path');
+const vm = require('vm');
+const NativeBridge = process._linkedBinding('rn_bridge');
+
+/**
+ * Persistent V8 code cache for CommonJS modules.
+ * Loaded with `-r` before the main script when the `codeCache` startup
+ * option is set. Modules are compiled with the V8 code cache stored for
+ * their source, so unchanged modules skip parsing and compiling on the next
+ * launches. Missing or rejected cache entries are written in the background
+ * once startup is over, never while modules are being loaded.
+ */
+
+// Delay after the last module load before cache entries are written.
+const FLUSH_DELAY_MS = 3000;
+// Cache entries written per event loop turn while flushing.
+const FLUSH_BATCH_SIZE = 8;
+// Entries of other builds and entries unused for this long are deleted.
+const MAX_UNUSED_AGE_MS = 30 * 24 * 60 * 60 * 1000;
+
+// Cached data can only be used by the V8 version and CPU that produced it.
+const cacheDir = path.join(
+  NativeBridge.getDataDir(),
+  'nodejs-code-cache',
+  'v8-' + process.versions.v8 + '-' + process.arch,
+);
+
+const stats = {
+  hits: 0,
+  misses: 0,
+  rejected: 0,
+  written: 0,
+  errors: 0,
+};
+
+// Scripts whose cache entry has to be (re)written, by cache key.
+const pending = new Map();
+// Cache keys used by this run.
+const used = new Set();
+var pruned = false;
+var flushTimer = null;
+
+function cacheFile(key) {
+  return path.join(cacheDir, key + '.cache');
+}
+
+function readCache(key) {
+  try {
+    return fs.readFileSync(cacheFile(key));
+  } catch (err) {
+    return undefined;
+  }
+}
+
+function scheduleFlush() {
+  if (flushTimer !== null) {
+    clearTimeout(flushTimer);
+  }
+  // Startup is considered over once no module was loaded for a while.
+  flushTimer = setTimeout(flush, FLUSH_DELAY_MS);
+  // Writing the cache must never keep the process alive.
+  flushTimer.unref();
+}
+
+function flush() {
+  flushTimer = null;
+  fs.mkdir(cacheDir, {recursive: true}, (err) => {
+    if (err) {
+      stats.errors++;
+      return;
+    }
+    writeBatch();
+    if (!pruned) {
+      pruned = true;
+      prune();
+    }
+  });
+}
+
+function prune() {
+  const parentDir = path.dirname(cacheDir);
+  fs.readdir(parentDir, (err, dirs) => {
+    if (err) return;
+    for (const dir of dirs) {
+      if (path.join(parentDir, dir) !== cacheDir) {
+        fs.rm(path.join(parentDir, dir), {recursive: true, force: true}, () => {});
+      }
+    }
+  });
+  fs.readdir(cacheDir, (err, files) => {
+    if (err) return;
+    const now = Date.now();
+    for (const file of files) {
+      if (used.has(path.basename(file, '.cache'))) continue;
+      const filePath = path.join(cacheDir, file);
+      fs.stat(filePath, (err, stat) => {
+        if (!err && now - stat.mtimeMs > MAX_UNUSED_AGE_MS) {
+          fs.unlink(filePath, () => {});
+        }
+      });
+    }
+  });
+}
+
+function writeBatch() {
+  const keys = Array.from(pending.keys()).slice(0, FLUSH_BATCH_SIZE);
+  for (const key of keys) {
+    const script = pending.get(key);
+    pending.delete(key);
+    // Created after the module ran, so the functions it compiled lazily
+    // are included too.
+    const data = script.createCachedData();
+    const file = cacheFile(key);
+    const temporaryFile = file + '.' + process.pid + '.tmp';
+    fs.writeFile(temporaryFile, data, (err) => {
+      if (err) {
+        stats.errors++;
+        return;
+      }
+      fs.rename(temporaryFile, file, (err) => {
+        if (err) {
+          stats.errors++;
+        } else {
+          stats.written++;
+        }
+      });
+    });
+  }
+  if (pending.size > 0) {
+    setImmediate(writeBatch).unref();
+  }
+}
+
+// Same as the require function Node.js gives to CommonJS modules.
+function makeRequire(mod) {
+  const require = function require(id) {
+    return mod.require(id);
+  };
+  require.resolve = function resolve(request, options) {
+    return Module._resolveFilename(request, mod, false, options);
+  };
+  require.resolve.paths = function paths(request) {
+    return Module._resolveLookupPaths(request, mod);
+  };
+  require.main = process.mainModule;
+  require.extensions = Module._extensions;
+  require.cache = Module._cache;
+  return require;
+}
+
+const originalCompile = Module.prototype._compile;
+
+Module.prototype._compile = function (content, filename) {
+  // Scripts compiled with vm.Script can't use import(), so modules that do
+  // are compiled by Node.js itself.
+  if (!path.isAbsolute(filename) || content.includes('import(')) {
+    return originalCompile.call(this, content, filename);
+  }
+
+  // A hashbang is only valid at the very start of a script, not inside the
+  // module wrapper. The line is kept so line numbers don't change.
+  const wrapper = Module.wrap(content.replace(/^#!.*/, ''));
+  const key = crypto.createHash('sha1').update(wrapper).digest('hex');
+  const cachedData = readCache(key);
+  used.add(key);
+
+  const script = new vm.Script(wrapper, {
+    filename: filename,
+    cachedData: cachedData,
+  });
+  if (cachedData === undefined) {
+    stats.misses++;
+    pending.set(key, script);
+  } else if (script.cachedDataRejected) {
+    // Produced by other V8 flags, or corrupted.
+    stats.rejected++;
+    pending.set(key, script);
+  } else {
+    stats.hits++;
+  }
+  if (pending.size > 0) {
+    scheduleFlush();
+  }
+
+  const compiledWrapper = script.runInThisContext({displayErrors: true});
+  const dirname = path.dirname(filename);
+  return compiledWrapper.call(
+    this.exports,
+    this.exports,
+    makeRequire(this),
+    this,
+    filename,
+    dirname,
+  );
+};
+
+module.exports = exports = {
+  // Returns the cache hits, misses and rejections of this run, and the
+  // number of entries written so far.
+  stats: function () {
+    return Object.assign({pending: pending.size}, stats);
+  },
+  // Deletes all the cache entries.
+  clear: function () {
+    pending.clear();
+    fs.rmSync(path.dirname(cacheDir), {recursive: true, force: true});
+  },
+};
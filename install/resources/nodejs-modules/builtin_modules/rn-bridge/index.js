@@ -1,5 +1,8 @@
 
 const EventEmitter = require('events');
+const fs = require('fs');
+const path = require('path');
+const workerThreads = require('worker_threads');
 const NativeBridge = process._linkedBinding('rn_bridge');
 
 /**
@@ -15,6 +18,12 @@ const EVENT_CHANNEL = '_EVENTS_';
  */
 const SYSTEM_CHANNEL = '_SYSTEM_';
 
+/**
+ * Environment data key of the namespace of the environment's channels,
+ * inherited by the worker threads.
+ */
+const NAMESPACE_KEY = 'rn_bridge:namespace';
+
 /**
  * This class is defined in the plugin's root index.js as well.
  * Any change made here should be ported to the root index.js too.
@@ -27,6 +36,10 @@ class MessageCodec {
   constructor(_event, ..._payload) {
     this.event = _event;
     this.payload = JSON.stringify(_payload);
+    if (MessageCodec.tracing) {
+      // Wall clock time in microseconds, lines up with the native trace events.
+      this.ts = Date.now() * 1000;
+    }
   };
 
   // Serialize the message payload and the message.
@@ -46,6 +59,9 @@ class MessageCodec {
   };
 };
 
+// When set, serialized messages carry their send timestamp for tracing.
+MessageCodec.tracing = false;
+
 /**
  * Channel super class.
  */
@@ -78,7 +94,8 @@ class ChannelSuper extends EventEmitter {
  */
 class EventChannel extends ChannelSuper {
   post(event, ...msg) {
-    NativeBridge.sendMessage(this.name, MessageCodec.serialize(event, ...msg));
+    // Replies posted from a traced message handler continue its trace.
+    NativeBridge.sendMessage(this.name, MessageCodec.serialize(event, ...msg), currentTraceId);
   };
 
   // Posts a 'message' event, to be backward compatible with old code.
@@ -86,10 +103,58 @@ class EventChannel extends ChannelSuper {
     this.post('message', ...msg);
   };
 
-  processData(data) {
+  // Sends a string as is, without the event envelope the React Native side
+  // expects. Meant for channels with native listeners.
+  sendRaw(message) {
+    if (typeof message !== 'string') {
+      throw new TypeError('rn-bridge: sendRaw expects a string.');
+    }
+    NativeBridge.sendMessage(this.name, message, currentTraceId);
+  };
+
+  processData(data, traceId) {
+    if (data instanceof ArrayBuffer) {
+      this.processBuffer(data, traceId);
+      return;
+    }
     // The data contains the serialized message envelope.
     var envelope = MessageCodec.deserialize(data);
-    this.emitWrapper(envelope.event, ...(envelope.payload));
+    if (traceId) {
+      this.emitTraced(traceId, envelope);
+    } else {
+      this.emitWrapper(envelope.event, ...(envelope.payload));
+    }
+  };
+
+  // A buffer sent by native code with rn_bridge_send_buffer, over the
+  // producer's memory. release() hands it back to the producer right away,
+  // which otherwise happens once it's garbage collected.
+  processBuffer(arrayBuffer, traceId) {
+    const release = () => NativeBridge.releaseBuffer(arrayBuffer);
+    const envelope = {event: 'buffer', payload: [Buffer.from(arrayBuffer), release]};
+    if (traceId) {
+      this.emitTraced(traceId, envelope);
+    } else {
+      this.emitWrapper(envelope.event, ...envelope.payload);
+    }
+  };
+
+  // Same as emitWrapper, recording the handlers' execution in the trace.
+  emitTraced(traceId, envelope) {
+    if (typeof envelope.ts === 'number') {
+      NativeBridge.traceEvent('react-native post', 'i', traceId, envelope.ts, true);
+    }
+    setImmediate(() => {
+      NativeBridge.traceEvent('js handler', 'B', traceId);
+      NativeBridge.traceEvent('js handler', 't', traceId);
+      currentTraceId = traceId;
+      try {
+        this.emitLocal(envelope.event, ...(envelope.payload));
+      } finally {
+        currentTraceId = 0;
+        NativeBridge.traceEvent('js handler', 'E', traceId);
+      }
+    });
   };
 };
 
@@ -121,15 +186,129 @@ class SystemEventLock {
 
 }
 
+/**
+ * Continuous sampling profiler.
+ * Keeps a rolling buffer with the last minutes of JS stack samples of the
+ * Node thread, that can be written to a flamegraph-ready file at any time.
+ */
+class Profiler {
+  constructor(app) {
+    this._app = app;
+  };
+
+  // Starts sampling. Restarts with the new options if already running.
+  // options.frequency: samples per second (default 20, max 100).
+  // options.minutes: how much history is kept (default 5, max 30).
+  start(options) {
+    options = options || {};
+    NativeBridge.startProfiler(options.frequency, options.minutes);
+  };
+
+  stop() {
+    NativeBridge.stopProfiler();
+  };
+
+  // Writes the samples of the last `minutes`, by default all the history
+  // kept, as folded stacks inside the data directory and returns the file
+  // path.
+  dump(minutes) {
+    const dir = path.join(this._app.datadir(), 'nodejs-profiles');
+    fs.mkdirSync(dir, { recursive: true });
+    const file = path.join(dir, 'profile-' + Date.now() + '.folded');
+    NativeBridge.dumpProfile(file, minutes);
+    return file;
+  };
+
+  // Returns the sample counts and the profiler's own folding cost.
+  stats() {
+    return NativeBridge.getProfilerStats();
+  };
+};
+
+/**
+ * Bridge message tracing.
+ * Records the lifecycle of every message crossing the bridge and writes it
+ * as Chrome trace-event JSON, which can be opened with Perfetto.
+ */
+class Tracing {
+  constructor(app) {
+    this._app = app;
+  };
+
+  start() {
+    MessageCodec.tracing = true;
+    NativeBridge.startTracing();
+  };
+
+  stop() {
+    MessageCodec.tracing = false;
+    NativeBridge.stopTracing();
+  };
+
+  // Writes the recorded events inside the data directory and returns the
+  // file path.
+  dump() {
+    const dir = path.join(this._app.datadir(), 'nodejs-traces');
+    fs.mkdirSync(dir, { recursive: true });
+    const file = path.join(dir, 'trace-' + Date.now() + '.json');
+    NativeBridge.exportTrace(file);
+    return file;
+  };
+};
+
+/**
+ * Bridge traffic capture.
+ * Writes every message crossing the bridge, with its time, to a file that
+ * scripts/replay-bridge-capture.js replays on a host.
+ */
+class Capture {
+  constructor(app) {
+    this._app = app;
+    this._file = null;
+  };
+
+  // Starts capturing inside the data directory and returns the file path.
+  start() {
+    const dir = path.join(this._app.datadir(), 'nodejs-captures');
+    fs.mkdirSync(dir, { recursive: true });
+    const file = path.join(dir, 'capture-' + Date.now() + '.rncap');
+    NativeBridge.startCapture(file);
+    this._file = file;
+    return file;
+  };
+
+  // Ends the capture and returns the path of its file.
+  stop() {
+    NativeBridge.stopCapture();
+    const file = this._file;
+    this._file = null;
+    return file;
+  };
+};
+
+// Trace id of the message whose handlers are running, so replies posted
+// from the handlers continue the same trace.
+var currentTraceId = 0;
+
+// Parses an optional integer argument of a system channel command.
+function commandArgument(value) {
+  const number = parseInt(value, 10);
+  return isNaN(number) ? undefined : number;
+};
+
 /**
  * System channel class.
- * Emit pause/resume events when the app goes to background/foreground.
+ * Emit pause/resume events when the app goes to background/foreground, and
+ * memory-pressure events when the system is low on memory.
  */
 class SystemChannel extends ChannelSuper {
   constructor(name) {
     super(name);
     // datadir should not change during runtime, so we cache it.
     this._cacheDataDir = null;
+    this.profiler = new Profiler(this);
+    this.tracing = new Tracing(this);
+    this.capture = new Capture(this);
   };
 
   emitWrapper(type) {
@@ -161,10 +340,133 @@ class SystemChannel extends ChannelSuper {
   };
 
   processData(data) {
+    if (data.startsWith('profiler-')) {
+      // Profiler commands sent by the react-native side.
+      this._handleProfilerCommand(data);
+      return;
+    }
+    if (data.startsWith('trace-')) {
+      // Tracing commands sent by the react-native side.
+      this._handleTracingCommand(data);
+      return;
+    }
+    if (data.startsWith('capture-')) {
+      // Capture commands sent by the react-native side.
+      this._handleCaptureCommand(data);
+      return;
+    }
+    if (data.startsWith('memory-pressure|')) {
+      // Sent by the native side, with the format "memory-pressure|{level}".
+      const level = data.split('|')[1];
+      setImmediate(() => this.emitLocal('memory-pressure', level));
+      return;
+    }
     // The data is the event.
     this.emitWrapper(data);
   };
 
+  // The expected formats are "profiler-start|{frequency}|{minutes}",
+  // "profiler-stop" and "profiler-dump|{minutes}".
+  _handleProfilerCommand(data) {
+    const commandArguments = data.split('|');
+    try {
+      switch (commandArguments[0]) {
+        case 'profiler-start':
+          this.profiler.start({
+            frequency: commandArgument(commandArguments[1]),
+            minutes: commandArgument(commandArguments[2])
+          });
+          break;
+        case 'profiler-stop':
+          this.profiler.stop();
+          break;
+        case 'profiler-dump': {
+          const file = this.profiler.dump(commandArgument(commandArguments[1]));
+          // Let the app know where the profile was written.
+          setImmediate(() => this.emitLocal('profile', file));
+          break;
+        }
+      }
+    } catch (err) {
+      console.error('ERROR: Profiler command failed:', data, err);
+    }
+  };
+
+  // The expected formats are "trace-start", "trace-stop" and "trace-dump".
+  _handleTracingCommand(data) {
+    try {
+      switch (data) {
+        case 'trace-start':
+          this.tracing.start();
+          break;
+        case 'trace-stop':
+          this.tracing.stop();
+          break;
+        case 'trace-dump': {
+          const file = this.tracing.dump();
+          // Let the app know where the trace was written.
+          setImmediate(() => this.emitLocal('trace', file));
+          break;
+        }
+      }
+    } catch (err) {
+      console.error('ERROR: Tracing command failed:', data, err);
+    }
+  };
+
+  // The expected formats are "capture-start" and "capture-stop".
+  _handleCaptureCommand(data) {
+    try {
+      switch (data) {
+        case 'capture-start':
+          this.capture.start();
+          break;
+        case 'capture-stop': {
+          const file = this.capture.stop();
+          // Let the app know where the capture was written.
+          if (file) {
+            setImmediate(() => this.emitLocal('capture', file));
+          }
+          break;
+        }
+      }
+    } catch (err) {
+      console.error('ERROR: Capture command failed:', data, err);
+    }
+  };
+
+  // Returns the CPU time used by each thread of the process, grouped by role.
+  threadCpuUsage() {
+    return NativeBridge.getThreadCpuUsage();
+  };
+
+  // Returns the delivery statistics of each registered channel.
+  channelStats() {
+    return NativeBridge.getChannelStats();
+  };
+
+  // Returns the records of the flight recorder, of this process or of the
+  // previous one.
+  flightRecording(previous) {
+    return NativeBridge.getFlightRecording(previous === true);
+  };
+
+  // Returns the memory used by ArrayBuffers and the allocator's counters.
+  arrayBufferStats() {
+    return NativeBridge.getArrayBufferStats();
+  };
+
+  // Returns the effective configuration of the threads started by the plugin.
+  threadConfiguration() {
+    return NativeBridge.getThreadConfiguration();
+  };
+
+  // Returns the C function table native addons send messages with, as an
+  // external value for napi_get_value_external.
+  addonApi() {
+    return NativeBridge.getAddonApi();
+  };
+
   // Get a writable data directory for persistent file storage.
   datadir() {
     if (this._cacheDataDir === null) {
@@ -183,9 +485,9 @@ var channels = {};
  * This method is invoked by the native code when an event/message is received
  * from the react-native app.
  */
-function bridgeListener(channelName, data) {
+function bridgeListener(channelName, data, traceId) {
   if (channels.hasOwnProperty(channelName)) {
-    channels[channelName].processData(data);
+    channels[channelName].processData(data, traceId);
   } else {
     console.error('ERROR: Channel not found:', channelName);
   }
@@ -205,15 +507,44 @@ function registerChannel(channel) {
  * Module exports.
  */
 const systemChannel = new SystemChannel(SYSTEM_CHANNEL);
-registerChannel(systemChannel);
+var eventChannel;
 
-// Signal we are ready for app events, so the native code won't lock before node is ready to handle those.
-NativeBridge.sendMessage(SYSTEM_CHANNEL, "ready-for-app-events");
+if (workerThreads.isMainThread) {
+  registerChannel(systemChannel);
 
-const eventChannel = new EventChannel(EVENT_CHANNEL);
-registerChannel(eventChannel);
+  // Signal we are ready for app events, so the native code won't lock before node is ready to handle those.
+  NativeBridge.sendMessage(SYSTEM_CHANNEL, "ready-for-app-events");
+
+  eventChannel = new EventChannel(EVENT_CHANNEL);
+  registerChannel(eventChannel);
+
+  // The workers started from now on use the channels of this environment.
+  workerThreads.setEnvironmentData(NAMESPACE_KEY, NativeBridge.getNamespace());
+} else {
+  // The built-in channels belong to the main thread. A worker thread gets
+  // its own channels with createChannel, delivered on its own event loop.
+  // Its system channel isn't registered, so it emits no app events.
+  const namespace = workerThreads.getEnvironmentData(NAMESPACE_KEY);
+  if (typeof namespace === 'string') {
+    NativeBridge.setNamespace(namespace);
+  }
+}
+
+// Returns the channel named `name`, created by the first call. The React
+// Native side gets the same channel with nodejs.createChannel(name). Each
+// channel can be created by a single thread, the main one or a worker.
+function createChannel(name) {
+  if (typeof name !== 'string' || name.length === 0 || name.startsWith('_') || name.indexOf('/') !== -1) {
+    throw new TypeError('rn-bridge: channel names must be non-empty strings not starting with "_" nor containing "/".');
+  }
+  if (!channels[name]) {
+    registerChannel(new EventChannel(name));
+  }
+  return channels[name];
+};
 
 module.exports = exports = {
   app: systemChannel,
-  channel: eventChannel
+  channel: eventChannel,
+  createChannel: createChannel
 };
@@ -0,0 +1,50 @@
+const path = require('path');
+const NativeBridge = process._linkedBinding('rn_bridge');
+
+/**
+ * Worker of the worker pool started by nodejs.startWorkerPool.
+ * Started by the native side, in its own Node.js environment, as:
+ *   node index.js <worker index> <nodejs-project path>
+ * Runs one job at a time: the jobs queued for this worker, then the jobs it
+ * steals from busy workers. A job calls the function exported by a module of
+ * the nodejs-project, and its result or error is sent to the React Native
+ * side on the job's reply channel.
+ */
+
+const workerIndex = parseInt(process.argv[2], 10);
+const projectPath = process.argv[3];
+var running = false;
+
+function runJob(modulePath, args) {
+  const job = require(path.resolve(projectPath, modulePath));
+  if (typeof job !== 'function') {
+    throw new TypeError(modulePath + ' does not export a function.');
+  }
+  return job(...JSON.parse(args));
+}
+
+function runNextJob() {
+  const job = NativeBridge.takePoolJob(workerIndex);
+  if (job === undefined) {
+    // Woken up again by the native side when jobs are queued.
+    running = false;
+    return;
+  }
+  const [id, modulePath, args, replyChannel] = job;
+  new Promise((resolve) => resolve(runJob(modulePath, args)))
+    .then((result) => JSON.stringify({id: id, result: result}))
+    // Also catches results that can't be serialized.
+    .catch((err) => JSON.stringify({id: id, error: String((err && err.stack) || err)}))
+    .then((reply) => {
+      NativeBridge.replyPoolJob(replyChannel, reply);
+      // Lets the event loop run between jobs.
+      setImmediate(runNextJob);
+    });
+}
+
+NativeBridge.attachPoolWorker(workerIndex, () => {
+  if (!running) {
+    running = true;
+    setImmediate(runNextJob);
+  }
+});
@@ -8,11 +8,27 @@
   bool _startedNodeAlready;
 }
 + (NodeRunner*) sharedInstance;
+- (void) prewarmEngine:(NSString*)builtinModulesPath;
 - (void) startEngineWithArguments:(NSArray*)arguments:(NSString*)builtinModulesPath;
+- (void) stopEngine;
+- (void) startEnvironment:(NSString*)name arguments:(NSArray*)arguments builtinModulesPath:(NSString*)builtinModulesPath;
+- (BOOL) stopEnvironment:(NSString*)name;
+- (int) setWorkerPoolSize:(int)size;
+- (void) submitPoolJob:(NSString*)jobId module:(NSString*)module args:(NSString*)args replyChannel:(NSString*)replyChannel;
+- (int) clearWorkerPool;
+- (void) setStreamEntryScript:(BOOL)enabled;
+- (void) setPlatformWorkerThreads:(int)count;
+- (void) setUvThreadpoolSize:(int)size;
+- (void) configureArrayBufferAllocator:(BOOL)pooled limitMb:(int)limitMb;
+- (BOOL) configureFlightRecorder:(BOOL)enabled sizeKb:(int)sizeKb payloadBytes:(int)payloadBytes;
+- (void) configureBackgroundMode:(BOOL)enabled collectGarbage:(BOOL)collectGarbage coalescingMs:(int)coalescingMs;
+- (BOOL) configureThreads:(NSString*)role stackSizeKb:(int)stackSizeKb priority:(NSString*)priority affinityMask:(double)affinityMask;
+- (dispatch_queue_t) bridgeQueue;
 - (void) setCurrentRNNodeJsMobile:(RNNodeJsMobile*)module;
 - (void) sendMessageToNode:(NSString*)channelName:(NSString*)message;
+- (void) setChannelLatencyBudget:(NSString*)channelName:(int)budgetMs;
 - (void) sendMessageBackToReact:(NSString*)channelName:(NSString*)message;
-@property(assign, nonatomic, readwrite) bool startedNodeAlready;
+@property(assign, atomic, readwrite) bool startedNodeAlready;
 @end
 
 #endif
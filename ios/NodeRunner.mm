@@ -2,12 +2,18 @@
 #include "NodeRunner.hpp"
 #include <NodeMobile/NodeMobile.h>
 #include <string>
+#include "rn-allocator.h"
 #include "rn-bridge.h"
+#include "rn-pool.h"
+#include "rn-recorder.h"
+#include "rn-runtime.h"
+#include "rn-threads.h"
 
 
 @implementation NodeRunner
 {
   RNNodeJsMobile * _currentModuleInstance;
+  dispatch_source_t _memoryPressureSource;
 }
 
 @synthesize startedNodeAlready = _startedNodeAlready;
@@ -49,9 +55,28 @@ void rcv_message(const char* channelName, const char* msg) {
   [[NSNotificationCenter defaultCenter] addObserver:self
                                         selector:@selector(onResume)
                                         name:UIApplicationWillEnterForegroundNotification object:nil];
+
+  [[NSNotificationCenter defaultCenter] addObserver:self
+                                        selector:@selector(onMemoryWarning)
+                                        name:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+  // Memory warnings are only sent once memory is critical. The system also
+  // reports when it starts running low.
+  _memoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0,
+                                                 DISPATCH_MEMORYPRESSURE_WARN,
+                                                 dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+  dispatch_source_set_event_handler(_memoryPressureSource, ^{
+    rn_runtime_memory_pressure(RN_MEMORY_PRESSURE_MODERATE);
+  });
+  dispatch_resume(_memoryPressureSource);
   // Register the Documents Directory as the node dataDir.
   NSString* nodeDataDir = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) firstObject];
   rn_register_node_data_dir_path([nodeDataDir UTF8String]);
+  // The first start boots from the startup snapshot if it's present and up to date.
+  NSString* snapshotPath = [[NSBundle mainBundle] pathForResource:@"nodejs-snapshot/startup" ofType:@"blob"];
+  NSString* projectPath = [[NSBundle mainBundle] pathForResource:@"nodejs-project" ofType:@""];
+  if (snapshotPath != nil && projectPath != nil) {
+    rn_runtime_set_startup_snapshot([snapshotPath UTF8String], [projectPath UTF8String]);
+  }
   return self;
 }
 
@@ -89,6 +114,7 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
  * Handlers for events registered by the plugin:
  * - onPause
  * - onResume
+ * - onMemoryWarning
  */
 
 - (void) onPause {
@@ -117,9 +143,16 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
       backgroundWaitForPauseHandlerTask = UIBackgroundTaskInvalid;
     });
   }
+  rn_runtime_set_background(true);
+}
+
+- (void) onMemoryWarning {
+  rn_runtime_memory_pressure(RN_MEMORY_PRESSURE_CRITICAL);
 }
 
 - (void) onResume {
+  // Restores the foreground latency before the resume event is handled.
+  rn_runtime_set_background(false);
   if(nodeIsReadyForAppEvents) {
     [[NodeRunner sharedInstance] sendMessageToNode:SYSTEM_CHANNEL:@"resume"];
   }
@@ -185,6 +218,11 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
   rn_bridge_notify(c_channelName, c_message);
 }
 
+-(void) setChannelLatencyBudget:(NSString*)channelName:(int)budgetMs
+{
+  rn_bridge_set_latency_budget([channelName UTF8String], (uint32_t)budgetMs);
+}
+
 -(void) sendMessageBackToReact:(NSString*)channelName:(NSString*)message
 {
   if(_currentModuleInstance!=nil) {
@@ -192,20 +230,63 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
   }
 }
 
-//node's libUV requires all arguments being on contiguous memory.
-- (void) startEngineWithArguments:(NSArray*)arguments:(NSString*)builtinModulesPath
+//Set the builtin_modules path to NODE_PATH, unless set by a previous start.
+- (void) setNodePath:(NSString*)builtinModulesPath
 {
-  //Set the builtin_modules path to NODE_PATH
   NSString* nodePath = [[NSProcessInfo processInfo] environment][@"NODE_PATH"];
   if (nodePath == NULL)
   {
     nodePath = builtinModulesPath;
-  } else {
+  } else if (![nodePath hasSuffix:builtinModulesPath]) {
     nodePath = [nodePath stringByAppendingString:@":"];
     nodePath = [nodePath stringByAppendingString:builtinModulesPath];
   }
   setenv([@"NODE_PATH" UTF8String], (const char*)[nodePath UTF8String], 1);
+}
+
+// Arguments of the Node thread. libuv needs them in contiguous memory, which
+// isn't freed as it may be kept for the process title.
+struct NodeThreadArgs {
+  int argc;
+  char** argv;
+};
+
+// The runtime has exited and been freed, so it can be started again.
+void node_stopped() {
+  nodeIsReadyForAppEvents = false;
+  [NodeRunner sharedInstance].startedNodeAlready = false;
+}
+
+void* node_thread_func(void* arg) {
+  @autoreleasepool {
+    NodeThreadArgs* node_args = (NodeThreadArgs*)arg;
+    rn_runtime_start(node_args->argc, node_args->argv);
+    delete node_args;
+    node_stopped();
+  }
+  return 0;
+}
+
+void* prewarm_thread_func(void*) {
+  @autoreleasepool {
+    // Returns once the runtime started with startEngineWithArguments exits.
+    rn_runtime_prewarm();
+    node_stopped();
+  }
+  return 0;
+}
+
+- (void) prewarmEngine:(NSString*)builtinModulesPath
+{
+  // The bootstrap reads NODE_PATH.
+  [self setNodePath:builtinModulesPath];
+  rn_register_bridge_cb(rcv_message);
+  rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_MAIN, prewarm_thread_func, NULL);
+}
 
+//node's libUV requires all arguments being on contiguous memory.
+char** copy_arguments(NSArray* arguments, int* argc)
+{
   int c_arguments_size=0;
 
   //Compute byte size need for all arguments in contiguous memory.
@@ -218,8 +299,8 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
   //Stores arguments in contiguous memory.
   char* args_buffer=(char*)calloc(c_arguments_size, sizeof(char));
 
-  //argv to pass into node.
-  char* argv[[arguments count]];
+  //argv to pass into node, used by the Node thread.
+  char** argv=(char**)calloc([arguments count] + 1, sizeof(char*));
 
   //To iterate through the expected start position of each argument in args_buffer.
   char* current_args_position=args_buffer;
@@ -242,9 +323,137 @@ id appPauseEventsManagerSetLock = [[NSObject alloc] init];
     //Increment to the next argument's expected position.
     current_args_position+=strlen(current_args_position)+1;
   }
+  *argc=argument_count;
+  return argv;
+}
+
+- (void) startEngineWithArguments:(NSArray*)arguments:(NSString*)builtinModulesPath
+{
+  [self setNodePath:builtinModulesPath];
+
+  int argument_count=0;
+  char** argv=copy_arguments(arguments, &argument_count);
   rn_register_bridge_cb(rcv_message);
-  //Start node, with argc and argv.
-  node_start(argument_count, argv);
+
+  // A pre-warmed runtime already runs on its own thread, which resets the
+  // started flag once it exits. Hands the arguments over to it.
+  if (rn_runtime_is_prewarmed()) {
+    [NSThread detachNewThreadWithBlock:^{
+      rn_runtime_start(argument_count, argv);
+    }];
+    return;
+  }
+
+  //Start node, with argc and argv, on a thread configured by the startup options.
+  NodeThreadArgs* node_args = new NodeThreadArgs{ argument_count, argv };
+  if (rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_MAIN, node_thread_func, node_args) != 0) {
+    NSLog(@"Couldn't start the Node thread.");
+    delete node_args;
+    node_stopped();
+  }
+}
+
+- (void) stopEngine
+{
+  rn_runtime_stop();
+}
+
+// Arguments of the thread of a named environment.
+struct EnvironmentThreadArgs {
+  std::string name;
+  int argc;
+  char** argv;
+};
+
+// Runs a named environment. Its exit is reported to the application on the
+// environment's system channel, as node_stopped only applies to the main
+// runtime.
+void* environment_thread_func(void* arg) {
+  @autoreleasepool {
+    EnvironmentThreadArgs* env_args = (EnvironmentThreadArgs*)arg;
+    int exit_code = rn_runtime_start_environment(env_args->name.c_str(), env_args->argc, env_args->argv);
+    std::string system_channel = env_args->name + RN_BRIDGE_NAMESPACE_SEPARATOR "_SYSTEM_";
+    rcv_message(system_channel.c_str(), ("exit|" + std::to_string(exit_code)).c_str());
+    delete env_args;
+  }
+  return 0;
+}
+
+- (void) startEnvironment:(NSString*)name arguments:(NSArray*)arguments builtinModulesPath:(NSString*)builtinModulesPath
+{
+  [self setNodePath:builtinModulesPath];
+
+  EnvironmentThreadArgs* env_args = new EnvironmentThreadArgs{ [name UTF8String], 0, NULL };
+  env_args->argv = copy_arguments(arguments, &env_args->argc);
+  rn_register_bridge_cb(rcv_message);
+
+  if (rn_thread_start(RN_THREAD_ROLE_NODE, RN_THREAD_NODE_ENVIRONMENT, environment_thread_func, env_args) != 0) {
+    NSLog(@"Couldn't start the thread of a Node environment.");
+    // Reported as its thread would have.
+    std::string system_channel = env_args->name + RN_BRIDGE_NAMESPACE_SEPARATOR "_SYSTEM_";
+    rcv_message(system_channel.c_str(), "exit|-1");
+    delete env_args;
+  }
+}
+
+- (BOOL) stopEnvironment:(NSString*)name
+{
+  return rn_runtime_stop_environment([name UTF8String]);
+}
+
+- (int) setWorkerPoolSize:(int)size
+{
+  return rn_pool_set_size(size);
+}
+
+- (void) submitPoolJob:(NSString*)jobId module:(NSString*)module args:(NSString*)args replyChannel:(NSString*)replyChannel
+{
+  rn_pool_submit([jobId UTF8String], [module UTF8String], [args UTF8String], [replyChannel UTF8String]);
+}
+
+- (int) clearWorkerPool
+{
+  return rn_pool_clear();
+}
+
+- (void) setStreamEntryScript:(BOOL)enabled
+{
+  rn_runtime_set_stream_entry_script(enabled);
+}
+
+- (void) setPlatformWorkerThreads:(int)count
+{
+  rn_runtime_set_platform_worker_threads(count);
+}
+
+- (void) setUvThreadpoolSize:(int)size
+{
+  rn_runtime_set_uv_threadpool_size(size);
+}
+
+- (void) configureArrayBufferAllocator:(BOOL)pooled limitMb:(int)limitMb
+{
+  rn_allocator_configure(pooled, limitMb > 0 ? (size_t)limitMb * 1024 * 1024 : 0);
+}
+
+- (BOOL) configureFlightRecorder:(BOOL)enabled sizeKb:(int)sizeKb payloadBytes:(int)payloadBytes
+{
+  return rn_recorder_configure(enabled, (size_t)sizeKb * 1024, (size_t)payloadBytes);
+}
+
+- (void) configureBackgroundMode:(BOOL)enabled collectGarbage:(BOOL)collectGarbage coalescingMs:(int)coalescingMs
+{
+  rn_runtime_configure_background_mode(enabled, collectGarbage, coalescingMs);
+}
+
+- (BOOL) configureThreads:(NSString*)role stackSizeKb:(int)stackSizeKb priority:(NSString*)priority affinityMask:(double)affinityMask
+{
+  return rn_threads_configure([role UTF8String], (size_t)stackSizeKb, [priority UTF8String], (uint64_t)affinityMask);
+}
+
+- (dispatch_queue_t) bridgeQueue
+{
+  return dispatch_get_global_queue(rn_thread_qos_class(RN_THREAD_ROLE_BRIDGE, QOS_CLASS_BACKGROUND), 0);
 }
 @end
 
@@ -3,5 +3,8 @@
 
 @interface RNNodeJsMobile : NSObject <RCTBridgeModule>
   -(void) sendMessageBackToReact:(NSString*)channelName:(NSString*)message;
+  // Bootstraps Node before React Native calls nodejs.start(). Meant to be
+  // called from application:didFinishLaunchingWithOptions:.
+  +(void) prewarm;
 @end
   
\ No newline at end of file
@@ -9,7 +9,16 @@
 NSString* const BUILTIN_MODULES_RESOURCE_PATH = @"builtin_modules";
 NSString* const NODEJS_PROJECT_RESOURCE_PATH = @"nodejs-project";
 NSString* const NODEJS_DLOPEN_OVERRIDE_FILENAME = @"override-dlopen-paths-preload.js";
+NSString* const CODE_CACHE_PRELOAD = @"code-cache/index.js";
+NSString* const WORKER_POOL_SCRIPT = @"worker-pool/index.js";
+// Must match RN_POOL_ENVIRONMENT_PREFIX in rn-pool.h.
+NSString* const WORKER_POOL_ENVIRONMENT_PREFIX = @"_pool";
+int const DEFAULT_FLIGHT_RECORDER_SIZE_KB = 1024;
+int const DEFAULT_FLIGHT_RECORDER_PAYLOAD_BYTES = 64;
 NSString* nodePath;
+// Set from the startup options of the latest start.
+BOOL useCodeCache = NO;
+NSArray* execArgv = nil;
 
 @synthesize bridge = _bridge;
 
@@ -31,23 +40,196 @@ NSString* nodePath;
     [[NodeRunner sharedInstance] setCurrentRNNodeJsMobile:self];
   }
 
-  NSString* builtinModulesPath = [[NSBundle mainBundle] pathForResource:BUILTIN_MODULES_RESOURCE_PATH ofType:@""];
-  nodePath = [[NSBundle mainBundle] pathForResource:NODEJS_PROJECT_RESOURCE_PATH ofType:@""];
-  nodePath = [nodePath stringByAppendingString:@":"];
-  nodePath = [nodePath stringByAppendingString:builtinModulesPath];
+  nodePath = [RNNodeJsMobile defaultNodePath];
   
   return self;
 }
 
++ (NSString*)defaultNodePath
+{
+  NSString* builtinModulesPath = [[NSBundle mainBundle] pathForResource:BUILTIN_MODULES_RESOURCE_PATH ofType:@""];
+  NSString* path = [[NSBundle mainBundle] pathForResource:NODEJS_PROJECT_RESOURCE_PATH ofType:@""];
+  path = [path stringByAppendingString:@":"];
+  return [path stringByAppendingString:builtinModulesPath];
+}
+
++ (void)prewarm
+{
+  static dispatch_once_t once;
+  dispatch_once(&once, ^{
+    [[NodeRunner sharedInstance] prewarmEngine:[RNNodeJsMobile defaultNodePath]];
+  });
+}
+
 RCT_EXPORT_MODULE()
 
+// Starts a named environment next to the main runtime. Only the node options
+// and the code cache apply to it, the other startup options being
+// process-wide. Its exit is reported on its own system channel.
+RCT_EXPORT_METHOD(startEnvironment:(NSString *)name mainFileName:(NSString *)mainFileName options:(NSDictionary *)options)
+{
+  NSString* srcPath = [[NSBundle mainBundle] pathForResource:[NSString stringWithFormat:@"%@/%@", NODEJS_PROJECT_RESOURCE_PATH, mainFileName] ofType:@""];
+  if(!srcPath)
+  {
+    // Lets node report the missing file, which exits the environment.
+    srcPath = [NSString stringWithFormat:@"%@/%@/%@", [[NSBundle mainBundle] resourcePath], NODEJS_PROJECT_RESOURCE_PATH, mainFileName];
+  }
+  NSMutableArray* nodeArguments = [NSMutableArray arrayWithObject:@"node"];
+
+  NSString* dlopenoverridePath = [[NSBundle mainBundle] pathForResource:[NSString stringWithFormat:@"%@/%@", NODEJS_PROJECT_RESOURCE_PATH, NODEJS_DLOPEN_OVERRIDE_FILENAME] ofType:@""];
+  // Check if the file to override dlopen lookup exists, for loading native modules from the Frameworks.
+  if(dlopenoverridePath)
+  {
+    [nodeArguments addObject:@"-r"];
+    [nodeArguments addObject:dlopenoverridePath];
+  }
+  [nodeArguments addObject:srcPath];
+
+  NSArray* arguments = [self withPreloadArguments:nodeArguments
+                                         execArgv:options[@"execArgv"]
+                                        codeCache:[options[@"codeCache"] boolValue]];
+  [[NodeRunner sharedInstance] startEnvironment:name arguments:arguments builtinModulesPath:nodePath];
+}
+
+RCT_EXPORT_METHOD(stopEnvironment:(NSString *)name)
+{
+  [[NodeRunner sharedInstance] stopEnvironment:name];
+}
+
+// Starts the workers of the worker pool, each in its own environment.
+// A size of 0 starts a worker per core. Resolves with the number of
+// workers once the size is set; each worker then reports on its system
+// channel that it's attached, or its exit.
+RCT_EXPORT_METHOD(startWorkerPool:(int)size options:(NSDictionary *)options resolver:(RCTPromiseResolveBlock)resolve rejecter:(RCTPromiseRejectBlock)reject)
+{
+  NodeRunner* runner = [NodeRunner sharedInstance];
+  int poolSize = [runner setWorkerPoolSize:size > 0 ? size : (int)[[NSProcessInfo processInfo] activeProcessorCount]];
+  if (poolSize < 0)
+  {
+    reject(@"EBUSY", @"The workers of the previous worker pool are still running.", nil);
+    return;
+  }
+  NSString* builtinModulesPath = [[NSBundle mainBundle] pathForResource:BUILTIN_MODULES_RESOURCE_PATH ofType:@""];
+  NSString* projectPath = [[NSBundle mainBundle] pathForResource:NODEJS_PROJECT_RESOURCE_PATH ofType:@""];
+  for (int i = 0; i < poolSize; i++)
+  {
+    NSArray* nodeArguments = [NSArray arrayWithObjects:
+                              @"node",
+                              [NSString stringWithFormat:@"%@/%@", builtinModulesPath, WORKER_POOL_SCRIPT],
+                              [NSString stringWithFormat:@"%d", i],
+                              projectPath,
+                              nil
+                              ];
+    NSArray* arguments = [self withPreloadArguments:nodeArguments
+                                           execArgv:options[@"execArgv"]
+                                          codeCache:[options[@"codeCache"] boolValue]];
+    [runner startEnvironment:[NSString stringWithFormat:@"%@%d", WORKER_POOL_ENVIRONMENT_PREFIX, i] arguments:arguments builtinModulesPath:nodePath];
+  }
+  resolve(@(poolSize));
+}
+
+// Drops the jobs no worker has taken, and stops the workers.
+RCT_EXPORT_METHOD(stopWorkerPool:(int)size)
+{
+  NodeRunner* runner = [NodeRunner sharedInstance];
+  [runner clearWorkerPool];
+  for (int i = 0; i < size; i++)
+  {
+    [runner stopEnvironment:[NSString stringWithFormat:@"%@%d", WORKER_POOL_ENVIRONMENT_PREFIX, i]];
+  }
+}
+
+RCT_EXPORT_METHOD(submitPoolJob:(NSString *)jobId module:(NSString *)module args:(NSString *)args replyChannel:(NSString *)replyChannel)
+{
+  [[NodeRunner sharedInstance] submitPoolJob:jobId module:module args:args replyChannel:replyChannel];
+}
+
 RCT_EXPORT_METHOD(sendMessage:(NSString *)channelName:(NSString *)message)
 {
-  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+  dispatch_async([[NodeRunner sharedInstance] bridgeQueue], ^{
     [[NodeRunner sharedInstance] sendMessageToNode:channelName:message];
   });
 }
 
+RCT_EXPORT_METHOD(setChannelLatencyBudget:(NSString *)channelName:(int)budgetMs)
+{
+  [[NodeRunner sharedInstance] setChannelLatencyBudget:channelName:budgetMs];
+}
+
+// Configures the threads of each role set in the threads option.
+-(void)setThreadOptions:(NSDictionary *)threads
+{
+  for (NSString* role in @[@"node", @"logForwarding", @"bridge"])
+  {
+    NSDictionary* thread = threads[role];
+    if(thread == nil)
+    {
+      continue;
+    }
+    NSString* priority = thread[@"priority"] != nil ? thread[@"priority"] : @"";
+    if(![[NodeRunner sharedInstance] configureThreads:role
+                                         stackSizeKb:[thread[@"stackSizeKb"] intValue]
+                                            priority:priority
+                                        affinityMask:[thread[@"affinityMask"] doubleValue]])
+    {
+      NSLog(@"Invalid configuration of the %@ threads.", role);
+    }
+  }
+}
+
+// Applies the startup options, as validated by index.js, to the next start.
+-(void)setRuntimeOptions:(NSDictionary *)options
+{
+  useCodeCache = [options[@"codeCache"] boolValue];
+  execArgv = options[@"execArgv"];
+  NodeRunner* runner = [NodeRunner sharedInstance];
+  [self setThreadOptions:options[@"threads"]];
+  [runner configureBackgroundMode:[options[@"backgroundMode"] boolValue]
+                   collectGarbage:[options[@"backgroundGc"] boolValue]
+                     coalescingMs:options[@"backgroundCoalescingMs"] != nil ? [options[@"backgroundCoalescingMs"] intValue] : -1];
+  [runner setStreamEntryScript:[options[@"streamEntryScript"] boolValue]];
+  [runner configureArrayBufferAllocator:[options[@"pooledArrayBuffers"] boolValue]
+                                limitMb:[options[@"arrayBufferLimitMb"] intValue]];
+  if(![runner configureFlightRecorder:[options[@"flightRecorder"] boolValue]
+                               sizeKb:options[@"flightRecorderSizeKb"] != nil ? [options[@"flightRecorderSizeKb"] intValue] : DEFAULT_FLIGHT_RECORDER_SIZE_KB
+                         payloadBytes:options[@"flightRecorderPayloadBytes"] != nil ? [options[@"flightRecorderPayloadBytes"] intValue] : DEFAULT_FLIGHT_RECORDER_PAYLOAD_BYTES])
+  {
+    NSLog(@"Couldn't create the flight recording file.");
+  }
+  if(options[@"platformWorkerThreads"] != nil)
+  {
+    [runner setPlatformWorkerThreads:[options[@"platformWorkerThreads"] intValue]];
+  }
+  if(options[@"uvThreadpoolSize"] != nil)
+  {
+    [runner setUvThreadpoolSize:[options[@"uvThreadpoolSize"] intValue]];
+  }
+}
+
+// Adds the node options built from the startup options, and the modules to
+// load before the main script, after "node".
+-(NSArray*)withPreloadArguments:(NSArray*)nodeArguments
+{
+  return [self withPreloadArguments:nodeArguments execArgv:execArgv codeCache:useCodeCache];
+}
+
+-(NSArray*)withPreloadArguments:(NSArray*)nodeArguments execArgv:(NSArray*)options codeCache:(BOOL)codeCache
+{
+  NSMutableArray* arguments = [nodeArguments mutableCopy];
+  NSUInteger index = 1;
+  for (NSString* option in options)
+  {
+    [arguments insertObject:option atIndex:index++];
+  }
+  if(codeCache)
+  {
+    NSString* builtinModulesPath = [[NSBundle mainBundle] pathForResource:BUILTIN_MODULES_RESOURCE_PATH ofType:@""];
+    [arguments insertObject:@"-r" atIndex:index++];
+    [arguments insertObject:[NSString stringWithFormat:@"%@/%@", builtinModulesPath, CODE_CACHE_PRELOAD] atIndex:index++];
+  }
+  return arguments;
+}
+
 -(void)callStartNodeWithScript:(NSString *)script
 {
   NSArray* nodeArguments = nil;
@@ -72,7 +254,7 @@ RCT_EXPORT_METHOD(sendMessage:(NSString *)channelName:(NSString *)message)
                               nil
                               ];
   }
-  [[NodeRunner sharedInstance] startEngineWithArguments:nodeArguments:nodePath];
+  [[NodeRunner sharedInstance] startEngineWithArguments:[self withPreloadArguments:nodeArguments]:nodePath];
 }
 
 -(void)callStartNodeProject:(NSString *)mainFileName
@@ -98,7 +280,7 @@ RCT_EXPORT_METHOD(sendMessage:(NSString *)channelName:(NSString *)message)
                               nil
                               ];
   }
-  [[NodeRunner sharedInstance] startEngineWithArguments:nodeArguments:nodePath];
+  [[NodeRunner sharedInstance] startEngineWithArguments:[self withPreloadArguments:nodeArguments]:nodePath];
 }
 
 -(void)callStartNodeProjectWithArgs:(NSString *)input
@@ -135,7 +317,7 @@ RCT_EXPORT_METHOD(sendMessage:(NSString *)channelName:(NSString *)message)
 
     [nodeArguments addObjectsFromArray:args];
   }
-  [[NodeRunner sharedInstance] startEngineWithArguments:nodeArguments:nodePath];
+  [[NodeRunner sharedInstance] startEngineWithArguments:[self withPreloadArguments:nodeArguments]:nodePath];
 }
 
 RCT_EXPORT_METHOD(startNodeWithScript:(NSString *)script options:(NSDictionary *)options)
@@ -143,15 +325,9 @@ RCT_EXPORT_METHOD(startNodeWithScript:(NSString *)script options:(NSDictionary *
   if(![NodeRunner sharedInstance].startedNodeAlready)
   {
     [NodeRunner sharedInstance].startedNodeAlready=true;
-    NSThread* nodejsThread = nil;
-    nodejsThread = [[NSThread alloc]
-      initWithTarget:self
-      selector:@selector(callStartNodeWithScript:)
-      object:script
-    ];
-    // Set 2MB of stack space for the Node.js thread.
-    [nodejsThread setStackSize:2*1024*1024];
-    [nodejsThread start];
+    [self setRuntimeOptions:options];
+    // Node runs on its own thread, started natively.
+    [self callStartNodeWithScript:script];
   }
 }
 
@@ -160,15 +336,9 @@ RCT_EXPORT_METHOD(startNodeProject:(NSString *)mainFileName options:(NSDictionar
   if(![NodeRunner sharedInstance].startedNodeAlready)
   {
     [NodeRunner sharedInstance].startedNodeAlready=true;
-    NSThread* nodejsThread = nil;
-    nodejsThread = [[NSThread alloc]
-      initWithTarget:self
-      selector:@selector(callStartNodeProject:)
-      object:mainFileName
-    ];
-    // Set 2MB of stack space for the Node.js thread.
-    [nodejsThread setStackSize:2*1024*1024];
-    [nodejsThread start];
+    [self setRuntimeOptions:options];
+    // Node runs on its own thread, started natively.
+    [self callStartNodeProject:mainFileName];
   }
 }
 
@@ -177,21 +347,21 @@ RCT_EXPORT_METHOD(startNodeProjectWithArgs:(NSString *)command options:(NSDictio
   if(![NodeRunner sharedInstance].startedNodeAlready)
   {
     [NodeRunner sharedInstance].startedNodeAlready=true;
-    NSThread* nodejsThread = nil;
-    nodejsThread = [[NSThread alloc]
-      initWithTarget:self
-      selector:@selector(callStartNodeProjectWithArgs:)
-      object:command
-    ];
-    // Set 2MB of stack space for the Node.js thread.
-    [nodejsThread setStackSize:2*1024*1024];
-    [nodejsThread start];
+    [self setRuntimeOptions:options];
+    // Node runs on its own thread, started natively.
+    [self callStartNodeProjectWithArgs:command];
   }
 }
 
+RCT_EXPORT_METHOD(stopNode)
+{
+  // Node's thread resets startedNodeAlready once the runtime is freed.
+  [[NodeRunner sharedInstance] stopEngine];
+}
+
 -(void) sendMessageBackToReact:(NSString*)channelName:(NSString*)message
 {
-  dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+  dispatch_async([[NodeRunner sharedInstance] bridgeQueue], ^{
     [self.bridge.eventDispatcher sendAppEventWithName:@"nodejs-mobile-react-native-message"
       body:@{@"channelName": channelName, @"message": message}
     ];
@@ -0,0 +1,246 @@
+#include "node.h"
+#include "rn-allocator.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Pooling ArrayBuffer allocator.
+ *
+ * Backing stores are rounded up to a power of two size class, from 256 bytes
+ * to 64 KB, and freed ones are kept in a free list per class, up to a budget,
+ * so the many short-lived buffers of a sync or decoding job don't go through
+ * malloc and free each time and fragment the native heap. Memory is
+ * zero-filled only when V8 asks for it.
+ *
+ * Each isolate gets its own allocator, sharing the free lists and the
+ * counters of the process-wide pool. Larger ones go to a
+ * node::NodeArrayBufferAllocator the isolate's allocator wraps, which can't
+ * be derived from outside of Node. Node turns zero-filling off for
+ * Buffer.allocUnsafe() through that allocator, on the isolate's thread, so
+ * it's skipped for them, and process.memoryUsage() only counts them as
+ * arrayBuffers. The pooled sizes are zero-filled whenever V8 asks. Worker
+ * threads use Node's own allocator. V8 may free backing stores on its
+ * background threads, so all methods are thread-safe.
+ */
+
+namespace {
+
+const size_t kMinClassSize = 256;
+const int kSizeClasses = 9;
+const size_t kMaxClassSize = kMinClassSize << (kSizeClasses - 1);
+// Most memory kept for reuse by each size class.
+const size_t kMaxPooledBytesPerClass = 1024 * 1024;
+
+int SizeClass(size_t length) {
+    if (length == 0 || length > kMaxClassSize) {
+        return -1;
+    }
+    int size_class = 0;
+    while ((kMinClassSize << size_class) < length) {
+        size_class++;
+    }
+    return size_class;
+}
+
+size_t ClassSize(int size_class) {
+    return kMinClassSize << size_class;
+}
+
+struct FreeList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+};
+
+// The free lists and counters shared by the allocators of all isolates.
+class BufferPool {
+public:
+    std::atomic<size_t> limit_bytes{0};
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> peak_bytes{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> pool_hits{0};
+    std::atomic<uint64_t> failures{0};
+
+    // Buffers too large to be pooled are allocated by `node_allocator`.
+    void* allocate(size_t length, bool zero_fill, node::ArrayBufferAllocator* node_allocator) {
+        size_t limit = this->limit_bytes.load();
+        size_t live = this->live_bytes.fetch_add(length) + length;
+        if (limit != 0 && live > limit) {
+            this->live_bytes -= length;
+            this->failures++;
+            return nullptr;
+        }
+        size_t peak = this->peak_bytes.load();
+        while (live > peak && !this->peak_bytes.compare_exchange_weak(peak, live)) {
+        }
+        this->allocations++;
+
+        void* data = nullptr;
+        if (length > kMaxClassSize) {
+            // Node's allocator leaves the memory as is while Node turns
+            // zero-filling off.
+            data = zero_fill ? node_allocator->Allocate(length)
+                             : node_allocator->AllocateUninitialized(length);
+            if (data == nullptr) {
+                this->live_bytes -= length;
+                this->failures++;
+            }
+            return data;
+        }
+        size_t size = length > 0 ? length : 1;
+        int size_class = SizeClass(length);
+        if (size_class >= 0) {
+            FreeList& list = this->free_lists[size_class];
+            list.mutex.lock();
+            if (!list.blocks.empty()) {
+                data = list.blocks.back();
+                list.blocks.pop_back();
+            }
+            list.mutex.unlock();
+            if (data != nullptr) {
+                this->pool_hits++;
+                if (zero_fill) {
+                    memset(data, 0, length);
+                }
+                return data;
+            }
+            size = ClassSize(size_class);
+        }
+        // calloc gets fresh pages already zeroed, which is cheaper than
+        // malloc and memset for large buffers.
+        data = zero_fill ? calloc(1, size) : malloc(size);
+        if (data == nullptr) {
+            this->live_bytes -= length;
+            this->failures++;
+        }
+        return data;
+    };
+
+    void free(void* data, size_t length, node::ArrayBufferAllocator* node_allocator) {
+        if (data == nullptr) {
+            return;
+        }
+        this->live_bytes -= length;
+        if (length > kMaxClassSize) {
+            node_allocator->Free(data, length);
+            return;
+        }
+        int size_class = SizeClass(length);
+        if (size_class >= 0) {
+            FreeList& list = this->free_lists[size_class];
+            list.mutex.lock();
+            if ((list.blocks.size() + 1) * ClassSize(size_class) <= kMaxPooledBytesPerClass) {
+                list.blocks.push_back(data);
+                list.mutex.unlock();
+                return;
+            }
+            list.mutex.unlock();
+        }
+        ::free(data);
+    };
+
+    size_t pooledBytes() {
+        size_t pooled = 0;
+        for (int i = 0; i < kSizeClasses; i++) {
+            this->free_lists[i].mutex.lock();
+            pooled += this->free_lists[i].blocks.size() * ClassSize(i);
+            this->free_lists[i].mutex.unlock();
+        }
+        return pooled;
+    };
+
+    void trim() {
+        for (int i = 0; i < kSizeClasses; i++) {
+            std::vector<void*> blocks;
+            this->free_lists[i].mutex.lock();
+            blocks.swap(this->free_lists[i].blocks);
+            this->free_lists[i].mutex.unlock();
+            for (void* block : blocks) {
+                ::free(block);
+            }
+        }
+    };
+
+private:
+    FreeList free_lists[kSizeClasses];
+};
+
+// Never freed: backing stores can outlive the environments using it.
+BufferPool* pool = new BufferPool();
+std::atomic<bool> pooled(false);
+
+// The allocator of an isolate.
+class PoolingAllocator : public node::ArrayBufferAllocator {
+public:
+    void* Allocate(size_t length) override {
+        return pool->allocate(length, true, this->node_allocator.get());
+    };
+
+    void* AllocateUninitialized(size_t length) override {
+        return pool->allocate(length, false, this->node_allocator.get());
+    };
+
+    void Free(void* data, size_t length) override {
+        pool->free(data, length, this->node_allocator.get());
+    };
+
+private:
+    // Allocates the buffers too large to be pooled.
+    std::unique_ptr<node::ArrayBufferAllocator> node_allocator = node::ArrayBufferAllocator::Create();
+
+    // Node toggles zero-filling through the allocator returned here. The
+    // one Create() returns is a NodeArrayBufferAllocator, which only derives
+    // from node::ArrayBufferAllocator, and is its own implementation.
+    node::NodeArrayBufferAllocator* GetImpl() override {
+        return reinterpret_cast<node::NodeArrayBufferAllocator*>(this->node_allocator.get());
+    };
+};
+
+void Method_GetArrayBufferStats(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Object> stats = v8::Object::New(isolate);
+    auto set = [&](const char* name, double value) {
+        stats->Set(context, v8::String::NewFromUtf8(isolate, name).ToLocalChecked(), v8::Number::New(isolate, value)).Check();
+    };
+    stats->Set(context, v8::String::NewFromUtf8(isolate, "pooled").ToLocalChecked(), v8::Boolean::New(isolate, pooled.load())).Check();
+    set("liveBytes", (double)pool->live_bytes.load());
+    set("peakBytes", (double)pool->peak_bytes.load());
+    set("pooledBytes", (double)pool->pooledBytes());
+    set("limitBytes", (double)pool->limit_bytes.load());
+    set("allocations", (double)pool->allocations.load());
+    set("poolHits", (double)pool->pool_hits.load());
+    set("failures", (double)pool->failures.load());
+    args.GetReturnValue().Set(stats);
+}
+
+}  // namespace
+
+void rn_allocator_configure(bool use_pool, size_t limit_bytes) {
+    pooled = use_pool || limit_bytes != 0;
+    pool->limit_bytes = limit_bytes;
+}
+
+bool rn_allocator_pooled() {
+    return pooled.load();
+}
+
+std::unique_ptr<node::ArrayBufferAllocator> rn_allocator_create() {
+    if (!pooled.load()) {
+        return nullptr;
+    }
+    return std::unique_ptr<node::ArrayBufferAllocator>(new PoolingAllocator());
+}
+
+void rn_allocator_trim() {
+    pool->trim();
+}
+
+void rn_allocator_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "getArrayBufferStats", Method_GetArrayBufferStats);
+}
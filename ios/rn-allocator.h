@@ -0,0 +1,33 @@
+#ifndef SRC_RN_ALLOCATOR_H_
+#define SRC_RN_ALLOCATOR_H_
+
+#include "node.h"
+
+#include <cstddef>
+#include <memory>
+
+// Makes the environments created from now on use the pooling ArrayBuffer
+// allocator, which keeps freed backing stores of common sizes for reuse and
+// counts the bytes used by the live ones. If `limit_bytes` isn't 0, the
+// backing stores of all these environments can't use more than that
+// together: allocations past the limit fail. For the ArrayBuffers, typed
+// arrays and Buffers created by JavaScript, that throws a RangeError instead
+// of getting the process killed, but V8 aborts the process when the buffers
+// Node allocates natively fail, like the read buffers of streams and
+// sockets. The limit also applies to the environments already running.
+void rn_allocator_configure(bool use_pool, size_t limit_bytes);
+
+// Whether the environments created from now on use the pooling allocator.
+bool rn_allocator_pooled();
+
+// Returns a new allocator to create an isolate with, to be freed after the
+// isolate, or nullptr to use Node's default one.
+std::unique_ptr<node::ArrayBufferAllocator> rn_allocator_create();
+
+// Frees the backing stores kept for reuse. Thread-safe.
+void rn_allocator_trim();
+
+// Adds the allocator's statistics to the rn_bridge binding.
+void rn_allocator_init(v8::Local<v8::Object> exports);
+
+#endif
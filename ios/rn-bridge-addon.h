@@ -0,0 +1,64 @@
+#ifndef RN_BRIDGE_ADDON_H_
+#define RN_BRIDGE_ADDON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface for Node native addons to send messages to the React Native
+ * application directly, from any thread, without a round trip through
+ * JavaScript. Copy this header into the addon's sources.
+ *
+ * The addon gets the function table from rn_bridge.app.addonApi(), an
+ * external value to read with napi_get_value_external, or by looking up
+ * RN_BRIDGE_ADDON_API_SYMBOL with dlsym in the library of the plugin. The
+ * table lives as long as the process. Fields are only ever added at its
+ * end: check `version` before using a field added after version 1.
+ *
+ * The messages go through the same path as those sent by JavaScript, on the
+ * calling thread: the messages a thread sends reach the application in the
+ * order it sent them, and they're counted in the channel statistics,
+ * recorded and captured like the others. Channel names are the ones the
+ * native side knows: a channel of a named environment is "<name>/<channel>".
+ */
+
+#define RN_BRIDGE_ADDON_API_VERSION 1
+#define RN_BRIDGE_ADDON_API_SYMBOL "rn_bridge_addon_api_get"
+
+#define RN_BRIDGE_ADDON_OK 0
+// A null argument, the system channel, or arguments that aren't a JSON array.
+#define RN_BRIDGE_ADDON_INVALID_ARGUMENT 1
+
+#if defined(__GNUC__)
+#define RN_BRIDGE_ADDON_EXPORT __attribute__((visibility("default")))
+#else
+#define RN_BRIDGE_ADDON_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rn_bridge_addon_api {
+    uint32_t version;
+
+    // Sends `message` as is, as rn_bridge.channel.sendRaw does.
+    int (*send_raw)(const char* channel, const char* message);
+
+    // Posts `event` with the arguments of `args_json`, a JSON array such as
+    // "[1, \"two\"]", as rn_bridge.channel.post does. `args_json` can be
+    // null for no arguments.
+    int (*post_event)(const char* channel, const char* event, const char* args_json);
+
+    // Posts `event` with `length` bytes at `data`, which are copied, as a
+    // single base64 string argument.
+    int (*post_buffer)(const char* channel, const char* event, const void* data, size_t length);
+} rn_bridge_addon_api;
+
+RN_BRIDGE_ADDON_EXPORT const rn_bridge_addon_api* rn_bridge_addon_api_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,11 +2,24 @@
 #include "node.h"
 #include "uv.h"
 #include "rn-bridge.h"
-
+#include "rn-addon.h"
+#include "rn-allocator.h"
+#include "rn-capture.h"
+#include "rn-pool.h"
+#include "rn-profiler.h"
+#include "rn-recorder.h"
+#include "rn-trace.h"
+#include "rn-threads.h"
+
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
 #include <cstring>
 #include <cstdlib>
 
@@ -14,13 +27,43 @@
  * Forward declarations
  */
 void FlushMessageQueue(uv_async_t* handle);
+void FlushCoalescedMessages(uv_timer_t* handle);
+void ReleaseAdoptedBuffer(void* data, size_t length, void* deleter_data);
 class Channel;
 
+/**
+ * The producer's data and callback of a buffer from rn_bridge_send_buffer,
+ * called by V8 once the ArrayBuffer adopting it releases it.
+ */
+struct AdoptedBuffer {
+    rn_bridge_free_cb free_cb;
+    void* user_data;
+};
+
+/**
+ * A message waiting in a channel's queue to be delivered to Node.
+ */
+struct QueuedMessage {
+    char* data;
+    uint64_t trace_id;
+    // When it was queued, if the flight recorder is on.
+    uint64_t queued_us;
+    // Set for a buffer, which isn't copied nor freed by the bridge.
+    AdoptedBuffer* buffer;
+    size_t length;
+};
+
 /**
  * Global variables
  */
 std::mutex channelsMutex;
 std::map<std::string, Channel*> channels;
+std::atomic<uint32_t> coalescingDelayMs(0);
+// Channel name prefixes of the named environments, by isolate.
+std::map<v8::Isolate*, std::string> namespaces;
+// Changed with the namespaces, as an isolate can be reused with another one.
+std::atomic<uint64_t> namespacesGeneration(0);
+const char kSystemChannel[] = "_SYSTEM_";
 
 /**
  * Channel class
@@ -30,25 +73,39 @@ private:
     v8::Isolate* isolate = nullptr;
     v8::Persistent<v8::Function> function;
     uv_async_t* queue_uv_handle = nullptr;
+    // Delivers the messages queued while coalescing.
+    uv_timer_t* coalescing_timer = nullptr;
     std::mutex uvhandleMutex;
     std::mutex queueMutex;
-    std::queue<char*> messageQueue;
+    std::queue<QueuedMessage> messageQueue;
     std::string name;
+    // The name the registering environment knows the channel by.
+    std::string local_name;
     bool initialized = false;
+    std::atomic<uint32_t> latency_budget_ms{0};
+    // Counted on the Node thread.
+    uint64_t wakeups = 0;
+    uint64_t delivered = 0;
+    // Messages sent to the application, from any thread.
+    std::atomic<uint64_t> sent{0};
 
 public:
     Channel(std::string name) : name(name) {};
 
     // Set up the channel's V8 data. This method can be called
     // only once per channel.
-    void setV8Function(v8::Isolate* isolate, v8::Local<v8::Function> func) {
+    void setV8Function(v8::Isolate* isolate, v8::Local<v8::Function> func, const std::string& local_name) {
         this->isolate = isolate;
+        this->local_name = local_name;
         this->function.Reset(isolate, func);
         this->uvhandleMutex.lock();
         if (this->queue_uv_handle == nullptr) {
             this->queue_uv_handle = (uv_async_t*)malloc(sizeof(uv_async_t));
-            uv_async_init(uv_default_loop(), this->queue_uv_handle, FlushMessageQueue);
+            uv_async_init(node::GetCurrentEventLoop(isolate), this->queue_uv_handle, FlushMessageQueue);
             this->queue_uv_handle->data = (void*)this;
+            this->coalescing_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+            uv_timer_init(node::GetCurrentEventLoop(isolate), this->coalescing_timer);
+            this->coalescing_timer->data = (void*)this;
             initialized = true;
             uv_async_send(this->queue_uv_handle);
         } else {
@@ -61,20 +118,141 @@ public:
 
     // Add a new message to the channel's queue and notify libuv to
     // call us back to do the actual message delivery.
-    void queueMessage(char* msg) {
+    void queueMessage(char* msg, uint64_t trace_id, AdoptedBuffer* buffer = nullptr, size_t length = 0) {
+        uint64_t queued_us = rn_recorder_enabled() ? rn_recorder_now_us() : 0;
         this->queueMutex.lock();
-        this->messageQueue.push(msg);
+        bool was_empty = this->messageQueue.empty();
+        this->messageQueue.push({ msg, trace_id, queued_us, buffer, length });
         this->queueMutex.unlock();
 
+        // While coalescing, the wakeup for the first queued message
+        // delivers the next ones too.
+        if (!was_empty && this->coalescingDelay() > 0) {
+            return;
+        }
+        this->wakeUp();
+    };
+
+    // Notifies libuv to call us back to deliver the queued messages.
+    void wakeUp() {
+        // The handle is closed when the environment that owns it stops.
+        this->uvhandleMutex.lock();
         if (initialized) {
             uv_async_send(this->queue_uv_handle);
         }
+        this->uvhandleMutex.unlock();
+    };
+
+    bool isSystemChannel() {
+        return this->name == kSystemChannel || this->local_name == kSystemChannel;
+    };
+
+    const std::string& qualifiedName() {
+        return this->name;
+    };
+
+    void countSent() {
+        this->sent.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    uint32_t coalescingDelay() {
+        if (this->isSystemChannel()) {
+            return 0;
+        }
+        uint32_t budget = this->latency_budget_ms.load();
+        uint32_t background_delay = coalescingDelayMs.load();
+        return budget > background_delay ? budget : background_delay;
+    };
+
+    void setLatencyBudget(uint32_t budget_ms) {
+        uint32_t previous = this->latency_budget_ms.exchange(budget_ms);
+        if (budget_ms < previous) {
+            // Messages already waiting get the shorter delay.
+            this->wakeUp();
+        }
+    };
+
+    // Sets the channel's delivery statistics on `stats`.
+    void getStats(v8::Isolate* isolate, v8::Local<v8::Object> stats) {
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        auto key = [&](const char* name) {
+            return v8::String::NewFromUtf8(isolate, name).ToLocalChecked();
+        };
+        this->queueMutex.lock();
+        size_t queued = this->messageQueue.size();
+        this->queueMutex.unlock();
+        stats->Set(context, key("latencyBudgetMs"), v8::Number::New(isolate, this->latency_budget_ms.load())).Check();
+        stats->Set(context, key("wakeups"), v8::Number::New(isolate, (double)this->wakeups)).Check();
+        stats->Set(context, key("delivered"), v8::Number::New(isolate, (double)this->delivered)).Check();
+        stats->Set(context, key("queued"), v8::Number::New(isolate, (double)queued)).Check();
+        stats->Set(context, key("sent"), v8::Number::New(isolate, (double)this->sent.load())).Check();
+    };
+
+    bool isRegisteredBy(v8::Isolate* isolate) {
+        return this->isolate == isolate;
+    };
+
+    const std::string& localName() {
+        return this->local_name;
+    };
+
+    // Detaches the channel from its environment, keeping the messages that
+    // are still queued, so the channel can be registered again by the next
+    // environment. Queued buffers go back to their producers, as the
+    // environment they were sent to is freed. Runs on the environment's
+    // thread.
+    void release(v8::Isolate* isolate) {
+        if (this->isolate != isolate) {
+            return;
+        }
+        std::vector<QueuedMessage> buffers;
+        this->queueMutex.lock();
+        std::queue<QueuedMessage> kept;
+        while (!this->messageQueue.empty()) {
+            QueuedMessage& message = this->messageQueue.front();
+            if (message.buffer != nullptr) {
+                buffers.push_back(message);
+            } else {
+                kept.push(message);
+            }
+            this->messageQueue.pop();
+        }
+        this->messageQueue.swap(kept);
+        this->queueMutex.unlock();
+        // Outside of the lock, as the producer may send again.
+        for (QueuedMessage& message : buffers) {
+            ReleaseAdoptedBuffer(message.data, message.length, message.buffer);
+        }
+        this->uvhandleMutex.lock();
+        if (this->queue_uv_handle != nullptr) {
+            initialized = false;
+            uv_close((uv_handle_t*)this->queue_uv_handle, [](uv_handle_t* handle) { free(handle); });
+            this->queue_uv_handle = nullptr;
+            uv_close((uv_handle_t*)this->coalescing_timer, [](uv_handle_t* handle) { free(handle); });
+            this->coalescing_timer = nullptr;
+        }
+        this->uvhandleMutex.unlock();
+        this->function.Reset();
+        this->isolate = nullptr;
     };
 
     // Process one message at the time, to simplify synchronization between
     // threads and minimize lock retention.
     void flushQueue() {
-        char* message = nullptr;
+        this->wakeups++;
+        uint32_t delay = this->coalescingDelay();
+        if (delay > 0) {
+            // A running timer is kept unless the delay got shorter.
+            if (!uv_is_active((uv_handle_t*)this->coalescing_timer) ||
+                uv_timer_get_due_in(this->coalescing_timer) > delay) {
+                uv_timer_start(this->coalescing_timer, FlushCoalescedMessages, delay, 0);
+            }
+            return;
+        }
+        // No longer coalescing, so what the timer would deliver goes now.
+        uv_timer_stop(this->coalescing_timer);
+
+        QueuedMessage message = {};
         bool empty = true;
 
         this->queueMutex.lock();
@@ -85,9 +263,11 @@ public:
         }
         this->queueMutex.unlock();
 
-        if (message != nullptr) {
+        if (message.data != nullptr) {
             this->invokeNodeListener(message);
-            free(message);
+            if (message.buffer == nullptr) {
+                free(message.data);
+            }
         }
 
         if (!empty) {
@@ -95,26 +275,79 @@ public:
         }
     };
 
+    // Delivers all the messages queued while coalescing, including the ones
+    // queued during the delivery, which didn't wake the loop up.
+    void flushCoalescedQueue() {
+        this->wakeups++;
+        while (true) {
+            QueuedMessage message = {};
+            this->queueMutex.lock();
+            if (!(this->messageQueue.empty())) {
+                message = this->messageQueue.front();
+                this->messageQueue.pop();
+            }
+            this->queueMutex.unlock();
+            if (message.data == nullptr) {
+                break;
+            }
+            this->invokeNodeListener(message);
+            if (message.buffer == nullptr) {
+                free(message.data);
+            }
+        }
+    };
+
     // Calls into Node to execute the registered Node listener.
-    // This method is always executed on the main libuv loop thread.
-    void invokeNodeListener(char* msg) {
+    // This method is always executed on the loop thread of the environment
+    // that registered the channel, which can be a worker thread.
+    void invokeNodeListener(const QueuedMessage& queued) {
+        char* msg = queued.data;
+        uint64_t trace_id = queued.trace_id;
         v8::HandleScope scope(isolate);
+        if (rn_recorder_enabled()) {
+            uint64_t now = rn_recorder_now_us();
+            uint64_t latency = queued.queued_us != 0 && now > queued.queued_us ? now - queued.queued_us : 0;
+            char description[48];
+            if (queued.buffer != nullptr) {
+                snprintf(description, sizeof(description), "[buffer of %zu bytes]", queued.length);
+            }
+            rn_recorder_message(RN_RECORD_TO_NODE, this->name.c_str(), queued.buffer != nullptr ? description : msg, latency);
+        }
+        if (trace_id != 0) {
+            rn_trace_event("invokeNodeListener", 'B', trace_id, this->name.c_str());
+            rn_trace_event("invokeNodeListener", 't', trace_id, this->name.c_str());
+        }
 
         v8::Local<v8::Function> node_function = v8::Local<v8::Function>::New(isolate, function);
         v8::Local<v8::Value> global = isolate->GetCurrentContext()->Global();
 
-        v8::Local<v8::String> channel_name = v8::String::NewFromUtf8(isolate, this->name.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
-        v8::Local<v8::String> message = v8::String::NewFromUtf8(isolate, msg, v8::NewStringType::kNormal).ToLocalChecked();
+        v8::Local<v8::String> channel_name = v8::String::NewFromUtf8(isolate, this->local_name.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+        v8::Local<v8::Value> message;
+        if (queued.buffer != nullptr) {
+            // The ArrayBuffer adopts the producer's memory.
+            std::unique_ptr<v8::BackingStore> store = v8::ArrayBuffer::NewBackingStore(
+                msg, queued.length, ReleaseAdoptedBuffer, queued.buffer);
+            message = v8::ArrayBuffer::New(isolate, std::move(store));
+        } else {
+            message = v8::String::NewFromUtf8(isolate, msg, v8::NewStringType::kNormal).ToLocalChecked();
+        }
+
+        v8::Local<v8::Number> message_trace_id = v8::Number::New(isolate, (double)trace_id);
 
-        const int argc = 2;
-        v8::Local<v8::Value> argv[argc] = { channel_name, message };
+        const int argc = 3;
+        v8::Local<v8::Value> argv[argc] = { channel_name, message, message_trace_id };
 
+        this->delivered++;
         v8::MaybeLocal<v8::Value> result = node_function->Call(isolate->GetCurrentContext(), global, argc, argv);
 
         if (!result.IsEmpty()) {
             v8::Local<v8::Value> local_result = result.ToLocalChecked();
             // Do something with the result if needed
         }
+
+        if (trace_id != 0) {
+            rn_trace_event("invokeNodeListener", 'E', trace_id, this->name.c_str());
+        }
     };
 };
 
@@ -126,12 +359,114 @@ void rn_register_node_data_dir_path(const char* path) {
     strncpy(datadir_path, path, pathLength);
 }
 
+const char* rn_bridge_data_dir() {
+    return datadir_path;
+}
+
 rn_bridge_cb embedder_callback=nullptr;
 
 void rn_register_bridge_cb(rn_bridge_cb _cb) {
     embedder_callback=_cb;
 }
 
+/**
+ * Native channel listeners
+ */
+struct NativeListener {
+    uint64_t id;
+    rn_bridge_listener listener;
+    void* data;
+    rn_bridge_executor executor;
+    void* executor_data;
+    std::atomic<bool> removed{false};
+};
+
+// A message handed to a listener's executor.
+struct NativeListenerTask {
+    std::shared_ptr<NativeListener> listener;
+    std::string channel;
+    std::string message;
+};
+
+std::mutex nativeListenersMutex;
+std::map<std::string, std::vector<std::shared_ptr<NativeListener>>> nativeListeners;
+// Lets the channels without native listeners skip the lookup.
+std::atomic<size_t> nativeListenerCount(0);
+uint64_t nextNativeListenerId = 1;
+
+void RunNativeListenerTask(void* arg) {
+    NativeListenerTask* task = (NativeListenerTask*)arg;
+    if (!task->listener->removed.load()) {
+        task->listener->listener(task->channel.c_str(), task->message.c_str(), task->listener->data);
+    }
+    delete task;
+}
+
+// Gives a message sent by Node to the native listeners of its channel.
+// Returns false if the channel has none.
+bool DispatchToNativeListeners(const char* channelName, const char* message) {
+    if (nativeListenerCount.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::vector<std::shared_ptr<NativeListener>> listeners;
+    nativeListenersMutex.lock();
+    auto it = nativeListeners.find(channelName);
+    if (it != nativeListeners.end()) {
+        listeners = it->second;
+    }
+    nativeListenersMutex.unlock();
+    if (listeners.empty()) {
+        return false;
+    }
+    for (auto& listener : listeners) {
+        if (listener->executor == nullptr) {
+            listener->listener(channelName, message, listener->data);
+        } else {
+            NativeListenerTask* task = new NativeListenerTask{ listener, channelName, message };
+            listener->executor(RunNativeListenerTask, task, listener->executor_data);
+        }
+    }
+    return true;
+}
+
+uint64_t rn_bridge_add_listener(const char* channelName, rn_bridge_listener listener, void* data,
+                                rn_bridge_executor executor, void* executor_data) {
+    if (channelName == nullptr || listener == nullptr) {
+        return 0;
+    }
+    std::shared_ptr<NativeListener> entry = std::make_shared<NativeListener>();
+    entry->listener = listener;
+    entry->data = data;
+    entry->executor = executor;
+    entry->executor_data = executor_data;
+    nativeListenersMutex.lock();
+    entry->id = nextNativeListenerId++;
+    nativeListeners[channelName].push_back(entry);
+    nativeListenerCount++;
+    nativeListenersMutex.unlock();
+    return entry->id;
+}
+
+bool rn_bridge_remove_listener(uint64_t id) {
+    std::lock_guard<std::mutex> lock(nativeListenersMutex);
+    for (auto it = nativeListeners.begin(); it != nativeListeners.end(); ++it) {
+        auto& listeners = it->second;
+        for (auto listener = listeners.begin(); listener != listeners.end(); ++listener) {
+            if ((*listener)->id != id) {
+                continue;
+            }
+            (*listener)->removed = true;
+            listeners.erase(listener);
+            if (listeners.empty()) {
+                nativeListeners.erase(it);
+            }
+            nativeListenerCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
 Channel* GetOrCreateChannel(std::string channelName) {
     channelsMutex.lock();
     Channel* channel = nullptr;
@@ -146,11 +481,113 @@ Channel* GetOrCreateChannel(std::string channelName) {
     return channel;
 };
 
+void rn_bridge_release_channels(v8::Isolate* isolate) {
+    channelsMutex.lock();
+    for (auto& entry : channels) {
+        entry.second->release(isolate);
+    }
+    namespaces.erase(isolate);
+    namespacesGeneration++;
+    channelsMutex.unlock();
+}
+
+void rn_bridge_set_namespace(v8::Isolate* isolate, const char* name) {
+    channelsMutex.lock();
+    namespaces[isolate] = std::string(name) + RN_BRIDGE_NAMESPACE_SEPARATOR;
+    namespacesGeneration++;
+    channelsMutex.unlock();
+}
+
+// Cleanup hook of the environments that load the binding, which includes
+// the worker threads, whose channels are released when they exit. For the
+// environments of rn-runtime, the channels are already released.
+void ReleaseChannelsOnCleanup(void* arg) {
+    v8::Isolate* isolate = (v8::Isolate*)arg;
+    rn_bridge_release_channels(isolate);
+    // Runs the close callbacks before the loop is closed.
+    uv_run(node::GetCurrentEventLoop(isolate), UV_RUN_NOWAIT);
+}
+
+// The native name of the channel `name` of the environment in `isolate`.
+std::string QualifiedChannelName(v8::Isolate* isolate, const std::string& name) {
+    channelsMutex.lock();
+    auto it = namespaces.find(isolate);
+    std::string qualified = it != namespaces.end() ? it->second + name : name;
+    channelsMutex.unlock();
+    return qualified;
+}
+
+/**
+ * Channels resolved by the sending threads, so sending a message to the
+ * application doesn't take channelsMutex. Channels are never deleted.
+ */
+struct SentChannels {
+    v8::Isolate* isolate = nullptr;
+    uint64_t generation = 0;
+    // By the name the isolate's environment knows them by.
+    std::map<std::string, Channel*, std::less<>> by_local_name;
+    // By qualified name, for rn_bridge_emit.
+    std::map<std::string, Channel*, std::less<>> by_name;
+};
+thread_local SentChannels sentChannels;
+
+// The channel `name` of the environment in `isolate`.
+Channel* SentChannel(v8::Isolate* isolate, const char* name) {
+    SentChannels& cache = sentChannels;
+    uint64_t generation = namespacesGeneration.load();
+    if (cache.isolate != isolate || cache.generation != generation) {
+        cache.by_local_name.clear();
+        cache.isolate = isolate;
+        cache.generation = generation;
+    }
+    auto it = cache.by_local_name.find(std::string_view(name));
+    if (it != cache.by_local_name.end()) {
+        return it->second;
+    }
+    Channel* channel = GetOrCreateChannel(QualifiedChannelName(isolate, name));
+    cache.by_local_name.emplace(name, channel);
+    return channel;
+}
+
+// The channel named `name`, outside of any namespace.
+Channel* SentChannel(const char* name) {
+    SentChannels& cache = sentChannels;
+    auto it = cache.by_name.find(std::string_view(name));
+    if (it != cache.by_name.end()) {
+        return it->second;
+    }
+    Channel* channel = GetOrCreateChannel(name);
+    cache.by_name.emplace(name, channel);
+    return channel;
+}
+
 void FlushMessageQueue(uv_async_t* handle) {
     Channel* channel = (Channel*)handle->data;
     channel->flushQueue();
 }
 
+void FlushCoalescedMessages(uv_timer_t* handle) {
+    Channel* channel = (Channel*)handle->data;
+    channel->flushCoalescedQueue();
+}
+
+void rn_bridge_set_latency_budget(const char* channelName, uint32_t budget_ms) {
+    GetOrCreateChannel(std::string(channelName))->setLatencyBudget(budget_ms);
+}
+
+void rn_bridge_set_coalescing_delay(uint32_t delay_ms) {
+    uint32_t previous = coalescingDelayMs.exchange(delay_ms);
+    if (previous == 0 || delay_ms != 0) {
+        return;
+    }
+    // Deliver what's waiting for the coalescing timers.
+    channelsMutex.lock();
+    for (auto& entry : channels) {
+        entry.second->wakeUp();
+    }
+    channelsMutex.unlock();
+}
+
 void Method_RegisterChannel(const v8::FunctionCallbackInfo<v8::Value>& args) {
     v8::Isolate* isolate = args.GetIsolate();
     if (args.Length() != 2) {
@@ -161,7 +598,8 @@ void Method_RegisterChannel(const v8::FunctionCallbackInfo<v8::Value>& args) {
     }
 
     v8::String::Utf8Value channel_name(isolate, args[0]);
-    std::string channel_name_str(*channel_name);
+    std::string channel_name_str = QualifiedChannelName(isolate, *channel_name);
+    std::string local_name_str(*channel_name);
 
     if (!args[1]->IsFunction()) {
         isolate->ThrowException(v8::Exception::TypeError(
@@ -175,12 +613,37 @@ void Method_RegisterChannel(const v8::FunctionCallbackInfo<v8::Value>& args) {
     v8::Persistent<v8::Function> ref_to_function(isolate, listener);
 
     Channel* channel = GetOrCreateChannel(channel_name_str);
-    channel->setV8Function(isolate, listener); // ref_to_function
+    channel->setV8Function(isolate, listener, local_name_str); // ref_to_function
+}
+
+// Sends a message to the application, for Node, native addons and
+// rn_bridge_emit alike, on the calling thread: messages sent by a thread
+// reach the application in the order it sent them.
+void SendToApp(Channel* channel, const char* message, uint64_t trace_id, const char* traced_channel) {
+    channel->countSent();
+    const char* channelName = channel->qualifiedName().c_str();
+
+    rn_recorder_message(RN_RECORD_TO_APP, channelName, message, 0);
+    rn_capture_message(RN_CAPTURE_TO_APP, channelName, message);
+    if (DispatchToNativeListeners(channelName, message)) {
+        if (trace_id != 0) {
+            rn_trace_event("native listeners", 'i', trace_id, traced_channel);
+        }
+    } else if (embedder_callback) {
+        if (trace_id != 0) {
+            rn_trace_event("emit to app", 'B', trace_id, traced_channel);
+            rn_trace_event("emit to app", 'f', trace_id, traced_channel);
+        }
+        embedder_callback(channelName, message);
+        if (trace_id != 0) {
+            rn_trace_event("emit to app", 'E', trace_id, traced_channel);
+        }
+    }
 }
 
 void Method_SendMessage(const v8::FunctionCallbackInfo<v8::Value>& args) {
     v8::Isolate* isolate = args.GetIsolate();
-    if (args.Length() != 2) {
+    if (args.Length() != 2 && args.Length() != 3) {
         isolate->ThrowException(v8::Exception::TypeError(
             v8::String::NewFromUtf8(isolate, "Wrong number of arguments.").ToLocalChecked()
         ));
@@ -188,13 +651,26 @@ void Method_SendMessage(const v8::FunctionCallbackInfo<v8::Value>& args) {
     }
 
     v8::String::Utf8Value channel_name(isolate, args[0]);
-    std::string channel_name_str(*channel_name);
+    Channel* channel = SentChannel(isolate, *channel_name);
 
     v8::String::Utf8Value message(isolate, args[1]);
     std::string message_str(*message);
 
-    if (embedder_callback) {
-        embedder_callback(channel_name_str.c_str(), message_str.c_str());
+    // An optional trace id links a reply to the message being handled.
+    uint64_t trace_id = 0;
+    const char* traced_channel = nullptr;
+    if (rn_trace_enabled()) {
+        bool is_reply = args.Length() == 3 && args[2]->IsNumber() && args[2].As<v8::Number>()->Value() > 0;
+        trace_id = is_reply ? (uint64_t)args[2].As<v8::Number>()->Value() : rn_trace_next_id();
+        traced_channel = rn_trace_intern(channel->qualifiedName());
+        rn_trace_event("sendMessage", 'B', trace_id, traced_channel);
+        rn_trace_event("sendMessage", is_reply ? 't' : 's', trace_id, traced_channel);
+    }
+
+    SendToApp(channel, message_str.c_str(), trace_id, traced_channel);
+
+    if (trace_id != 0) {
+        rn_trace_event("sendMessage", 'E', trace_id, traced_channel);
     }
 }
 
@@ -211,19 +687,164 @@ void Method_GetDataDir(const v8::FunctionCallbackInfo<v8::Value>& args) {
     args.GetReturnValue().Set(return_datadir);
 }
 
-void Init(v8::Local<v8::Object> exports) {
+// Returns the delivery statistics of the channels registered by this
+// environment, by channel name.
+void Method_GetChannelStats(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Object> result = v8::Object::New(isolate);
+    channelsMutex.lock();
+    for (auto& entry : channels) {
+        if (!entry.second->isRegisteredBy(isolate)) {
+            continue;
+        }
+        v8::Local<v8::Object> stats = v8::Object::New(isolate);
+        entry.second->getStats(isolate, stats);
+        result->Set(context, v8::String::NewFromUtf8(isolate, entry.second->localName().c_str()).ToLocalChecked(), stats).Check();
+    }
+    channelsMutex.unlock();
+    args.GetReturnValue().Set(result);
+}
+
+// Returns the name of this environment's namespace, empty for the main
+// environment.
+void Method_GetNamespace(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    std::string prefix = QualifiedChannelName(isolate, "");
+    if (!prefix.empty()) {
+        prefix.resize(prefix.size() - strlen(RN_BRIDGE_NAMESPACE_SEPARATOR));
+    }
+    args.GetReturnValue().Set(v8::String::NewFromUtf8(isolate, prefix.c_str()).ToLocalChecked());
+}
+
+// Puts a worker thread in the namespace of the environment that started it,
+// before it registers any channel.
+void Method_SetNamespace(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() != 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected a namespace name.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::String::Utf8Value name(isolate, args[0]);
+    if (!QualifiedChannelName(isolate, "").empty()) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "The namespace is already set.").ToLocalChecked()
+        ));
+        return;
+    }
+    if (strlen(*name) > 0) {
+        rn_bridge_set_namespace(isolate, *name);
+    }
+}
+
+// Detaches an ArrayBuffer adopting a buffer of rn_bridge_send_buffer, so
+// its producer gets it back right away instead of after garbage collection.
+void Method_ReleaseBuffer(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() != 1 || !args[0]->IsArrayBuffer()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected an ArrayBuffer.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::Local<v8::ArrayBuffer> buffer = args[0].As<v8::ArrayBuffer>();
+    if (buffer->IsDetachable() && !buffer->WasDetached()) {
+        buffer->Detach();
+    }
+}
+
+// Called for each environment that loads the binding, including worker
+// threads, so their channels are delivered on their own loop and isolate.
+void Init(v8::Local<v8::Object> exports,
+          v8::Local<v8::Value> module,
+          v8::Local<v8::Context> context,
+          void* priv) {
+    node::AddEnvironmentCleanupHook(context->GetIsolate(), ReleaseChannelsOnCleanup, context->GetIsolate());
     NODE_SET_METHOD(exports, "sendMessage", Method_SendMessage);
     NODE_SET_METHOD(exports, "registerChannel", Method_RegisterChannel);
     NODE_SET_METHOD(exports, "getDataDir", Method_GetDataDir);
+    NODE_SET_METHOD(exports, "getChannelStats", Method_GetChannelStats);
+    NODE_SET_METHOD(exports, "getNamespace", Method_GetNamespace);
+    NODE_SET_METHOD(exports, "setNamespace", Method_SetNamespace);
+    NODE_SET_METHOD(exports, "releaseBuffer", Method_ReleaseBuffer);
+    rn_profiler_init(exports);
+    rn_trace_init(exports);
+    rn_threads_init(exports);
+    rn_pool_init(exports);
+    rn_allocator_init(exports);
+    rn_recorder_init(exports);
+    rn_capture_init(exports);
+    rn_addon_init(exports);
+}
+
+void rn_bridge_emit(const char* channelName, const char* message) {
+    uint64_t trace_id = 0;
+    const char* traced_channel = nullptr;
+    if (rn_trace_enabled()) {
+        trace_id = rn_trace_next_id();
+        traced_channel = rn_trace_intern(channelName);
+        rn_trace_event("emit", 'B', trace_id, traced_channel);
+        rn_trace_event("emit", 's', trace_id, traced_channel);
+    }
+    SendToApp(SentChannel(channelName), message, trace_id, traced_channel);
+    if (trace_id != 0) {
+        rn_trace_event("emit", 'E', trace_id, traced_channel);
+    }
 }
 
 void rn_bridge_notify(const char* channelName, const char *message) {
+    rn_capture_message(RN_CAPTURE_TO_NODE, channelName, message);
     int messageLength=strlen(message);
     char* messageCopy = (char*)calloc(sizeof(char),messageLength + 1);
     strncpy(messageCopy, message, messageLength);
 
     Channel* channel = GetOrCreateChannel(std::string(channelName));
-    channel->queueMessage(messageCopy);
+
+    uint64_t trace_id = 0;
+    if (rn_trace_enabled()) {
+        trace_id = rn_trace_next_id();
+        const char* traced_channel = rn_trace_intern(channelName);
+        rn_trace_event("enqueue", 'B', trace_id, traced_channel);
+        rn_trace_event("enqueue", 's', trace_id, traced_channel);
+        rn_trace_event("enqueue", 'E', trace_id, traced_channel);
+    }
+    channel->queueMessage(messageCopy, trace_id);
+}
+
+// Deleter of the ArrayBuffers adopting a buffer. V8 can call it on any
+// thread.
+void ReleaseAdoptedBuffer(void* data, size_t length, void* deleter_data) {
+    AdoptedBuffer* buffer = (AdoptedBuffer*)deleter_data;
+    if (buffer->free_cb != nullptr) {
+        buffer->free_cb(data, length, buffer->user_data);
+    }
+    delete buffer;
+}
+
+rn_bridge_channel rn_bridge_get_channel(const char* channelName) {
+    if (channelName == nullptr) {
+        return nullptr;
+    }
+    return (rn_bridge_channel)GetOrCreateChannel(std::string(channelName));
+}
+
+bool rn_bridge_send_buffer(rn_bridge_channel handle, void* data, size_t length, rn_bridge_free_cb free_cb, void* user_data) {
+    Channel* channel = (Channel*)handle;
+    if (channel == nullptr || data == nullptr || channel->isSystemChannel()) {
+        return false;
+    }
+    uint64_t trace_id = 0;
+    if (rn_trace_enabled()) {
+        trace_id = rn_trace_next_id();
+        const char* traced_channel = rn_trace_intern(channel->qualifiedName());
+        rn_trace_event("enqueue", 'B', trace_id, traced_channel);
+        rn_trace_event("enqueue", 's', trace_id, traced_channel);
+        rn_trace_event("enqueue", 'E', trace_id, traced_channel);
+    }
+    channel->queueMessage((char*)data, trace_id, new AdoptedBuffer{ free_cb, user_data }, length);
+    return true;
 }
 
 NODE_MODULE_LINKED(rn_bridge, Init);
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "node.h"
+#include "uv.h"
+#include "rn-bridge.h"
+#include "rn-pool.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <cstdlib>
+
+/**
+ * Worker pool.
+ *
+ * Each worker runs in its own Node environment, started by the platform
+ * side, and has its own queue of jobs. Submitted jobs are queued on the
+ * workers in turn. A worker takes the oldest job of its own queue and, once
+ * it's empty, steals the newest job of another worker's queue, so a worker
+ * stuck on a long job doesn't hold back the jobs queued behind it.
+ *
+ * The size only changes while no worker is attached and no job is queued,
+ * so every queued job is on a worker that takes or steals from it.
+ */
+
+namespace {
+
+struct PoolJob {
+    std::string id;
+    std::string module;
+    std::string args;
+    std::string reply_channel;
+};
+
+struct PoolWorker {
+    std::mutex mutex;
+    std::deque<PoolJob> jobs;
+    // Set while the worker's environment runs, guarded by `mutex`.
+    uv_async_t* wakeup = nullptr;
+    // Used on the worker's thread only.
+    v8::Isolate* isolate = nullptr;
+    v8::Persistent<v8::Function> listener;
+    // Set when the worker found no job to take.
+    std::atomic<bool> idle{false};
+};
+
+PoolWorker workers[RN_POOL_MAX_WORKERS];
+std::atomic<int> poolSize(0);
+// Guards the size changes against the workers attaching.
+std::mutex sizeMutex;
+int attachedWorkers = 0;
+std::atomic<uint32_t> nextWorker(0);
+
+void WakeUp(PoolWorker& worker) {
+    worker.mutex.lock();
+    if (worker.wakeup != nullptr) {
+        uv_async_send(worker.wakeup);
+    }
+    worker.mutex.unlock();
+}
+
+// Lets the worker's JavaScript know there may be jobs to take.
+void OnWakeUp(uv_async_t* handle) {
+    PoolWorker* worker = (PoolWorker*)handle->data;
+    v8::Isolate* isolate = worker->isolate;
+    v8::HandleScope scope(isolate);
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Function> listener = v8::Local<v8::Function>::New(isolate, worker->listener);
+    // An exception thrown by the listener is reported by Node.
+    v8::MaybeLocal<v8::Value> result = listener->Call(context, context->Global(), 0, nullptr);
+    if (result.IsEmpty()) {
+        return;
+    }
+}
+
+// Environment cleanup hook of a worker. Jobs still queued on it are left for
+// the other workers, or the next worker started with its index.
+void DetachWorker(void* arg) {
+    PoolWorker* worker = (PoolWorker*)arg;
+    uv_loop_t* loop = nullptr;
+    worker->mutex.lock();
+    if (worker->wakeup != nullptr) {
+        loop = worker->wakeup->loop;
+        uv_close((uv_handle_t*)worker->wakeup, [](uv_handle_t* handle) { free(handle); });
+        worker->wakeup = nullptr;
+    }
+    worker->mutex.unlock();
+    if (loop != nullptr) {
+        // Runs the close callback before the loop is closed.
+        uv_run(loop, UV_RUN_NOWAIT);
+    }
+    worker->listener.Reset();
+    worker->isolate = nullptr;
+    worker->idle = false;
+    sizeMutex.lock();
+    attachedWorkers--;
+    sizeMutex.unlock();
+}
+
+// Takes the next job of worker `index`, stealing one if its queue is empty.
+bool TakeJob(int index, PoolJob* job) {
+    int size = poolSize.load();
+    for (int i = 0; i < size; i++) {
+        PoolWorker& worker = workers[(index + i) % size];
+        worker.mutex.lock();
+        if (!worker.jobs.empty()) {
+            if (i == 0) {
+                *job = std::move(worker.jobs.front());
+                worker.jobs.pop_front();
+            } else {
+                *job = std::move(worker.jobs.back());
+                worker.jobs.pop_back();
+            }
+            worker.mutex.unlock();
+            workers[index].idle = false;
+            return true;
+        }
+        worker.mutex.unlock();
+    }
+    workers[index].idle = true;
+    return false;
+}
+
+// Returns the worker index given by the JavaScript side, or -1 after
+// throwing if it isn't valid.
+int WorkerIndex(v8::Isolate* isolate, v8::Local<v8::Value> value) {
+    int index = value->IsInt32() ? value.As<v8::Int32>()->Value() : -1;
+    if (index < 0 || index >= poolSize.load()) {
+        isolate->ThrowException(v8::Exception::RangeError(
+            v8::String::NewFromUtf8(isolate, "Invalid worker index.").ToLocalChecked()
+        ));
+        return -1;
+    }
+    return index;
+}
+
+// attachPoolWorker(index, listener): makes this environment the worker
+// `index`. `listener` is called when jobs may be waiting.
+void Method_AttachPoolWorker(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() != 2 || !args[1]->IsFunction()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected a worker index and a function.").ToLocalChecked()
+        ));
+        return;
+    }
+    int index = WorkerIndex(isolate, args[0]);
+    if (index < 0) {
+        return;
+    }
+    PoolWorker& worker = workers[index];
+    sizeMutex.lock();
+    worker.mutex.lock();
+    if (worker.wakeup != nullptr) {
+        worker.mutex.unlock();
+        sizeMutex.unlock();
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "Worker already attached.").ToLocalChecked()
+        ));
+        return;
+    }
+    worker.isolate = isolate;
+    worker.listener.Reset(isolate, args[1].As<v8::Function>());
+    worker.wakeup = (uv_async_t*)malloc(sizeof(uv_async_t));
+    uv_async_init(node::GetCurrentEventLoop(isolate), worker.wakeup, OnWakeUp);
+    worker.wakeup->data = (void*)&worker;
+    // Takes the jobs queued before the worker started.
+    uv_async_send(worker.wakeup);
+    worker.mutex.unlock();
+    attachedWorkers++;
+    sizeMutex.unlock();
+    node::AddEnvironmentCleanupHook(isolate, DetachWorker, &worker);
+
+    // Lets the application know the worker is up.
+    std::string system_channel = RN_POOL_ENVIRONMENT_PREFIX + std::to_string(index) +
+                                 RN_BRIDGE_NAMESPACE_SEPARATOR "_SYSTEM_";
+    rn_bridge_emit(system_channel.c_str(), RN_POOL_ATTACHED_MESSAGE);
+}
+
+// takePoolJob(index): returns [id, module, args, replyChannel] for the next
+// job of the worker, or undefined when there's none left.
+void Method_TakePoolJob(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    int index = WorkerIndex(isolate, args[0]);
+    if (index < 0) {
+        return;
+    }
+    PoolJob job;
+    if (!TakeJob(index, &job)) {
+        return;
+    }
+    v8::Local<v8::Value> fields[] = {
+        v8::String::NewFromUtf8(isolate, job.id.c_str()).ToLocalChecked(),
+        v8::String::NewFromUtf8(isolate, job.module.c_str()).ToLocalChecked(),
+        v8::String::NewFromUtf8(isolate, job.args.c_str()).ToLocalChecked(),
+        v8::String::NewFromUtf8(isolate, job.reply_channel.c_str()).ToLocalChecked(),
+    };
+    args.GetReturnValue().Set(v8::Array::New(isolate, fields, 4));
+}
+
+// replyPoolJob(replyChannel, message): sends a job's result to the
+// application, on the channel given with the job.
+void Method_ReplyPoolJob(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() != 2) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Wrong number of arguments.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::String::Utf8Value reply_channel(isolate, args[0]);
+    v8::String::Utf8Value message(isolate, args[1]);
+    rn_bridge_emit(*reply_channel, *message);
+}
+
+}  // namespace
+
+int rn_pool_set_size(int size) {
+    if (size < 1) {
+        size = 1;
+    } else if (size > RN_POOL_MAX_WORKERS) {
+        size = RN_POOL_MAX_WORKERS;
+    }
+    std::lock_guard<std::mutex> lock(sizeMutex);
+    if (size == poolSize.load()) {
+        return size;
+    }
+    if (attachedWorkers > 0) {
+        return -1;
+    }
+    for (int i = 0; i < RN_POOL_MAX_WORKERS; i++) {
+        std::lock_guard<std::mutex> worker_lock(workers[i].mutex);
+        if (!workers[i].jobs.empty()) {
+            return -1;
+        }
+    }
+    poolSize = size;
+    return size;
+}
+
+void rn_pool_submit(const char* job_id, const char* module, const char* args, const char* reply_channel) {
+    int size = poolSize.load();
+    if (size == 0) {
+        size = rn_pool_set_size(1);
+    }
+    PoolWorker& target = workers[nextWorker++ % size];
+    target.mutex.lock();
+    target.jobs.push_back({ job_id, module, args, reply_channel });
+    target.mutex.unlock();
+    WakeUp(target);
+    if (target.idle) {
+        return;
+    }
+    // The worker is busy, so an idle one steals the job.
+    for (int i = 0; i < size; i++) {
+        if (workers[i].idle) {
+            WakeUp(workers[i]);
+            break;
+        }
+    }
+}
+
+int rn_pool_clear() {
+    int dropped = 0;
+    for (int i = 0; i < RN_POOL_MAX_WORKERS; i++) {
+        workers[i].mutex.lock();
+        dropped += (int)workers[i].jobs.size();
+        workers[i].jobs.clear();
+        workers[i].mutex.unlock();
+    }
+    return dropped;
+}
+
+void rn_pool_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "attachPoolWorker", Method_AttachPoolWorker);
+    NODE_SET_METHOD(exports, "takePoolJob", Method_TakePoolJob);
+    NODE_SET_METHOD(exports, "replyPoolJob", Method_ReplyPoolJob);
+}
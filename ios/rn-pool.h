@@ -0,0 +1,34 @@
+#ifndef SRC_RN_POOL_H_
+#define SRC_RN_POOL_H_
+
+#include "node.h"
+
+// Prefix of the names of the environments running the pool's workers,
+// followed by the worker's index.
+#define RN_POOL_ENVIRONMENT_PREFIX "_pool"
+
+// Sets the number of workers of the pool, before they are started. Returns
+// the number actually used, at most RN_POOL_MAX_WORKERS, or -1 without
+// changing it while a worker is attached or a job is queued.
+#define RN_POOL_MAX_WORKERS 64
+int rn_pool_set_size(int size);
+
+// Queues a job: the function exported by `module`, relative to the
+// nodejs-project, is called with the arguments of the JSON array `args`, and
+// its result is sent to the application on `reply_channel`. Jobs are queued
+// on the workers in turn, and idle workers steal the jobs queued on busy
+// ones. Jobs queued before the workers start wait for them.
+void rn_pool_submit(const char* job_id, const char* module, const char* args, const char* reply_channel);
+
+// Drops the jobs that haven't been taken by a worker. Returns how many were
+// dropped.
+int rn_pool_clear();
+
+// Sent by a worker on the system channel of its environment once it's
+// attached and takes jobs. Must match the one in index.js.
+#define RN_POOL_ATTACHED_MESSAGE "pool-attached"
+
+// Adds the methods used by the pool's workers to the rn_bridge binding.
+void rn_pool_init(v8::Local<v8::Object> exports);
+
+#endif
@@ -0,0 +1,345 @@
+#include "node.h"
+#include "uv.h"
+#include "v8-profiler.h"
+#include "rn-profiler.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+/**
+ * Continuous sampling profiler.
+ *
+ * Samples the JS stack of a Node thread with V8's CPU profiler at a low rate
+ * and folds each time window's call tree into a fixed-size ring of
+ * "stack -> sample count" maps. The last minutes of samples can then be
+ * written out in the folded format understood by flamegraph tools.
+ * All methods run on the thread that owns the profiled isolate.
+ */
+
+namespace {
+
+const int kDefaultFrequencyHz = 20;
+const int kMaxFrequencyHz = 100;
+const int kDefaultMinutes = 5;
+const int kMaxMinutes = 30;
+const int kWindowSeconds = 10;
+// Bounds for the memory used by a single window.
+const size_t kMaxStacksPerWindow = 2048;
+const int kMaxStackDepth = 64;
+
+uint64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t ThreadCpuUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct ProfileWindow {
+    uint64_t start_ms = 0;
+    uint64_t end_ms = 0;
+    std::map<std::string, uint32_t> stacks;
+};
+
+class SamplingProfiler {
+private:
+    v8::Isolate* isolate;
+    v8::CpuProfiler* profiler = nullptr;
+    v8::ProfilerId profile_id = 0;
+    uv_timer_t* timer = nullptr;
+    std::vector<ProfileWindow> windows;
+    size_t next_window = 0;
+    uint64_t window_start_ms = 0;
+    int frequency_hz = 0;
+    // The history kept by the last start, dumped by default.
+    int history_minutes = kDefaultMinutes;
+
+    // Accounting, to keep the profiler's own cost visible.
+    uint64_t started_at_ms = 0;
+    uint64_t samples = 0;
+    uint64_t dropped_samples = 0;
+    uint64_t folded_windows = 0;
+    uint64_t fold_cpu_us = 0;
+
+    static void OnWindowTimer(uv_timer_t* handle) {
+        SamplingProfiler* self = (SamplingProfiler*)handle->data;
+        self->rotateWindow();
+    };
+
+    void startWindow() {
+        // max_samples = 0: keep only the aggregated tree, not every sample.
+        v8::CpuProfilingResult result = profiler->Start(
+            v8::CpuProfilingOptions(v8::kLeafNodeLineNumbers, 0));
+        profile_id = result.id;
+        window_start_ms = NowMs();
+    };
+
+    void finishWindow() {
+        v8::CpuProfile* profile = profiler->Stop(profile_id);
+        if (profile == nullptr) {
+            return;
+        }
+        uint64_t cpu_start = ThreadCpuUs();
+
+        ProfileWindow& window = windows[next_window];
+        window.start_ms = window_start_ms;
+        window.end_ms = NowMs();
+        window.stacks.clear();
+        std::vector<std::string> frames;
+        foldNode(profile->GetTopDownRoot(), frames, window);
+        next_window = (next_window + 1) % windows.size();
+        folded_windows++;
+        profile->Delete();
+
+        fold_cpu_us += ThreadCpuUs() - cpu_start;
+    };
+
+    void foldNode(const v8::CpuProfileNode* node, std::vector<std::string>& frames, ProfileWindow& window) {
+        bool is_root = node->GetParent() == nullptr;
+        if (!is_root) {
+            frames.push_back(frameName(node));
+        }
+
+        unsigned hits = node->GetHitCount();
+        if (hits > 0 && !frames.empty()) {
+            samples += hits;
+            std::string stack;
+            size_t first = frames.size() > (size_t)kMaxStackDepth ? frames.size() - kMaxStackDepth : 0;
+            for (size_t i = first; i < frames.size(); i++) {
+                if (i != first) stack += ';';
+                stack += frames[i];
+            }
+            auto it = window.stacks.find(stack);
+            if (it != window.stacks.end()) {
+                it->second += hits;
+            } else if (window.stacks.size() < kMaxStacksPerWindow) {
+                window.stacks[stack] = hits;
+            } else {
+                dropped_samples += hits;
+            }
+        }
+
+        int children = node->GetChildrenCount();
+        for (int i = 0; i < children; i++) {
+            foldNode(node->GetChild(i), frames, window);
+        }
+
+        if (!is_root) {
+            frames.pop_back();
+        }
+    };
+
+    static std::string frameName(const v8::CpuProfileNode* node) {
+        std::string name = node->GetFunctionNameStr();
+        if (name.empty()) {
+            name = "(anonymous)";
+        }
+        std::string resource = node->GetScriptResourceNameStr();
+        if (!resource.empty()) {
+            name += " (" + resource + ":" + std::to_string(node->GetLineNumber()) + ")";
+        }
+        // ';' separates frames in the folded format.
+        for (char& c : name) {
+            if (c == ';') c = ':';
+        }
+        return name;
+    };
+
+public:
+    SamplingProfiler(v8::Isolate* isolate) : isolate(isolate) {};
+
+    bool isRunning() {
+        return profiler != nullptr;
+    };
+
+    void start(int hz, int minutes) {
+        if (isRunning()) {
+            stop();
+        }
+        frequency_hz = hz;
+        history_minutes = minutes;
+        windows.assign((minutes * 60 + kWindowSeconds - 1) / kWindowSeconds, ProfileWindow());
+        next_window = 0;
+        started_at_ms = NowMs();
+        samples = 0;
+        dropped_samples = 0;
+        folded_windows = 0;
+        fold_cpu_us = 0;
+
+        profiler = v8::CpuProfiler::New(isolate);
+        profiler->SetSamplingInterval(1000000 / hz);
+        startWindow();
+
+        timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+        uv_timer_init(node::GetCurrentEventLoop(isolate), timer);
+        timer->data = (void*)this;
+        uv_timer_start(timer, OnWindowTimer, kWindowSeconds * 1000, kWindowSeconds * 1000);
+        // The profiler must never keep the event loop alive by itself.
+        uv_unref((uv_handle_t*)timer);
+    };
+
+    // Stops sampling. Windows collected so far are kept and can still be dumped.
+    void stop() {
+        if (!isRunning()) {
+            return;
+        }
+        uv_timer_stop(timer);
+        uv_close((uv_handle_t*)timer, [](uv_handle_t* handle) { free(handle); });
+        timer = nullptr;
+        finishWindow();
+        profiler->Dispose();
+        profiler = nullptr;
+    };
+
+    void rotateWindow() {
+        finishWindow();
+        startWindow();
+    };
+
+    int historyMinutes() {
+        return history_minutes;
+    };
+
+    // Writes the stacks of the last `minutes` to `path` in folded format.
+    // Returns the number of distinct stacks written, or -1 on I/O errors.
+    int dump(const char* path, int minutes) {
+        if (isRunning()) {
+            rotateWindow();
+        }
+        uint64_t since_ms = NowMs() - (uint64_t)minutes * 60 * 1000;
+        std::map<std::string, uint64_t> merged;
+        for (const ProfileWindow& window : windows) {
+            if (window.end_ms == 0 || window.end_ms < since_ms) continue;
+            for (const auto& entry : window.stacks) {
+                merged[entry.first] += entry.second;
+            }
+        }
+
+        FILE* file = fopen(path, "w");
+        if (file == nullptr) {
+            return -1;
+        }
+        for (const auto& entry : merged) {
+            fprintf(file, "%s %llu\n", entry.first.c_str(), (unsigned long long)entry.second);
+        }
+        fclose(file);
+        return (int)merged.size();
+    };
+
+    v8::Local<v8::Object> stats() {
+        v8::Local<v8::Context> context = isolate->GetCurrentContext();
+        v8::Local<v8::Object> result = v8::Object::New(isolate);
+        auto set = [&](const char* key, v8::Local<v8::Value> value) {
+            result->Set(context, v8::String::NewFromUtf8(isolate, key).ToLocalChecked(), value).Check();
+        };
+        set("running", v8::Boolean::New(isolate, isRunning()));
+        set("frequency", v8::Integer::New(isolate, frequency_hz));
+        set("windowSeconds", v8::Integer::New(isolate, kWindowSeconds));
+        set("windows", v8::Number::New(isolate, (double)windows.size()));
+        set("foldedWindows", v8::Number::New(isolate, (double)folded_windows));
+        set("samples", v8::Number::New(isolate, (double)samples));
+        set("droppedSamples", v8::Number::New(isolate, (double)dropped_samples));
+        set("elapsedMs", v8::Number::New(isolate, started_at_ms ? (double)(NowMs() - started_at_ms) : 0));
+        set("foldCpuMs", v8::Number::New(isolate, fold_cpu_us / 1000.0));
+        return result;
+    };
+};
+
+std::mutex profilersMutex;
+std::map<v8::Isolate*, SamplingProfiler*> profilers;
+
+void DeleteProfiler(void* arg) {
+    v8::Isolate* isolate = (v8::Isolate*)arg;
+    profilersMutex.lock();
+    auto it = profilers.find(isolate);
+    SamplingProfiler* profiler = nullptr;
+    if (it != profilers.end()) {
+        profiler = it->second;
+        profilers.erase(it);
+    }
+    profilersMutex.unlock();
+    if (profiler != nullptr) {
+        profiler->stop();
+        delete profiler;
+    }
+}
+
+SamplingProfiler* GetOrCreateProfiler(v8::Isolate* isolate) {
+    profilersMutex.lock();
+    SamplingProfiler* profiler = nullptr;
+    auto it = profilers.find(isolate);
+    if (it != profilers.end()) {
+        profiler = it->second;
+    } else {
+        profiler = new SamplingProfiler(isolate);
+        profilers[isolate] = profiler;
+        node::AddEnvironmentCleanupHook(isolate, DeleteProfiler, isolate);
+    }
+    profilersMutex.unlock();
+    return profiler;
+}
+
+int IntArgument(const v8::FunctionCallbackInfo<v8::Value>& args, int index, int default_value, int min, int max) {
+    if (args.Length() <= index || !args[index]->IsNumber()) {
+        return default_value;
+    }
+    int value = (int)args[index].As<v8::Number>()->Value();
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+void Method_StartProfiler(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    int hz = IntArgument(args, 0, kDefaultFrequencyHz, 1, kMaxFrequencyHz);
+    int minutes = IntArgument(args, 1, kDefaultMinutes, 1, kMaxMinutes);
+    GetOrCreateProfiler(isolate)->start(hz, minutes);
+}
+
+void Method_StopProfiler(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    GetOrCreateProfiler(args.GetIsolate())->stop();
+}
+
+void Method_DumpProfile(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    if (args.Length() < 1 || !args[0]->IsString()) {
+        isolate->ThrowException(v8::Exception::TypeError(
+            v8::String::NewFromUtf8(isolate, "Expected a file path.").ToLocalChecked()
+        ));
+        return;
+    }
+    v8::String::Utf8Value path(isolate, args[0]);
+    SamplingProfiler* profiler = GetOrCreateProfiler(isolate);
+    int minutes = IntArgument(args, 1, profiler->historyMinutes(), 1, kMaxMinutes);
+
+    int stacks = profiler->dump(*path, minutes);
+    if (stacks < 0) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "Could not write the profile file.").ToLocalChecked()
+        ));
+        return;
+    }
+    args.GetReturnValue().Set(v8::Integer::New(isolate, stacks));
+}
+
+void Method_GetProfilerStats(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    args.GetReturnValue().Set(GetOrCreateProfiler(args.GetIsolate())->stats());
+}
+
+}  // namespace
+
+void rn_profiler_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "startProfiler", Method_StartProfiler);
+    NODE_SET_METHOD(exports, "stopProfiler", Method_StopProfiler);
+    NODE_SET_METHOD(exports, "dumpProfile", Method_DumpProfile);
+    NODE_SET_METHOD(exports, "getProfilerStats", Method_GetProfilerStats);
+}
@@ -0,0 +1,9 @@
+#ifndef SRC_RN_PROFILER_H_
+#define SRC_RN_PROFILER_H_
+
+#include "node.h"
+
+// Registers the continuous sampling profiler methods on the rn_bridge binding.
+void rn_profiler_init(v8::Local<v8::Object> exports);
+
+#endif
@@ -0,0 +1,331 @@
+#include "node.h"
+#include "rn-bridge.h"
+#include "rn-recorder.h"
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Flight recorder.
+ *
+ * The recording file is a header followed by fixed-size slots. A writer
+ * takes the next sequence number from the header with an atomic increment,
+ * which gives it a slot of its own, clears the slot's sequence, fills the
+ * slot and then publishes the sequence, so a slot left half-written by a
+ * crash, or read while being written, is recognized and skipped. Stores to
+ * a shared mapping reach the file even if the process is killed right
+ * after.
+ */
+
+std::atomic<bool> rn_recorder_active(false);
+
+namespace {
+
+const char kMagic[8] = { 'R', 'N', 'F', 'L', 'I', 'G', 'H', 'T' };
+const uint32_t kVersion = 1;
+const size_t kMinSlots = 64;
+
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t slot_count;
+    uint64_t started_us;
+    uint64_t pid;
+    // Sequence number of the next record.
+    uint64_t next;
+    char reserved[208];
+};
+
+struct RecordSlot {
+    // The record's sequence number plus one, 0 while it's being written.
+    uint64_t sequence;
+    uint64_t timestamp_us;
+    uint32_t latency_us;
+    // Size of the whole message, of which `data` keeps the start.
+    uint32_t size;
+    uint16_t kind;
+    uint16_t level;
+    uint16_t data_length;
+    uint16_t channel_length;
+    char channel[32];
+    char data[RN_RECORDER_MAX_PAYLOAD];
+};
+
+static_assert(sizeof(RecordingHeader) == 256, "Recording header layout");
+static_assert(sizeof(RecordSlot) == 256, "Record layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Records need lock-free 64-bit atomics");
+
+std::mutex configureMutex;
+// Set once the file is mapped, and never unmapped.
+std::atomic<RecordingHeader*> recording(nullptr);
+std::atomic<size_t> payloadBytes(0);
+
+std::atomic<uint64_t>* AsAtomic(uint64_t* value) {
+    return reinterpret_cast<std::atomic<uint64_t>*>(value);
+}
+
+RecordSlot* Slots(RecordingHeader* header) {
+    return reinterpret_cast<RecordSlot*>(header + 1);
+}
+
+std::string RecordingPath(const char* file) {
+    return std::string(rn_bridge_data_dir()) + "/" + file;
+}
+
+RecordingHeader* CreateRecording(size_t size_bytes) {
+    if (rn_bridge_data_dir() == nullptr) {
+        return nullptr;
+    }
+    std::string path = RecordingPath(RN_RECORDER_FILE);
+    std::string previous_path = RecordingPath(RN_RECORDER_PREVIOUS_FILE);
+    if (rename(path.c_str(), previous_path.c_str()) != 0 && errno != ENOENT) {
+        fprintf(stderr, "Couldn't keep the previous flight recording: %s\n", strerror(errno));
+    }
+
+    size_t slot_count = std::max(kMinSlots, size_bytes / sizeof(RecordSlot));
+    size_t file_size = sizeof(RecordingHeader) + slot_count * sizeof(RecordSlot);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return nullptr;
+    }
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, (off_t)file_size) == 0) {
+        mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        unlink(path.c_str());
+        return nullptr;
+    }
+
+    RecordingHeader* header = (RecordingHeader*)mapping;
+    header->version = kVersion;
+    header->slot_size = sizeof(RecordSlot);
+    header->slot_count = slot_count;
+    header->started_us = rn_recorder_now_us();
+    header->pid = (uint64_t)getpid();
+    header->next = 0;
+    // Written last, so a file left half-initialized isn't read.
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, kMagic, sizeof kMagic);
+    return header;
+}
+
+void Record(RNRecordKind kind, int level, const char* channel, const char* data, size_t size, size_t data_length, uint64_t latency_us) {
+    RecordingHeader* header = recording.load(std::memory_order_acquire);
+    if (header == nullptr) {
+        return;
+    }
+    uint64_t sequence = AsAtomic(&header->next)->fetch_add(1, std::memory_order_relaxed);
+    RecordSlot* slot = &Slots(header)[sequence % header->slot_count];
+    AsAtomic(&slot->sequence)->store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->timestamp_us = rn_recorder_now_us();
+    slot->latency_us = (uint32_t)std::min<uint64_t>(latency_us, UINT32_MAX);
+    slot->size = (uint32_t)std::min<size_t>(size, UINT32_MAX);
+    slot->kind = (uint16_t)kind;
+    slot->level = (uint16_t)level;
+    size_t channel_length = channel != nullptr ? std::min(strlen(channel), sizeof slot->channel) : 0;
+    memcpy(slot->channel, channel, channel_length);
+    slot->channel_length = (uint16_t)channel_length;
+    data_length = std::min(data_length, sizeof slot->data);
+    memcpy(slot->data, data, data_length);
+    slot->data_length = (uint16_t)data_length;
+
+    AsAtomic(&slot->sequence)->store(sequence + 1, std::memory_order_release);
+}
+
+// Copies the complete records of a recording, in order. Returns false if
+// `data` isn't a recording.
+bool ReadRecording(const char* data, size_t size, RecordingHeader* header, std::vector<RecordSlot>* records) {
+    if (size < sizeof(RecordingHeader)) {
+        return false;
+    }
+    const RecordingHeader* source = (const RecordingHeader*)data;
+    if (memcmp(source->magic, kMagic, sizeof kMagic) != 0 || source->version != kVersion ||
+        source->slot_size != sizeof(RecordSlot) ||
+        source->slot_count > (size - sizeof(RecordingHeader)) / sizeof(RecordSlot)) {
+        return false;
+    }
+    memcpy(header, source, sizeof(RecordingHeader));
+    const RecordSlot* slots = (const RecordSlot*)(source + 1);
+    for (uint64_t i = 0; i < header->slot_count; i++) {
+        RecordSlot slot;
+        uint64_t sequence = AsAtomic(const_cast<uint64_t*>(&slots[i].sequence))->load(std::memory_order_acquire);
+        if (sequence == 0) {
+            continue;
+        }
+        memcpy(&slot, &slots[i], sizeof slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Skips a slot rewritten while it was copied.
+        if (AsAtomic(const_cast<uint64_t*>(&slots[i].sequence))->load(std::memory_order_relaxed) != sequence ||
+            slot.sequence != sequence) {
+            continue;
+        }
+        records->push_back(slot);
+    }
+    std::sort(records->begin(), records->end(), [](const RecordSlot& a, const RecordSlot& b) {
+        return a.sequence < b.sequence;
+    });
+    return true;
+}
+
+bool ReadFile(const std::string& path, std::vector<char>* contents) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        contents->insert(contents->end(), buffer, buffer + read);
+    }
+    fclose(file);
+    return true;
+}
+
+const char* KindName(uint16_t kind) {
+    switch (kind) {
+        case RN_RECORD_TO_NODE: return "toNode";
+        case RN_RECORD_TO_APP: return "toApp";
+        case RN_RECORD_LOG: return "log";
+        default: return "event";
+    }
+}
+
+// Same values as RNLogLevel.
+const char* LevelName(uint16_t level) {
+    switch (level) {
+        case 3: return "debug";
+        case 5: return "warn";
+        case 6: return "error";
+        default: return "info";
+    }
+}
+
+// getFlightRecording(previous): returns the records of this process'
+// recording, or of the previous process' one, or undefined if there's none.
+void Method_GetFlightRecording(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    bool previous = args.Length() > 0 && args[0]->IsTrue();
+    if (rn_bridge_data_dir() == nullptr) {
+        isolate->ThrowException(v8::Exception::Error(
+            v8::String::NewFromUtf8(isolate, "Data directory not set from native side").ToLocalChecked()
+        ));
+        return;
+    }
+
+    RecordingHeader header;
+    std::vector<RecordSlot> records;
+    RecordingHeader* current = recording.load(std::memory_order_acquire);
+    bool found = false;
+    if (!previous && current != nullptr) {
+        size_t size = sizeof(RecordingHeader) + current->slot_count * sizeof(RecordSlot);
+        found = ReadRecording((const char*)current, size, &header, &records);
+    } else if (previous) {
+        // Until the recorder is turned on, the previous recording is still
+        // in the recording file.
+        std::vector<char> contents;
+        std::string path = RecordingPath(current != nullptr ? RN_RECORDER_PREVIOUS_FILE : RN_RECORDER_FILE);
+        found = ReadFile(path, &contents) && ReadRecording(contents.data(), contents.size(), &header, &records);
+    }
+    if (!found) {
+        return;
+    }
+
+    auto key = [&](const char* name) {
+        return v8::String::NewFromUtf8(isolate, name).ToLocalChecked();
+    };
+    auto string = [&](const char* data, size_t length) {
+        return v8::String::NewFromUtf8(isolate, data, v8::NewStringType::kNormal, (int)length).ToLocalChecked();
+    };
+    v8::Local<v8::Array> entries = v8::Array::New(isolate, (int)records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        const RecordSlot& slot = records[i];
+        v8::Local<v8::Object> entry = v8::Object::New(isolate);
+        entry->Set(context, key("time"), v8::Number::New(isolate, slot.timestamp_us / 1000.0)).Check();
+        entry->Set(context, key("kind"), key(KindName(slot.kind))).Check();
+        if (slot.kind == RN_RECORD_TO_NODE || slot.kind == RN_RECORD_TO_APP) {
+            entry->Set(context, key("channel"), string(slot.channel, slot.channel_length)).Check();
+            entry->Set(context, key("size"), v8::Number::New(isolate, slot.size)).Check();
+            entry->Set(context, key("payload"), string(slot.data, slot.data_length)).Check();
+            if (slot.kind == RN_RECORD_TO_NODE) {
+                entry->Set(context, key("queuedMs"), v8::Number::New(isolate, slot.latency_us / 1000.0)).Check();
+            }
+        } else {
+            if (slot.kind == RN_RECORD_LOG) {
+                entry->Set(context, key("level"), key(LevelName(slot.level))).Check();
+            }
+            entry->Set(context, key("message"), string(slot.data, slot.data_length)).Check();
+        }
+        entries->Set(context, (uint32_t)i, entry).Check();
+    }
+    v8::Local<v8::Object> result = v8::Object::New(isolate);
+    result->Set(context, key("startedAt"), v8::Number::New(isolate, header.started_us / 1000.0)).Check();
+    result->Set(context, key("pid"), v8::Number::New(isolate, (double)header.pid)).Check();
+    result->Set(context, key("records"), entries).Check();
+    args.GetReturnValue().Set(result);
+}
+
+}  // namespace
+
+bool rn_recorder_configure(bool enabled, size_t size_bytes, size_t payload_bytes) {
+    std::lock_guard<std::mutex> lock(configureMutex);
+    payloadBytes = std::min<size_t>(payload_bytes, RN_RECORDER_MAX_PAYLOAD);
+    if (enabled && recording.load() == nullptr) {
+        RecordingHeader* header = CreateRecording(size_bytes);
+        if (header == nullptr) {
+            rn_recorder_active = false;
+            return false;
+        }
+        recording.store(header, std::memory_order_release);
+    }
+    rn_recorder_active = enabled;
+    return true;
+}
+
+uint64_t rn_recorder_now_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+void rn_recorder_message(RNRecordKind kind, const char* channel, const char* message, uint64_t latency_us) {
+    if (!rn_recorder_enabled()) {
+        return;
+    }
+    size_t size = strlen(message);
+    Record(kind, 0, channel, message, size, std::min(size, payloadBytes.load()), latency_us);
+}
+
+void rn_recorder_log(int level, const char* line, size_t length) {
+    if (!rn_recorder_enabled()) {
+        return;
+    }
+    Record(RN_RECORD_LOG, level, nullptr, line, length, length, 0);
+}
+
+void rn_recorder_event(const char* event) {
+    if (!rn_recorder_enabled()) {
+        return;
+    }
+    size_t length = strlen(event);
+    Record(RN_RECORD_EVENT, 0, nullptr, event, length, length, 0);
+}
+
+void rn_recorder_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "getFlightRecording", Method_GetFlightRecording);
+}
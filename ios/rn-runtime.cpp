@@ -0,0 +1,1012 @@
+#include "node.h"
+#include "node_version.h"
+#include "uv.h"
+#include "rn-allocator.h"
+#include "rn-bridge.h"
+#include "rn-recorder.h"
+#include "rn-runtime.h"
+#include "rn-streaming.h"
+#include "rn-threads.h"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__APPLE__)
+#include <TargetConditionals.h>
+#endif
+
+/**
+ * Node.js launcher built on the embedder API.
+ *
+ * node::Start can run only once per process. Here the process-wide
+ * initialization and the V8 platform are kept alive after the first start,
+ * and each start only creates (and at the end frees) a new isolate,
+ * event loop and Environment.
+ */
+
+namespace {
+
+// Same number of workers node::Start uses by default.
+const int kDefaultPlatformWorkerThreads = 4;
+// Delay of the messages to Node while in background mode.
+const int kDefaultBackgroundCoalescingMs = 1000;
+// V8 flags that configure the whole process and can't change once V8 runs.
+const char* const kProcessWideV8Flags[] = { "--jitless", "--lite-mode", "--single-threaded-gc", "--max-lazy" };
+
+// Must match the names used by scripts/build-startup-snapshot.js.
+#if defined(__ANDROID__) && defined(__arm__)
+const char* kSnapshotAbi = "armeabi-v7a";
+#elif defined(__ANDROID__) && defined(__aarch64__)
+const char* kSnapshotAbi = "arm64-v8a";
+#elif defined(__ANDROID__) && defined(__i386__)
+const char* kSnapshotAbi = "x86";
+#elif defined(__ANDROID__) && defined(__x86_64__)
+const char* kSnapshotAbi = "x86_64";
+#elif defined(__APPLE__) && TARGET_OS_SIMULATOR && defined(__aarch64__)
+const char* kSnapshotAbi = "ios-arm64-simulator";
+#elif defined(__APPLE__) && TARGET_OS_SIMULATOR
+const char* kSnapshotAbi = "ios-x64-simulator";
+#elif defined(__APPLE__)
+const char* kSnapshotAbi = "ios-arm64";
+#else
+const char* kSnapshotAbi = "unknown";
+#endif
+
+std::mutex runtimeMutex;
+bool processInitialized = false;
+std::unique_ptr<node::InitializationResult> initResult;
+std::unique_ptr<node::MultiIsolatePlatform> platform;
+bool runtimeRunning = false;
+// Set while the environment can be stopped from other threads.
+node::Environment* runningEnvironment = nullptr;
+v8::Isolate* runningIsolate = nullptr;
+std::string snapshotBlobPath;
+std::string snapshotProjectDir;
+// node::Start tears the process-wide state down when it returns.
+bool bootedFromSnapshot = false;
+bool streamEntryScript = false;
+bool backgroundModeEnabled = false;
+bool backgroundCollectGarbage = false;
+int backgroundCoalescingMs = kDefaultBackgroundCoalescingMs;
+// Whether the running environment is in background mode.
+bool inBackground = false;
+// The environments started by rn_runtime_start_environment, by name. The
+// environment is null until it can be stopped.
+std::map<std::string, node::Environment*> namedEnvironments;
+std::map<std::string, v8::Isolate*> namedIsolates;
+int platformWorkerThreads = kDefaultPlatformWorkerThreads;
+// The process-wide V8 flags of the first start.
+std::set<std::string> processV8Flags;
+
+// Heap limits of an environment's isolate, in MB, 0 for V8's default.
+struct HeapLimits {
+    size_t max_old_space_mb = 0;
+    size_t max_semi_space_mb = 0;
+};
+
+// An environment started by rn_runtime_prewarm bootstraps, then waits in its
+// start execution callback for the arguments given to rn_runtime_start.
+enum class PrewarmState { kNone, kBootstrapping, kWaiting, kStarted };
+PrewarmState prewarmState = PrewarmState::kNone;
+std::condition_variable prewarmCondition;
+bool prewarmCancelled = false;
+// Set when the options of rn_runtime_start can't apply to the pre-warmed
+// environment, which then exits and leaves its thread to a normal start.
+bool prewarmRestart = false;
+// Whether the pre-warmed environment uses the pooling allocator.
+bool prewarmPooled = false;
+std::vector<std::string> prewarmArgs;
+std::vector<std::string> prewarmExecArgs;
+HeapLimits prewarmHeap;
+int prewarmExitCode = 0;
+// Startup phases of the last rn_runtime_start, guarded by runtimeMutex.
+RNStartupTimes startupTimes = {};
+
+// Applies the arguments of rn_runtime_start to a pre-warmed environment,
+// which was bootstrapped without any: sets process.argv and
+// process.execArgv, loads the -r modules and returns the -e script, if any.
+// Other Node options given to rn_runtime_start don't apply to it.
+const char kApplyArgumentsSource[] =
+    "(function (process, require, args, execArgs) {\n"
+    "  const { Module } = require('internal/modules/cjs/loader');\n"
+    "  const preloads = [];\n"
+    "  let evalSource;\n"
+    "  for (let i = 0; i < execArgs.length; i++) {\n"
+    "    const arg = execArgs[i];\n"
+    "    if (arg === '-r' || arg === '--require') {\n"
+    "      preloads.push(execArgs[++i]);\n"
+    "    } else if (arg.startsWith('--require=')) {\n"
+    "      preloads.push(arg.slice('--require='.length));\n"
+    "    } else if (arg === '-e' || arg === '--eval') {\n"
+    "      evalSource = execArgs[++i];\n"
+    "    } else if (arg.startsWith('--eval=')) {\n"
+    "      evalSource = arg.slice('--eval='.length);\n"
+    "    }\n"
+    "  }\n"
+    "  process.argv = [process.argv[0]].concat(args.slice(1));\n"
+    "  process.execArgv = execArgs;\n"
+    "  if (preloads.length > 0) {\n"
+    "    Module._preloadModules(preloads);\n"
+    "  }\n"
+    "  return evalSource;\n"
+    "})";
+
+// Runs a -e script as Node's eval_string main does.
+const char kEvalSource[] =
+    "(function (require, source) {\n"
+    "  const { addBuiltinLibsToObject } = require('internal/modules/cjs/helpers');\n"
+    "  const { evalScript } = require('internal/process/execution');\n"
+    "  addBuiltinLibsToObject(globalThis, '<eval>');\n"
+    "  evalScript('[eval]', source, false, false);\n"
+    "})";
+
+void PrintErrors(const char* prefix, const std::vector<std::string>& errors) {
+    for (const std::string& error : errors) {
+        fprintf(stderr, "%s: %s\n", prefix, error.c_str());
+    }
+}
+
+// Takes the V8 options that mustn't be set as V8 flags on every start out
+// of the Node options of `args`: the heap limits, which only apply to the
+// environment's isolate, and the process-wide flags.
+void ExtractV8Options(std::vector<std::string>& args, HeapLimits* heap, std::set<std::string>* process_flags) {
+    size_t i = 1;
+    while (i < args.size() && args[i].size() > 1 && args[i][0] == '-' && args[i] != "--") {
+        size_t equals = args[i].find('=');
+        std::string name = args[i].substr(0, equals);
+        // V8 takes '_' and '-' alike in its flag names.
+        std::replace(name.begin(), name.end(), '_', '-');
+        bool has_value = equals != std::string::npos;
+        if (name == "--max-old-space-size" || name == "--max-semi-space-size") {
+            std::string value = has_value ? args[i].substr(equals + 1) : (i + 1 < args.size() ? args[i + 1] : "");
+            size_t mb = strtoul(value.c_str(), nullptr, 10);
+            if (name == "--max-old-space-size") {
+                heap->max_old_space_mb = mb;
+            } else {
+                heap->max_semi_space_mb = mb;
+            }
+            args.erase(args.begin() + i, args.begin() + std::min(args.size(), i + (has_value ? 1 : 2)));
+            continue;
+        }
+        if (!has_value && std::find(std::begin(kProcessWideV8Flags), std::end(kProcessWideV8Flags), name) != std::end(kProcessWideV8Flags)) {
+            process_flags->insert(name);
+            args.erase(args.begin() + i);
+            continue;
+        }
+        bool takes_value = !has_value && (name == "-r" || name == "--require" || name == "-e" ||
+                                          name == "--eval" || name == "-p" || name == "--print");
+        i += takes_value ? 2 : 1;
+    }
+}
+
+// Parses the arguments into Node's and the script's ones, and the heap
+// limits of the environment. Runs the process-wide initialization on the
+// first call, which also sets the process-wide V8 flags.
+bool ParseArguments(int argc, char* argv[], std::vector<std::string>& args, std::vector<std::string>& exec_args, HeapLimits* heap) {
+    std::set<std::string> v8_flags;
+    if (!processInitialized) {
+        // libuv may keep a pointer to argv for the process title.
+        argv = uv_setup_args(argc, argv);
+        args.assign(argv, argv + argc);
+        ExtractV8Options(args, heap, &v8_flags);
+        args.insert(args.begin() + 1, v8_flags.begin(), v8_flags.end());
+        processV8Flags = v8_flags;
+        initResult = node::InitializeOncePerProcess(args, {
+            node::ProcessInitializationFlags::kNoInitializeV8,
+            node::ProcessInitializationFlags::kNoInitializeNodeV8Platform
+        });
+        PrintErrors(args[0].c_str(), initResult->errors());
+        if (initResult->early_return()) {
+            return false;
+        }
+        args = initResult->args();
+        exec_args = initResult->exec_args();
+
+        platform = node::MultiIsolatePlatform::Create(platformWorkerThreads);
+        v8::V8::InitializePlatform(platform.get());
+        v8::V8::Initialize();
+        // The platform workers inherited this thread's name.
+        rn_threads_rename_inherited(RN_THREAD_PLATFORM);
+        rn_threads_start_uv_threadpool();
+        processInitialized = true;
+        if (startupTimes.started != 0) {
+            startupTimes.process_initialized = uv_hrtime();
+        }
+        return true;
+    }
+
+    // Later starts only parse the options again, so each environment can be
+    // started with its own script and options.
+    // V8 flags are process-wide, so only the Node options can change.
+    std::vector<std::string> errors;
+    args.assign(argv, argv + argc);
+    ExtractV8Options(args, heap, &v8_flags);
+    if (v8_flags != processV8Flags) {
+        std::string first;
+        for (const std::string& flag : processV8Flags) {
+            first += " " + flag;
+        }
+        fprintf(stderr, "The V8 flags of the first start (%s) apply to the whole process and can't change: ignoring the ones of this start.\n",
+                first.empty() ? "none" : first.c_str() + 1);
+    }
+    int exit_code = node::ProcessGlobalArgs(&args, &exec_args, &errors, node::kDisallowedInEnvvar);
+    PrintErrors(args[0].c_str(), errors);
+    return exit_code == 0;
+}
+
+bool ReadFile(const std::string& path, std::string& contents) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char buf[4096];
+    size_t length;
+    contents.clear();
+    while ((length = fread(buf, 1, sizeof(buf), file)) > 0) {
+        contents.append(buf, length);
+    }
+    fclose(file);
+    return true;
+}
+
+// Reads a string field of the flat JSON object written next to the blob.
+std::string JsonStringField(const std::string& json, const char* key) {
+    std::string quoted_key = std::string("\"") + key + "\"";
+    size_t position = json.find(quoted_key);
+    if (position == std::string::npos) {
+        return std::string();
+    }
+    size_t start = json.find('"', json.find(':', position + quoted_key.size()));
+    size_t end = json.find('"', start + 1);
+    if (start == std::string::npos || end == std::string::npos) {
+        return std::string();
+    }
+    return json.substr(start + 1, end - start - 1);
+}
+
+// FNV-1a, 64 bits, as hex. Only used to notice that the entry file changed.
+std::string HashContents(const std::string& contents) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : contents) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return std::string(hex);
+}
+
+// Checks that the registered snapshot was built for this Node.js version and
+// ABI, and from the current version of its entry file.
+bool SnapshotIsUsable() {
+    if (snapshotBlobPath.empty()) {
+        return false;
+    }
+    std::string metadata;
+    std::string entry;
+    FILE* blob = fopen(snapshotBlobPath.c_str(), "rb");
+    if (blob == nullptr) {
+        return false;
+    }
+    fclose(blob);
+    if (!ReadFile(snapshotBlobPath + ".json", metadata)) {
+        fprintf(stderr, "Startup snapshot metadata is missing, starting without the snapshot.\n");
+        return false;
+    }
+    if (JsonStringField(metadata, "nodeVersion") != NODE_VERSION_STRING ||
+        JsonStringField(metadata, "abi") != kSnapshotAbi) {
+        fprintf(stderr, "Startup snapshot was built for another Node.js version or ABI, starting without the snapshot.\n");
+        return false;
+    }
+    if (!ReadFile(snapshotProjectDir + "/" + JsonStringField(metadata, "entry"), entry) ||
+        JsonStringField(metadata, "entryHash") != HashContents(entry)) {
+        fprintf(stderr, "Startup snapshot is stale, starting without the snapshot.\n");
+        return false;
+    }
+    return true;
+}
+
+// Runs node::Start with `--snapshot-blob` inserted after argv[0]. libuv needs
+// the arguments in contiguous memory, which is kept for the process title.
+int StartFromSnapshot(int argc, char* argv[]) {
+    std::vector<std::string> args(argv, argv + argc);
+    args.insert(args.begin() + 1, "--snapshot-blob");
+    args.insert(args.begin() + 2, snapshotBlobPath);
+    size_t size = 0;
+    for (const std::string& arg : args) {
+        size += arg.size() + 1;
+    }
+    char* buffer = (char*)calloc(size, sizeof(char));
+    std::vector<char*> snapshot_argv;
+    char* position = buffer;
+    for (const std::string& arg : args) {
+        memcpy(position, arg.c_str(), arg.size() + 1);
+        snapshot_argv.push_back(position);
+        position += arg.size() + 1;
+    }
+    snapshot_argv.push_back(nullptr);
+    return node::Start((int)args.size(), snapshot_argv.data());
+}
+
+// Only a CommonJS file given as the main script is streamed, not -e scripts
+// or the REPL.
+bool HasStreamableEntry(const std::vector<std::string>& args, const std::vector<std::string>& exec_args) {
+    for (const std::string& arg : exec_args) {
+        if (arg == "-e" || arg == "--eval" || arg == "-p" || arg == "--print" ||
+            arg == "-i" || arg == "--interactive" || arg == "-c" || arg == "--check") {
+            return false;
+        }
+    }
+    if (args.size() < 2) {
+        return false;
+    }
+    const std::string& entry = args[1];
+    return entry.size() > 3 && entry.compare(entry.size() - 3, 3, ".js") == 0;
+}
+
+v8::Local<v8::Array> ToArray(v8::Isolate* isolate, const std::vector<std::string>& strings) {
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Array> array = v8::Array::New(isolate, (int)strings.size());
+    for (size_t i = 0; i < strings.size(); i++) {
+        array->Set(context, (uint32_t)i, v8::String::NewFromUtf8(isolate, strings[i].c_str()).ToLocalChecked()).Check();
+    }
+    return array;
+}
+
+// Compiles one of the function sources above and calls it.
+v8::MaybeLocal<v8::Value> CallSource(v8::Isolate* isolate, const char* source, int argc, v8::Local<v8::Value> argv[]) {
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Local<v8::Script> script;
+    v8::Local<v8::Value> function;
+    if (!v8::Script::Compile(context, v8::String::NewFromUtf8(isolate, source).ToLocalChecked()).ToLocal(&script) ||
+        !script->Run(context).ToLocal(&function)) {
+        return v8::MaybeLocal<v8::Value>();
+    }
+    return function.As<v8::Function>()->Call(context, v8::Undefined(isolate), argc, argv);
+}
+
+// Start execution callback of a pre-warmed environment. Everything up to
+// here ran before rn_runtime_start was called.
+v8::MaybeLocal<v8::Value> StartPrewarmedExecution(const node::StartExecutionCallbackInfo& info, RNStreamedScript** streamed) {
+    v8::Isolate* isolate = info.process_object->GetIsolate();
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+    bool stream_entry_script = false;
+    {
+        std::unique_lock<std::mutex> lock(runtimeMutex);
+        prewarmState = PrewarmState::kWaiting;
+        prewarmCondition.notify_all();
+        prewarmCondition.wait(lock, [] {
+            return prewarmState == PrewarmState::kStarted || prewarmCancelled;
+        });
+        if (prewarmState != PrewarmState::kStarted || prewarmRestart) {
+            // Stopped before being started, or started again normally.
+            return v8::MaybeLocal<v8::Value>();
+        }
+        args = prewarmArgs;
+        exec_args = prewarmExecArgs;
+        stream_entry_script = streamEntryScript && HasStreamableEntry(args, exec_args);
+    }
+
+    v8::EscapableHandleScope scope(isolate);
+    if (stream_entry_script) {
+        *streamed = rn_streaming_start(isolate, platform.get(), args[1].c_str());
+    }
+    v8::Local<v8::Value> apply_argv[] = {
+        info.process_object, info.native_require, ToArray(isolate, args), ToArray(isolate, exec_args)
+    };
+    v8::Local<v8::Value> eval_source;
+    if (!CallSource(isolate, kApplyArgumentsSource, 4, apply_argv).ToLocal(&eval_source)) {
+        return v8::MaybeLocal<v8::Value>();
+    }
+    if (eval_source->IsString()) {
+        v8::Local<v8::Value> eval_argv[] = { info.native_require, eval_source };
+        return scope.EscapeMaybe(CallSource(isolate, kEvalSource, 2, eval_argv));
+    }
+    return scope.EscapeMaybe(rn_streaming_run_main(*streamed, info));
+}
+
+// The isolate, event loop and Environment of a run, created and freed as
+// node::CommonEnvironmentSetup does, except that the isolate can use the
+// pooling ArrayBuffer allocator, which CommonEnvironmentSetup can't be given.
+class EnvironmentSetup {
+public:
+    static std::unique_ptr<EnvironmentSetup> Create(std::vector<std::string>* errors, const std::vector<std::string>& args, const std::vector<std::string>& exec_args, const HeapLimits& heap) {
+        std::unique_ptr<EnvironmentSetup> setup(new EnvironmentSetup());
+        if (uv_loop_init(&setup->loop) != 0) {
+            errors->push_back("Failed to initialize the event loop");
+            return nullptr;
+        }
+        setup->loop_initialized = true;
+
+        setup->allocator = rn_allocator_create();
+        if (!setup->allocator) {
+            setup->allocator = node::ArrayBufferAllocator::Create();
+        }
+        node::ArrayBufferAllocator* allocator = setup->allocator.get();
+        setup->isolate_ = NewIsolate(allocator, &setup->loop, heap);
+        if (setup->isolate_ == nullptr) {
+            errors->push_back("Failed to create the V8 isolate");
+            return nullptr;
+        }
+        v8::Locker locker(setup->isolate_);
+        v8::Isolate::Scope isolate_scope(setup->isolate_);
+        setup->isolate_data = node::CreateIsolateData(setup->isolate_, &setup->loop, platform.get(), allocator);
+        v8::HandleScope handle_scope(setup->isolate_);
+        v8::Local<v8::Context> context = node::NewContext(setup->isolate_);
+        if (context.IsEmpty()) {
+            errors->push_back("Failed to initialize V8 Context");
+            return nullptr;
+        }
+        setup->context_.Reset(setup->isolate_, context);
+        v8::Context::Scope context_scope(context);
+        setup->env_ = node::CreateEnvironment(setup->isolate_data, context, args, exec_args);
+        if (setup->env_ == nullptr) {
+            errors->push_back("Failed to create the Node environment");
+            return nullptr;
+        }
+        return setup;
+    };
+
+    ~EnvironmentSetup() {
+        if (this->isolate_ != nullptr) {
+            {
+                v8::Locker locker(this->isolate_);
+                v8::Isolate::Scope isolate_scope(this->isolate_);
+                this->context_.Reset();
+                if (this->env_ != nullptr) {
+                    node::FreeEnvironment(this->env_);
+                }
+                if (this->isolate_data != nullptr) {
+                    node::FreeIsolateData(this->isolate_data);
+                }
+            }
+            bool platform_finished = false;
+            platform->AddIsolateFinishedCallback(this->isolate_, [](void* data) {
+                *static_cast<bool*>(data) = true;
+            }, &platform_finished);
+            platform->UnregisterIsolate(this->isolate_);
+            this->isolate_->Dispose();
+            // The platform frees the isolate's resources on the loop.
+            while (!platform_finished) {
+                uv_run(&this->loop, UV_RUN_ONCE);
+            }
+        }
+        if (this->loop_initialized) {
+            uv_run(&this->loop, UV_RUN_NOWAIT);
+            if (uv_loop_close(&this->loop) != 0) {
+                fprintf(stderr, "Event loop closed with active handles\n");
+            }
+        }
+    };
+
+    uv_loop_t* event_loop() {
+        return &this->loop;
+    };
+
+    // node::NewIsolate, with the heap limits of the environment, which V8
+    // only takes from the create params of the isolate.
+    static v8::Isolate* NewIsolate(node::ArrayBufferAllocator* allocator, uv_loop_t* loop, const HeapLimits& heap) {
+        if (heap.max_old_space_mb == 0 && heap.max_semi_space_mb == 0) {
+            return node::NewIsolate(allocator, loop, platform.get());
+        }
+        v8::Isolate::CreateParams params;
+        params.array_buffer_allocator = allocator;
+        uint64_t total_memory = uv_get_total_memory();
+        uint64_t constrained_memory = uv_get_constrained_memory();
+        if (constrained_memory > 0 && constrained_memory < total_memory) {
+            total_memory = constrained_memory;
+        }
+        if (total_memory > 0) {
+            params.constraints.ConfigureDefaults(total_memory, 0);
+        }
+        if (heap.max_old_space_mb > 0) {
+            params.constraints.set_max_old_generation_size_in_bytes(heap.max_old_space_mb * 1024 * 1024);
+        }
+        if (heap.max_semi_space_mb > 0) {
+            // The young generation is two semi-spaces and a large object
+            // space of the same size.
+            params.constraints.set_max_young_generation_size_in_bytes(3 * heap.max_semi_space_mb * 1024 * 1024);
+        }
+        // The embedder fields of Node's objects.
+        params.embedder_wrapper_object_index = 1;
+        params.embedder_wrapper_type_index = INT_MAX;
+        v8::Isolate* isolate = v8::Isolate::Allocate();
+        if (isolate == nullptr) {
+            return nullptr;
+        }
+        platform->RegisterIsolate(isolate, loop);
+        v8::Isolate::Initialize(isolate, params);
+        node::SetIsolateUpForNode(isolate);
+        return isolate;
+    };
+
+    v8::Isolate* isolate() {
+        return this->isolate_;
+    };
+
+    node::Environment* env() {
+        return this->env_;
+    };
+
+    v8::Local<v8::Context> context() {
+        return this->context_.Get(this->isolate_);
+    };
+
+private:
+    uv_loop_t loop;
+    bool loop_initialized = false;
+    // The pooling allocator, or Node's when it isn't used.
+    std::unique_ptr<node::ArrayBufferAllocator> allocator;
+    v8::Isolate* isolate_ = nullptr;
+    node::IsolateData* isolate_data = nullptr;
+    v8::Global<v8::Context> context_;
+    node::Environment* env_ = nullptr;
+};
+
+// Creates an environment and runs it until it exits. A pre-warmed one waits
+// for the arguments of rn_runtime_start before loading the main script. A
+// named one is one of the environments of rn_runtime_start_environment.
+int RunEnvironment(const std::vector<std::string>& args, const std::vector<std::string>& exec_args, const HeapLimits& heap, bool stream_entry_script, bool prewarm, const std::string& name = std::string()) {
+    std::vector<std::string> errors;
+    std::string event = name.empty() ? "start" : "start|" + name;
+    rn_recorder_event(event.c_str());
+    std::unique_ptr<EnvironmentSetup> setup = EnvironmentSetup::Create(&errors, args, exec_args, heap);
+    if (!setup) {
+        PrintErrors(args[0].c_str(), errors);
+        return 1;
+    }
+    // Only the environment of rn_runtime_start reports its startup times.
+    bool timed = name.empty() && !prewarm;
+    if (timed) {
+        runtimeMutex.lock();
+        startupTimes.environment_created = uv_hrtime();
+        runtimeMutex.unlock();
+    }
+
+    int exit_code = 0;
+    v8::Isolate* isolate = setup->isolate();
+    node::Environment* env = setup->env();
+    {
+        v8::Locker locker(isolate);
+        v8::Isolate::Scope isolate_scope(isolate);
+        v8::HandleScope handle_scope(isolate);
+        v8::Context::Scope context_scope(setup->context());
+
+        // process.exit() would otherwise exit the whole application.
+        bool exit_called = false;
+        node::SetProcessExitHandler(env, [&](node::Environment* env, int code) {
+            exit_called = true;
+            exit_code = code;
+            node::Stop(env);
+        });
+
+        runtimeMutex.lock();
+        if (name.empty()) {
+            runningEnvironment = env;
+            runningIsolate = isolate;
+            if (prewarmState == PrewarmState::kStarted && prewarmCancelled) {
+                // Stopped while taking over the pre-warmed runtime's thread.
+                node::Stop(env);
+            }
+        } else {
+            namedEnvironments[name] = env;
+            namedIsolates[name] = isolate;
+            rn_bridge_set_namespace(isolate, name.c_str());
+        }
+        runtimeMutex.unlock();
+
+        // The entry script is read and compiled on a platform worker while
+        // this thread runs the rest of the bootstrap.
+        RNStreamedScript* streamed = nullptr;
+        node::StartExecutionCallback start_execution{};
+        if (prewarm) {
+            start_execution = [&streamed](const node::StartExecutionCallbackInfo& info) {
+                return StartPrewarmedExecution(info, &streamed);
+            };
+        } else if (stream_entry_script) {
+            streamed = rn_streaming_start(isolate, platform.get(), args[1].c_str());
+            if (streamed != nullptr) {
+                start_execution = [streamed](const node::StartExecutionCallbackInfo& info) {
+                    return rn_streaming_run_main(streamed, info);
+                };
+            }
+        }
+
+        // Runs the main script, the -e script or the REPL, as node::Start does.
+        bool loaded = !node::LoadEnvironment(env, start_execution).IsEmpty();
+        rn_streaming_finish(streamed);
+        if (timed) {
+            runtimeMutex.lock();
+            startupTimes.script_loaded = uv_hrtime();
+            runtimeMutex.unlock();
+        }
+        if (!loaded) {
+            exit_code = exit_called ? exit_code : 1;
+        } else {
+            int loop_exit_code = node::SpinEventLoop(env).FromMaybe(1);
+            exit_code = exit_called ? exit_code : loop_exit_code;
+        }
+
+        runtimeMutex.lock();
+        if (!name.empty()) {
+            namedEnvironments[name] = nullptr;
+            namedIsolates[name] = nullptr;
+        } else {
+            runningEnvironment = nullptr;
+            runningIsolate = nullptr;
+        }
+        if (name.empty() && inBackground) {
+            // The next environment starts in the foreground.
+            inBackground = false;
+            rn_bridge_set_coalescing_delay(0);
+        }
+        runtimeMutex.unlock();
+        rn_thread_set_background(false);
+
+        // The event loop is closed with the environment, so the bridge's
+        // handles on it are closed first and their close callbacks run.
+        rn_bridge_release_channels(isolate);
+        uv_run(setup->event_loop(), UV_RUN_NOWAIT);
+    }
+    setup.reset();
+    event = (name.empty() ? "exit|" : "exit|" + name + "|") + std::to_string(exit_code);
+    rn_recorder_event(event.c_str());
+    return exit_code;
+}
+
+// Interrupt callback of rn_runtime_memory_pressure, on the Node thread.
+void CollectAllGarbage(void*) {
+    runtimeMutex.lock();
+    // Pending interrupts also run while the environment is being freed.
+    bool running = runningEnvironment != nullptr;
+    runtimeMutex.unlock();
+    if (running) {
+        v8::Isolate::GetCurrent()->LowMemoryNotification();
+    }
+}
+
+// Interrupt callbacks of rn_runtime_set_background, on the Node thread.
+void EnterBackground(void*) {
+    runtimeMutex.lock();
+    bool running = runningEnvironment != nullptr;
+    bool collect_garbage = backgroundCollectGarbage;
+    runtimeMutex.unlock();
+    if (!running) {
+        return;
+    }
+    v8::Isolate* isolate = v8::Isolate::GetCurrent();
+    isolate->IsolateInBackgroundNotification();
+    if (collect_garbage) {
+        isolate->LowMemoryNotification();
+    }
+    rn_thread_set_background(true);
+}
+
+void LeaveBackground(void*) {
+    rn_thread_set_background(false);
+    runtimeMutex.lock();
+    bool running = runningEnvironment != nullptr;
+    runtimeMutex.unlock();
+    if (running) {
+        v8::Isolate::GetCurrent()->IsolateInForegroundNotification();
+    }
+}
+
+// Whether a start with these options can run in the pre-warmed environment,
+// which was bootstrapped without any, so only takes the -r and -e options.
+// Called with runtimeMutex locked.
+bool FitsPrewarmed(const std::vector<std::string>& args, const std::vector<std::string>& exec_args, const HeapLimits& heap) {
+    if (heap.max_old_space_mb != 0 || heap.max_semi_space_mb != 0 || rn_allocator_pooled() != prewarmPooled) {
+        return false;
+    }
+    // The entry script is only streamed while the bootstrap runs.
+    if (streamEntryScript && HasStreamableEntry(args, exec_args)) {
+        return false;
+    }
+    for (size_t i = 0; i < exec_args.size(); i++) {
+        const std::string& arg = exec_args[i];
+        if (arg == "-r" || arg == "--require" || arg == "-e" || arg == "--eval") {
+            i++;
+        } else if (arg.rfind("--require=", 0) != 0 && arg.rfind("--eval=", 0) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hands the arguments to the pre-warmed environment, or to its thread for a
+// normal start if they don't fit it, and waits for it to exit. Called with
+// runtimeMutex locked, which it unlocks.
+int StartPrewarmed(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+    HeapLimits heap;
+    if (!ParseArguments(argc, argv, args, exec_args, &heap)) {
+        runtimeMutex.unlock();
+        return 1;
+    }
+    prewarmArgs = args;
+    prewarmExecArgs = exec_args;
+    prewarmHeap = heap;
+    prewarmRestart = !FitsPrewarmed(args, exec_args, heap);
+    prewarmState = PrewarmState::kStarted;
+    prewarmCondition.notify_all();
+    std::unique_lock<std::mutex> lock(runtimeMutex, std::adopt_lock);
+    prewarmCondition.wait(lock, [] { return prewarmState != PrewarmState::kStarted; });
+    return prewarmExitCode;
+}
+
+}  // namespace
+
+void rn_runtime_set_platform_worker_threads(int count) {
+    runtimeMutex.lock();
+    if (processInitialized && count != platformWorkerThreads) {
+        fprintf(stderr, "The V8 platform is already running with %d worker threads.\n", platformWorkerThreads);
+    } else {
+        platformWorkerThreads = count;
+    }
+    runtimeMutex.unlock();
+}
+
+void rn_runtime_set_uv_threadpool_size(int size) {
+    // libuv reads it when the threadpool is first used.
+    char value[16];
+    snprintf(value, sizeof(value), "%d", size);
+    setenv("UV_THREADPOOL_SIZE", value, 1);
+}
+
+void rn_runtime_set_stream_entry_script(bool enabled) {
+    runtimeMutex.lock();
+    streamEntryScript = enabled;
+    runtimeMutex.unlock();
+}
+
+void rn_runtime_set_startup_snapshot(const char* blob_path, const char* project_dir) {
+    runtimeMutex.lock();
+    snapshotBlobPath = blob_path;
+    snapshotProjectDir = project_dir;
+    runtimeMutex.unlock();
+}
+
+int rn_runtime_prewarm() {
+    runtimeMutex.lock();
+    if (runtimeRunning || bootedFromSnapshot || (!processInitialized && SnapshotIsUsable())) {
+        // A usable snapshot is booted by the first start instead.
+        runtimeMutex.unlock();
+        return -1;
+    }
+    // Kept for the process title, like the arguments of a start.
+    static char placeholder[] = "node";
+    char* argv[] = { placeholder, nullptr };
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+    HeapLimits heap;
+    if (!ParseArguments(1, argv, args, exec_args, &heap)) {
+        runtimeMutex.unlock();
+        return 1;
+    }
+    runtimeRunning = true;
+    prewarmState = PrewarmState::kBootstrapping;
+    prewarmCancelled = false;
+    prewarmRestart = false;
+    prewarmPooled = rn_allocator_pooled();
+    runtimeMutex.unlock();
+
+    int exit_code = RunEnvironment(args, exec_args, heap, false, true);
+
+    runtimeMutex.lock();
+    if (prewarmRestart && !prewarmCancelled) {
+        args = prewarmArgs;
+        exec_args = prewarmExecArgs;
+        bool stream_entry_script = streamEntryScript && HasStreamableEntry(args, exec_args);
+        runtimeMutex.unlock();
+        exit_code = RunEnvironment(args, exec_args, prewarmHeap, stream_entry_script, false);
+        runtimeMutex.lock();
+    }
+    runtimeRunning = false;
+    prewarmState = PrewarmState::kNone;
+    prewarmExitCode = exit_code;
+    prewarmCondition.notify_all();
+    runtimeMutex.unlock();
+    return exit_code;
+}
+
+bool rn_runtime_is_prewarmed() {
+    runtimeMutex.lock();
+    bool prewarmed = prewarmState == PrewarmState::kBootstrapping || prewarmState == PrewarmState::kWaiting;
+    runtimeMutex.unlock();
+    return prewarmed;
+}
+
+int rn_runtime_start(int argc, char* argv[]) {
+    uint64_t started = uv_hrtime();
+    runtimeMutex.lock();
+    if (prewarmState == PrewarmState::kBootstrapping) {
+        // The options can only be parsed again once the bootstrap is done.
+        std::unique_lock<std::mutex> lock(runtimeMutex, std::adopt_lock);
+        prewarmCondition.wait(lock, [] { return prewarmState != PrewarmState::kBootstrapping; });
+        lock.release();
+    }
+    if (prewarmState == PrewarmState::kWaiting) {
+        startupTimes = {};
+        startupTimes.started = started;
+        return StartPrewarmed(argc, argv);
+    }
+    if (runtimeRunning) {
+        runtimeMutex.unlock();
+        fprintf(stderr, "Node.js is already running.\n");
+        return -1;
+    }
+    if (bootedFromSnapshot) {
+        runtimeMutex.unlock();
+        fprintf(stderr, "Node.js can't be restarted after booting from a startup snapshot.\n");
+        return -1;
+    }
+    startupTimes = {};
+    startupTimes.started = started;
+    if (!processInitialized && SnapshotIsUsable()) {
+        // Node 18 can only deserialize a user-land snapshot from node::Start.
+        bootedFromSnapshot = true;
+        runtimeRunning = true;
+        runtimeMutex.unlock();
+        int exit_code = StartFromSnapshot(argc, argv);
+        runtimeMutex.lock();
+        runtimeRunning = false;
+        runtimeMutex.unlock();
+        return exit_code;
+    }
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+    HeapLimits heap;
+    if (!ParseArguments(argc, argv, args, exec_args, &heap)) {
+        int exit_code = (initResult && initResult->exit_code() != 0) ? initResult->exit_code() : 1;
+        runtimeMutex.unlock();
+        return exit_code;
+    }
+    runtimeRunning = true;
+    bool stream_entry_script = streamEntryScript && HasStreamableEntry(args, exec_args);
+    runtimeMutex.unlock();
+
+    int exit_code = RunEnvironment(args, exec_args, heap, stream_entry_script, false);
+
+    runtimeMutex.lock();
+    runtimeRunning = false;
+    runtimeMutex.unlock();
+    return exit_code;
+}
+
+int rn_runtime_start_environment(const char* name, int argc, char* argv[]) {
+    std::string env_name(name);
+    if (env_name.empty() || env_name.find(RN_BRIDGE_NAMESPACE_SEPARATOR) != std::string::npos) {
+        fprintf(stderr, "Invalid Node.js environment name: \"%s\".\n", name);
+        return -1;
+    }
+    runtimeMutex.lock();
+    if (namedEnvironments.count(env_name) != 0) {
+        runtimeMutex.unlock();
+        fprintf(stderr, "The Node.js environment \"%s\" is already running.\n", name);
+        return -1;
+    }
+    if (bootedFromSnapshot) {
+        // node::Start owns the process-wide state and the platform.
+        runtimeMutex.unlock();
+        fprintf(stderr, "Node.js environments can't be started after booting from a startup snapshot.\n");
+        return -1;
+    }
+    std::vector<std::string> args;
+    std::vector<std::string> exec_args;
+    HeapLimits heap;
+    if (!ParseArguments(argc, argv, args, exec_args, &heap)) {
+        runtimeMutex.unlock();
+        return 1;
+    }
+    namedEnvironments[env_name] = nullptr;
+    runtimeMutex.unlock();
+
+    int exit_code = RunEnvironment(args, exec_args, heap, false, false, env_name);
+
+    runtimeMutex.lock();
+    namedEnvironments.erase(env_name);
+    namedIsolates.erase(env_name);
+    runtimeMutex.unlock();
+    return exit_code;
+}
+
+bool rn_runtime_stop_environment(const char* name) {
+    runtimeMutex.lock();
+    auto it = namedEnvironments.find(name);
+    bool stopped = it != namedEnvironments.end() && it->second != nullptr;
+    if (stopped) {
+        node::Stop(it->second);
+    }
+    runtimeMutex.unlock();
+    return stopped;
+}
+
+void rn_runtime_configure_background_mode(bool enabled, bool collect_garbage, int coalescing_ms) {
+    runtimeMutex.lock();
+    backgroundModeEnabled = enabled;
+    backgroundCollectGarbage = collect_garbage;
+    backgroundCoalescingMs = coalescing_ms >= 0 ? coalescing_ms : kDefaultBackgroundCoalescingMs;
+    runtimeMutex.unlock();
+}
+
+bool rn_runtime_set_background(bool background) {
+    runtimeMutex.lock();
+    bool changed = runningEnvironment != nullptr && background != inBackground &&
+        (backgroundModeEnabled || !background);
+    if (changed) {
+        inBackground = background;
+        rn_recorder_event(background ? "background" : "foreground");
+        rn_bridge_set_coalescing_delay(background ? (uint32_t)backgroundCoalescingMs : 0);
+        node::RequestInterrupt(runningEnvironment, background ? EnterBackground : LeaveBackground, nullptr);
+    }
+    runtimeMutex.unlock();
+    return changed;
+}
+
+bool rn_runtime_memory_pressure(RNMemoryPressureLevel level) {
+    rn_recorder_event(level == RN_MEMORY_PRESSURE_CRITICAL ? "memory-pressure|critical" : "memory-pressure|moderate");
+    // The ArrayBuffer memory kept for reuse is given back first.
+    rn_allocator_trim();
+    runtimeMutex.lock();
+    bool running = runningEnvironment != nullptr;
+    if (running) {
+        bool critical = level == RN_MEMORY_PRESSURE_CRITICAL;
+        // Can be called while the isolate runs JavaScript on its thread.
+        runningIsolate->MemoryPressureNotification(critical ?
+            v8::MemoryPressureLevel::kCritical : v8::MemoryPressureLevel::kModerate);
+        if (critical) {
+            node::RequestInterrupt(runningEnvironment, CollectAllGarbage, nullptr);
+        }
+        rn_bridge_notify("_SYSTEM_", critical ? "memory-pressure|critical" : "memory-pressure|moderate");
+    }
+    // The named environments are notified too, without the garbage
+    // collection, which they can run themselves on the event.
+    for (auto& entry : namedIsolates) {
+        if (entry.second == nullptr) {
+            continue;
+        }
+        bool critical = level == RN_MEMORY_PRESSURE_CRITICAL;
+        entry.second->MemoryPressureNotification(critical ?
+            v8::MemoryPressureLevel::kCritical : v8::MemoryPressureLevel::kModerate);
+        std::string system_channel = entry.first + RN_BRIDGE_NAMESPACE_SEPARATOR "_SYSTEM_";
+        rn_bridge_notify(system_channel.c_str(), critical ? "memory-pressure|critical" : "memory-pressure|moderate");
+        running = true;
+    }
+    runtimeMutex.unlock();
+    return running;
+}
+
+void rn_runtime_get_startup_times(RNStartupTimes* times) {
+    runtimeMutex.lock();
+    *times = startupTimes;
+    runtimeMutex.unlock();
+}
+
+bool rn_runtime_stop() {
+    runtimeMutex.lock();
+    bool stopped = runningEnvironment != nullptr;
+    if (stopped) {
+        node::Stop(runningEnvironment);
+    }
+    if (prewarmState == PrewarmState::kBootstrapping || prewarmState == PrewarmState::kWaiting ||
+        (prewarmState == PrewarmState::kStarted && !stopped)) {
+        // Not running any JavaScript yet, so node::Stop can't end it.
+        prewarmCancelled = true;
+        prewarmCondition.notify_all();
+        stopped = true;
+    }
+    runtimeMutex.unlock();
+    return stopped;
+}
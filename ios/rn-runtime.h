@@ -0,0 +1,108 @@
+#ifndef SRC_RN_RUNTIME_H_
+#define SRC_RN_RUNTIME_H_
+
+#include <cstdint>
+
+// Runs a Node.js environment on the calling thread and returns its exit code
+// once its event loop ends, process.exit() is called or rn_runtime_stop() is
+// called. The V8 platform and the process-wide state are set up by the first
+// call only, so later calls start a fresh environment in a few milliseconds.
+// Returns -1 without starting if an environment is already running.
+int rn_runtime_start(int argc, char* argv[]);
+
+// Creates an environment and runs the Node bootstrap on the calling thread
+// before any start, then waits for rn_runtime_start to give it its arguments
+// and keeps running it on this thread. rn_runtime_start returns its exit
+// code once it exits. It only takes the -r and -e Node options: when
+// rn_runtime_start is given others, heap limits, the entry script streaming
+// or another ArrayBuffer allocator, the environment exits instead and this
+// thread starts a new one as rn_runtime_start would. Returns -1 without
+// starting if an environment is running or a usable startup snapshot is
+// registered.
+int rn_runtime_prewarm();
+
+// Whether an environment started by rn_runtime_prewarm is waiting for, or
+// about to wait for, the arguments of rn_runtime_start.
+bool rn_runtime_is_prewarmed();
+
+// Registers a startup snapshot built by scripts/build-startup-snapshot.js.
+// The first start of the process boots from it when its metadata file
+// (`blob_path` + ".json") matches this build and the snapshot entry file
+// inside `project_dir` hasn't changed, and starts normally otherwise.
+// Booting from a snapshot goes through node::Start, so the runtime can't be
+// stopped or restarted in that process.
+void rn_runtime_set_startup_snapshot(const char* blob_path, const char* project_dir);
+
+// Sets the number of worker threads of the V8 platform, which is created by
+// the first start (or pre-warm) of the process and kept by the next ones.
+void rn_runtime_set_platform_worker_threads(int count);
+
+// Sets the number of libuv threadpool threads. libuv creates its threadpool
+// once per process, the first time it's used.
+void rn_runtime_set_uv_threadpool_size(int size);
+
+// Makes the next starts read and compile a `.js` entry script on a V8
+// platform worker while Node bootstraps, instead of on the Node thread after
+// the bootstrap. Meant for large single-file bundles.
+void rn_runtime_set_stream_entry_script(bool enabled);
+
+// Runs a named environment on the calling thread, next to the one started
+// by rn_runtime_start, and returns its exit code once it exits or
+// rn_runtime_stop_environment is called. Each named environment has its own
+// isolate, event loop and channels, shares the V8 platform and the libuv
+// threadpool, and runs the process-wide initialization if it's the first
+// environment of the process. Returns -1 without starting if the name is
+// empty or contains RN_BRIDGE_NAMESPACE_SEPARATOR, if an environment of
+// that name is running, or if the process booted from a startup snapshot.
+int rn_runtime_start_environment(const char* name, int argc, char* argv[]);
+
+// Stops the named environment. Can be called from any thread. Returns false
+// if no environment of that name is running.
+bool rn_runtime_stop_environment(const char* name);
+
+// Configures the background mode of the next starts. While the application
+// is in the background, V8 favours memory use over latency, the Node thread
+// runs at the background priority and messages to Node are coalesced for up
+// to `coalescing_ms` (a negative value keeps the default). With
+// `collect_garbage`, a full, compacting, garbage collection runs when the
+// application goes to the background.
+void rn_runtime_configure_background_mode(bool enabled, bool collect_garbage, int coalescing_ms);
+
+// Makes the running environment enter or leave the background mode, if it
+// was enabled. Leaving it restores the foreground latency right away. Can be
+// called from any thread. Returns false if the mode didn't change.
+bool rn_runtime_set_background(bool background);
+
+// Memory pressure levels reported by the OS.
+enum RNMemoryPressureLevel {
+    RN_MEMORY_PRESSURE_MODERATE = 1,
+    RN_MEMORY_PRESSURE_CRITICAL = 2
+};
+
+// Tells the running environment the system is low on memory. V8 is notified
+// right away. On critical pressure, a full garbage collection also runs on
+// the Node thread, between JavaScript tasks or while its event loop waits.
+// A "memory-pressure|<level>" message is sent on the system channel, so the
+// application can drop its caches. Named environments get the V8
+// notification and the message too. Can be called from any thread. Returns
+// false if no environment is running.
+bool rn_runtime_memory_pressure(RNMemoryPressureLevel level);
+
+// Stops the running environment. Can be called from any thread. Returns
+// false if no environment is running.
+bool rn_runtime_stop();
+
+// When the startup phases of the last rn_runtime_start ended, in uv_hrtime
+// nanoseconds. A phase that didn't run is 0: the process-wide
+// initialization only runs on the first start, and neither runs here when
+// starting a pre-warmed environment or booting from a startup snapshot.
+struct RNStartupTimes {
+    uint64_t started;
+    uint64_t process_initialized;
+    uint64_t environment_created;
+    // The main script, or the -e script, has run, up to its first await.
+    uint64_t script_loaded;
+};
+void rn_runtime_get_startup_times(RNStartupTimes* times);
+
+#endif
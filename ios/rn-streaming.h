@@ -0,0 +1,24 @@
+#ifndef SRC_RN_STREAMING_H_
+#define SRC_RN_STREAMING_H_
+
+#include "node.h"
+
+struct RNStreamedScript;
+
+// Starts reading and compiling a CommonJS entry script on a worker of
+// `platform`, while the calling thread keeps bootstrapping Node. Returns
+// nullptr if the file can't be opened, in which case the entry script is
+// left to Node.
+RNStreamedScript* rn_streaming_start(v8::Isolate* isolate, node::MultiIsolatePlatform* platform, const char* filename);
+
+// Start execution callback that runs the streamed script as the main module.
+// Waits for the streaming to end first. If it fails to compile, the main
+// module is loaded by Node as usual, so errors are reported the usual way,
+// which is also what it does when `script` is nullptr.
+v8::MaybeLocal<v8::Value> rn_streaming_run_main(RNStreamedScript* script, const node::StartExecutionCallbackInfo& info);
+
+// Waits for the streaming task and frees the script. Must be called before
+// the isolate is disposed, even if the start execution callback never ran.
+void rn_streaming_finish(RNStreamedScript* script);
+
+#endif
@@ -0,0 +1,590 @@
+#include "node.h"
+#include "uv.h"
+#include "rn-threads.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <dirent.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Per-thread CPU accounting.
+ *
+ * Reads the CPU time of every thread in the process and groups it by role,
+ * using the names given to the threads the plugin knows about. Threads that
+ * Node starts without naming them inherit the name of the Node main thread
+ * on Linux, so they are renamed where they are created: the V8 platform
+ * workers and the libuv threadpool, which the launcher starts right after
+ * the platform. Threads started later with the main thread's name, e.g.
+ * worker threads or the inspector's, are only classified as "other".
+ *
+ * Also holds the stack size, priority and CPU affinity configured for the
+ * threads the plugin starts, and the values they effectively got.
+ */
+
+namespace {
+
+struct ThreadSample {
+    uint64_t tid;
+    std::string name;
+    double user_ms;
+    double system_ms;
+};
+
+std::atomic<uint64_t> nodeMainTid(0);
+
+const char* kRoleNames[RN_THREAD_ROLE_COUNT] = { "node", "logForwarding", "bridge" };
+
+// Priorities from lowest to highest, with the nice value used on Linux and
+// the QoS class used on iOS for each.
+const int kPriorityCount = 5;
+const char* kPriorityNames[kPriorityCount] = {
+    "background", "utility", "default", "userInitiated", "userInteractive"
+};
+#if defined(__APPLE__)
+const qos_class_t kPriorityQosClasses[kPriorityCount] = {
+    QOS_CLASS_BACKGROUND, QOS_CLASS_UTILITY, QOS_CLASS_DEFAULT,
+    QOS_CLASS_USER_INITIATED, QOS_CLASS_USER_INTERACTIVE
+};
+// Secondary threads get 512KB by default on iOS, too little for Node.
+const size_t kDefaultNodeStackSize = 2 * 1024 * 1024;
+#else
+// The values of android.os.Process' THREAD_PRIORITY_BACKGROUND, DEFAULT,
+// FOREGROUND and DISPLAY, and one between BACKGROUND and DEFAULT.
+const int kPriorityNiceValues[kPriorityCount] = { 10, 5, 0, -2, -4 };
+const size_t kDefaultNodeStackSize = 0;
+#endif
+
+struct ThreadConfig {
+    size_t stack_size;
+    // Index in kPriorityNames, -1 to keep the priority threads start with.
+    int priority;
+    uint64_t affinity_mask;
+};
+
+struct EffectiveConfig {
+    bool recorded;
+    uint64_t tid;
+    size_t stack_size;
+#if defined(__APPLE__)
+    qos_class_t qos_class;
+#else
+    int nice;
+    uint64_t affinity_mask;
+#endif
+};
+
+std::mutex configMutex;
+ThreadConfig threadConfigs[RN_THREAD_ROLE_COUNT] = {
+    { kDefaultNodeStackSize, -1, 0 },
+    { 0, -1, 0 },
+    { 0, -1, 0 },
+};
+EffectiveConfig effectiveConfigs[RN_THREAD_ROLE_COUNT] = {};
+
+struct ThreadStart {
+    RNThreadRole role;
+    std::string name;
+    void* (*start)(void*);
+    void* arg;
+};
+std::mutex previousMutex;
+// CPU time of each thread at the previous call, to report deltas.
+std::map<uint64_t, double> previousCpuMs;
+uint64_t previousSampleMs = 0;
+
+uint64_t NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t CurrentThreadId() {
+#if defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(nullptr, &tid);
+    return tid;
+#else
+    return (uint64_t)syscall(SYS_gettid);
+#endif
+}
+
+const char* RoleForThread(const ThreadSample& sample) {
+    const std::string& name = sample.name;
+    if (name == RN_THREAD_NODE_MAIN) {
+        // Other threads carrying the name inherited it from the main thread.
+        uint64_t main_tid = nodeMainTid.load(std::memory_order_relaxed);
+        return main_tid == 0 || sample.tid == main_tid ? "node" : "other";
+    }
+    if (name == RN_THREAD_NODE_ENVIRONMENT) return "environments";
+    if (name == RN_THREAD_PLATFORM) return "v8Platform";
+    if (name == RN_THREAD_UV_POOL) return "libuvThreadpool";
+    if (name == RN_THREAD_STDOUT || name == RN_THREAD_STDERR || name == RN_THREAD_LOG_WRITER) return "logForwarding";
+    if (name == RN_THREAD_BRIDGE) return "bridge";
+    // Threads V8 names itself, e.g. the CPU profiler's sampling thread.
+    if (name.compare(0, 3, "v8:") == 0) return "v8Platform";
+    return "other";
+}
+
+#if defined(__APPLE__)
+
+std::vector<ThreadSample> SampleThreads() {
+    std::vector<ThreadSample> samples;
+    thread_act_array_t threads;
+    mach_msg_type_number_t count = 0;
+    if (task_threads(mach_task_self(), &threads, &count) != KERN_SUCCESS) {
+        return samples;
+    }
+    for (mach_msg_type_number_t i = 0; i < count; i++) {
+        thread_identifier_info_data_t id_info;
+        mach_msg_type_number_t id_count = THREAD_IDENTIFIER_INFO_COUNT;
+        thread_extended_info_data_t info;
+        mach_msg_type_number_t info_count = THREAD_EXTENDED_INFO_COUNT;
+        if (thread_info(threads[i], THREAD_IDENTIFIER_INFO, (thread_info_t)&id_info, &id_count) == KERN_SUCCESS &&
+            thread_info(threads[i], THREAD_EXTENDED_INFO, (thread_info_t)&info, &info_count) == KERN_SUCCESS) {
+            ThreadSample sample;
+            sample.tid = id_info.thread_id;
+            sample.name = info.pth_name;
+            sample.user_ms = info.pth_user_time / 1000000.0;
+            sample.system_ms = info.pth_system_time / 1000000.0;
+            samples.push_back(sample);
+        }
+        mach_port_deallocate(mach_task_self(), threads[i]);
+    }
+    vm_deallocate(mach_task_self(), (vm_address_t)threads, count * sizeof(thread_act_t));
+    return samples;
+}
+
+#else
+
+bool ReadThreadName(uint64_t tid, std::string& name) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/comm", (unsigned long long)tid);
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char buf[32] = {0};
+    bool ok = fgets(buf, sizeof(buf), file) != nullptr;
+    fclose(file);
+    if (ok) {
+        buf[strcspn(buf, "\n")] = 0;
+        name = buf;
+    }
+    return ok;
+}
+
+bool WriteThreadName(uint64_t tid, const char* name) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/comm", (unsigned long long)tid);
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fputs(name, file) >= 0;
+    return fclose(file) == 0 && ok;
+}
+
+bool ReadThreadCpu(uint64_t tid, double ticks_per_ms, double& user_ms, double& system_ms) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%llu/stat", (unsigned long long)tid);
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char buf[512];
+    size_t length = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[length] = 0;
+    // The thread name is in parentheses and may itself contain spaces or
+    // parentheses, so fields are counted from the last ')'.
+    char* fields = strrchr(buf, ')');
+    if (fields == nullptr) {
+        return false;
+    }
+    unsigned long long utime = 0, stime = 0;
+    // Fields 3 to 13 are skipped; utime and stime are fields 14 and 15.
+    if (sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+               &utime, &stime) != 2) {
+        return false;
+    }
+    user_ms = utime / ticks_per_ms;
+    system_ms = stime / ticks_per_ms;
+    return true;
+}
+
+std::vector<uint64_t> ListThreads() {
+    std::vector<uint64_t> tids;
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return tids;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] >= '0' && entry->d_name[0] <= '9') {
+            tids.push_back(strtoull(entry->d_name, nullptr, 10));
+        }
+    }
+    closedir(dir);
+    return tids;
+}
+
+std::vector<ThreadSample> SampleThreads() {
+    std::vector<ThreadSample> samples;
+    double ticks_per_ms = sysconf(_SC_CLK_TCK) / 1000.0;
+    for (uint64_t tid : ListThreads()) {
+        ThreadSample sample;
+        sample.tid = tid;
+        if (!ReadThreadName(tid, sample.name) ||
+            !ReadThreadCpu(tid, ticks_per_ms, sample.user_ms, sample.system_ms)) {
+            // The thread exited while being sampled.
+            continue;
+        }
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+#endif
+
+ThreadConfig ConfigForRole(RNThreadRole role) {
+    configMutex.lock();
+    ThreadConfig config = threadConfigs[role];
+    configMutex.unlock();
+    return config;
+}
+
+void* StartConfiguredThread(void* data) {
+    ThreadStart* thread_start = (ThreadStart*)data;
+    rn_thread_set_name(thread_start->name.c_str());
+    rn_thread_apply_config(thread_start->role);
+    void* (*start)(void*) = thread_start->start;
+    void* arg = thread_start->arg;
+    delete thread_start;
+    return start(arg);
+}
+
+void Method_GetThreadConfiguration(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    auto key = [&](const char* name) {
+        return v8::String::NewFromUtf8(isolate, name).ToLocalChecked();
+    };
+
+    configMutex.lock();
+    v8::Local<v8::Object> result = v8::Object::New(isolate);
+    for (int role = 0; role < RN_THREAD_ROLE_COUNT; role++) {
+        const EffectiveConfig& effective = effectiveConfigs[role];
+        if (!effective.recorded) {
+            // No thread of this role was started yet.
+            continue;
+        }
+        v8::Local<v8::Object> thread = v8::Object::New(isolate);
+        thread->Set(context, key("tid"), v8::Number::New(isolate, (double)effective.tid)).Check();
+        thread->Set(context, key("stackSizeKb"), v8::Number::New(isolate, (double)(effective.stack_size / 1024))).Check();
+#if defined(__APPLE__)
+        const char* priority = "unspecified";
+        for (int i = 0; i < kPriorityCount; i++) {
+            if (kPriorityQosClasses[i] == effective.qos_class) {
+                priority = kPriorityNames[i];
+            }
+        }
+        thread->Set(context, key("priority"), key(priority)).Check();
+        thread->Set(context, key("cpuAffinity"), v8::Null(isolate)).Check();
+#else
+        thread->Set(context, key("nice"), v8::Integer::New(isolate, effective.nice)).Check();
+        v8::Local<v8::Array> cpus = v8::Array::New(isolate);
+        uint32_t cpu_count = 0;
+        for (uint32_t cpu = 0; cpu < 64; cpu++) {
+            if (effective.affinity_mask & (1ULL << cpu)) {
+                cpus->Set(context, cpu_count++, v8::Integer::New(isolate, cpu)).Check();
+            }
+        }
+        thread->Set(context, key("cpuAffinity"), cpus).Check();
+#endif
+        result->Set(context, key(kRoleNames[role]), thread).Check();
+    }
+    configMutex.unlock();
+    args.GetReturnValue().Set(result);
+}
+
+void Method_GetThreadCpuUsage(const v8::FunctionCallbackInfo<v8::Value>& args) {
+    v8::Isolate* isolate = args.GetIsolate();
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    auto key = [&](const char* name) {
+        return v8::String::NewFromUtf8(isolate, name).ToLocalChecked();
+    };
+
+    std::vector<ThreadSample> samples = SampleThreads();
+    uint64_t now_ms = NowMs();
+
+    previousMutex.lock();
+    uint64_t interval_ms = previousSampleMs ? now_ms - previousSampleMs : 0;
+    std::map<uint64_t, double> current;
+    std::map<std::string, v8::Local<v8::Object>> roles;
+    v8::Local<v8::Array> threads = v8::Array::New(isolate);
+    uint32_t thread_index = 0;
+
+    for (const ThreadSample& sample : samples) {
+        double cpu_ms = sample.user_ms + sample.system_ms;
+        auto previous = previousCpuMs.find(sample.tid);
+        // Threads seen for the first time report their whole CPU time.
+        double delta_ms = previous != previousCpuMs.end() ? cpu_ms - previous->second : cpu_ms;
+        current[sample.tid] = cpu_ms;
+        const char* role = RoleForThread(sample);
+
+        v8::Local<v8::Object> group;
+        auto it = roles.find(role);
+        if (it == roles.end()) {
+            group = v8::Object::New(isolate);
+            group->Set(context, key("threads"), v8::Integer::New(isolate, 0)).Check();
+            group->Set(context, key("userMs"), v8::Number::New(isolate, 0)).Check();
+            group->Set(context, key("systemMs"), v8::Number::New(isolate, 0)).Check();
+            group->Set(context, key("deltaMs"), v8::Number::New(isolate, 0)).Check();
+            roles[role] = group;
+        } else {
+            group = it->second;
+        }
+        auto add = [&](const char* name, double value) {
+            double total = group->Get(context, key(name)).ToLocalChecked().As<v8::Number>()->Value();
+            group->Set(context, key(name), v8::Number::New(isolate, total + value)).Check();
+        };
+        add("threads", 1);
+        add("userMs", sample.user_ms);
+        add("systemMs", sample.system_ms);
+        add("deltaMs", delta_ms);
+
+        if (strcmp(role, "other") != 0) {
+            v8::Local<v8::Object> thread = v8::Object::New(isolate);
+            thread->Set(context, key("tid"), v8::Number::New(isolate, (double)sample.tid)).Check();
+            thread->Set(context, key("name"), key(sample.name.c_str())).Check();
+            thread->Set(context, key("role"), key(role)).Check();
+            thread->Set(context, key("userMs"), v8::Number::New(isolate, sample.user_ms)).Check();
+            thread->Set(context, key("systemMs"), v8::Number::New(isolate, sample.system_ms)).Check();
+            thread->Set(context, key("deltaMs"), v8::Number::New(isolate, delta_ms)).Check();
+            threads->Set(context, thread_index++, thread).Check();
+        }
+    }
+    previousCpuMs.swap(current);
+    previousSampleMs = now_ms;
+    previousMutex.unlock();
+
+    v8::Local<v8::Object> by_role = v8::Object::New(isolate);
+    for (const auto& entry : roles) {
+        by_role->Set(context, key(entry.first.c_str()), entry.second).Check();
+    }
+    v8::Local<v8::Object> result = v8::Object::New(isolate);
+    result->Set(context, key("intervalMs"), v8::Number::New(isolate, (double)interval_ms)).Check();
+    result->Set(context, key("roles"), by_role).Check();
+    result->Set(context, key("threads"), threads).Check();
+    args.GetReturnValue().Set(result);
+}
+
+}  // namespace
+
+void rn_thread_set_name(const char* name) {
+    char truncated[16];
+    strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = 0;
+#if defined(__APPLE__)
+    pthread_setname_np(truncated);
+#else
+    pthread_setname_np(pthread_self(), truncated);
+#endif
+    if (strcmp(name, RN_THREAD_NODE_MAIN) == 0) {
+        nodeMainTid.store(CurrentThreadId(), std::memory_order_relaxed);
+    }
+}
+
+void rn_threads_rename_inherited(const char* name) {
+#if !defined(__APPLE__)
+    // Darwin threads don't inherit their creator's name, so there is nothing
+    // to tell apart there.
+    uint64_t self = CurrentThreadId();
+    std::string own_name;
+    if (!ReadThreadName(self, own_name)) {
+        return;
+    }
+    for (uint64_t tid : ListThreads()) {
+        std::string thread_name;
+        if (tid != self && ReadThreadName(tid, thread_name) && thread_name == own_name) {
+            WriteThreadName(tid, name);
+        }
+    }
+#endif
+}
+
+void rn_threads_start_uv_threadpool() {
+#if !defined(__APPLE__)
+    // libuv starts all the threadpool's threads on the first work request,
+    // from the thread that queues it.
+    uv_loop_t loop;
+    if (uv_loop_init(&loop) != 0) {
+        return;
+    }
+    uv_work_t work;
+    uv_queue_work(&loop, &work, [](uv_work_t* req) {}, [](uv_work_t* req, int status) {});
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+    rn_threads_rename_inherited(RN_THREAD_UV_POOL);
+#endif
+}
+
+bool rn_threads_configure(const char* role, size_t stack_size_kb, const char* priority, uint64_t affinity_mask) {
+    int role_index = -1;
+    for (int i = 0; i < RN_THREAD_ROLE_COUNT; i++) {
+        if (strcmp(role, kRoleNames[i]) == 0) {
+            role_index = i;
+        }
+    }
+    int priority_index = -1;
+    for (int i = 0; i < kPriorityCount; i++) {
+        if (strcmp(priority, kPriorityNames[i]) == 0) {
+            priority_index = i;
+        }
+    }
+    if (role_index < 0 || (priority_index < 0 && priority[0] != 0)) {
+        return false;
+    }
+    configMutex.lock();
+    ThreadConfig& config = threadConfigs[role_index];
+    config.stack_size = stack_size_kb ? stack_size_kb * 1024 : (role_index == RN_THREAD_ROLE_NODE ? kDefaultNodeStackSize : 0);
+    config.priority = priority_index;
+    config.affinity_mask = affinity_mask;
+    configMutex.unlock();
+    return true;
+}
+
+int rn_thread_start(RNThreadRole role, const char* name, void* (*start)(void*), void* arg) {
+    ThreadConfig config = ConfigForRole(role);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (config.stack_size > 0) {
+        // Must be a multiple of the page size on Darwin.
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        pthread_attr_setstacksize(&attr, (config.stack_size + page_size - 1) / page_size * page_size);
+    }
+#if defined(__APPLE__)
+    if (config.priority >= 0) {
+        pthread_attr_set_qos_class_np(&attr, kPriorityQosClasses[config.priority], 0);
+    }
+#endif
+    ThreadStart* thread_start = new ThreadStart{ role, name, start, arg };
+    pthread_t thread;
+    int result = pthread_create(&thread, &attr, StartConfiguredThread, thread_start);
+    pthread_attr_destroy(&attr);
+    if (result != 0) {
+        delete thread_start;
+    }
+    return result;
+}
+
+void rn_thread_apply_config(RNThreadRole role) {
+    ThreadConfig config = ConfigForRole(role);
+    EffectiveConfig effective = {};
+    effective.recorded = true;
+    effective.tid = CurrentThreadId();
+#if defined(__APPLE__)
+    if (config.priority >= 0 && qos_class_self() != kPriorityQosClasses[config.priority]) {
+        pthread_set_qos_class_self_np(kPriorityQosClasses[config.priority], 0);
+    }
+    effective.stack_size = pthread_get_stacksize_np(pthread_self());
+    effective.qos_class = qos_class_self();
+#else
+    // On Linux, the nice value and the affinity are per thread.
+    if (config.priority >= 0) {
+        setpriority(PRIO_PROCESS, (id_t)effective.tid, kPriorityNiceValues[config.priority]);
+    }
+    cpu_set_t cpus;
+    if (config.affinity_mask != 0) {
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64; cpu++) {
+            if (config.affinity_mask & (1ULL << cpu)) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        sched_setaffinity(0, sizeof(cpus), &cpus);
+    }
+    // Read back, as the kernel may have refused or adjusted them.
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstacksize(&attr, &effective.stack_size);
+        pthread_attr_destroy(&attr);
+    }
+    effective.nice = getpriority(PRIO_PROCESS, (id_t)effective.tid);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+        for (int cpu = 0; cpu < 64; cpu++) {
+            if (CPU_ISSET(cpu, &cpus)) {
+                effective.affinity_mask |= 1ULL << cpu;
+            }
+        }
+    }
+#endif
+    configMutex.lock();
+    effectiveConfigs[role] = effective;
+    configMutex.unlock();
+}
+
+// The priority of the thread before rn_thread_set_background lowered it.
+thread_local bool threadInBackground = false;
+#if defined(__APPLE__)
+thread_local qos_class_t foregroundQosClass = QOS_CLASS_UNSPECIFIED;
+#else
+thread_local int foregroundNice = 0;
+#endif
+
+void rn_thread_set_background(bool background) {
+    if (background == threadInBackground) {
+        return;
+    }
+    threadInBackground = background;
+#if defined(__APPLE__)
+    if (background) {
+        foregroundQosClass = qos_class_self();
+        pthread_set_qos_class_self_np(kPriorityQosClasses[0], 0);
+    } else if (foregroundQosClass != QOS_CLASS_UNSPECIFIED) {
+        pthread_set_qos_class_self_np(foregroundQosClass, 0);
+    }
+#else
+    id_t tid = (id_t)CurrentThreadId();
+    if (background) {
+        foregroundNice = getpriority(PRIO_PROCESS, tid);
+        setpriority(PRIO_PROCESS, tid, kPriorityNiceValues[0]);
+    } else {
+        setpriority(PRIO_PROCESS, tid, foregroundNice);
+    }
+#endif
+}
+
+size_t rn_thread_stack_size(RNThreadRole role) {
+    return ConfigForRole(role).stack_size;
+}
+
+#if defined(__APPLE__)
+qos_class_t rn_thread_qos_class(RNThreadRole role, qos_class_t fallback) {
+    ThreadConfig config = ConfigForRole(role);
+    return config.priority >= 0 ? kPriorityQosClasses[config.priority] : fallback;
+}
+#endif
+
+void rn_threads_init(v8::Local<v8::Object> exports) {
+    NODE_SET_METHOD(exports, "getThreadCpuUsage", Method_GetThreadCpuUsage);
+    NODE_SET_METHOD(exports, "getThreadConfiguration", Method_GetThreadConfiguration);
+}
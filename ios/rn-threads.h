@@ -0,0 +1,72 @@
+#ifndef SRC_RN_THREADS_H_
+#define SRC_RN_THREADS_H_
+
+#include "node.h"
+
+// Names given to the threads the plugin creates or knows about. The CPU usage
+// sampler groups threads by role based on these names.
+#define RN_THREAD_NODE_MAIN "nodejs-main"
+#define RN_THREAD_NODE_ENVIRONMENT "nodejs-env"
+#define RN_THREAD_STDOUT "nodejs-stdout"
+#define RN_THREAD_STDERR "nodejs-stderr"
+#define RN_THREAD_LOG_WRITER "nodejs-log"
+#define RN_THREAD_BRIDGE "nodejs-bridge"
+#define RN_THREAD_PLATFORM "node-platform"
+#define RN_THREAD_UV_POOL "node-uv-pool"
+
+// Sets the name of the calling thread. Names longer than 15 characters are
+// truncated, as that is the limit on Linux.
+void rn_thread_set_name(const char* name);
+
+// On Linux, threads inherit the name of the thread that created them. Gives
+// `name` to every other thread that still carries the calling thread's name.
+void rn_threads_rename_inherited(const char* name);
+
+// Starts the libuv threadpool and names its threads. Call on a thread whose
+// name no other thread carries, before Node uses the threadpool. Only
+// names the threads on Linux, where they inherit their creator's name.
+void rn_threads_start_uv_threadpool();
+
+// Threads whose stack size, priority and CPU affinity can be configured.
+enum RNThreadRole {
+    RN_THREAD_ROLE_NODE = 0,
+    RN_THREAD_ROLE_LOG_FORWARDING,
+    RN_THREAD_ROLE_BRIDGE,
+    RN_THREAD_ROLE_COUNT
+};
+
+// Configures the threads of a role ("node", "logForwarding" or "bridge")
+// started after the call. `priority` is "background", "utility",
+// "default", "userInitiated" or "userInteractive", or empty to keep the
+// priority threads start with. A stack size or an affinity mask of 0 keeps
+// the default. CPU affinity isn't supported on iOS. Returns false for an
+// unknown role or priority.
+bool rn_threads_configure(const char* role, size_t stack_size_kb, const char* priority, uint64_t affinity_mask);
+
+// Starts a detached thread with the configured stack size of `role`, named
+// `name`, which applies the configuration of the role before calling
+// `start`. Returns 0 on success, like pthread_create.
+int rn_thread_start(RNThreadRole role, const char* name, void* (*start)(void*), void* arg);
+
+// Applies the configured priority and CPU affinity of `role` to the calling
+// thread and records its effective configuration. For the threads of a role
+// not started by rn_thread_start.
+void rn_thread_apply_config(RNThreadRole role);
+
+// Lowers the priority of the calling thread to the "background" priority,
+// or restores the priority it had before it was lowered.
+void rn_thread_set_background(bool background);
+
+// The configured stack size of `role` in bytes, 0 for the default.
+size_t rn_thread_stack_size(RNThreadRole role);
+
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+// The QoS class of the configured priority of `role`, or `fallback`.
+qos_class_t rn_thread_qos_class(RNThreadRole role, qos_class_t fallback);
+#endif
+
+// Registers the thread CPU usage methods on the rn_bridge binding.
+void rn_threads_init(v8::Local<v8::Object> exports);
+
+#endif
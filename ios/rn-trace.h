@@ -0,0 +1,38 @@
+#ifndef SRC_RN_TRACE_H_
+#define SRC_RN_TRACE_H_
+
+#include "node.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Bridge message lifecycle tracing. Events are recorded into per-thread
+// lock-free buffers and exported as Chrome trace-event JSON, which can be
+// opened with Perfetto or chrome://tracing.
+
+extern std::atomic<bool> rn_trace_active;
+
+inline bool rn_trace_enabled() {
+    return rn_trace_active.load(std::memory_order_relaxed);
+}
+
+void rn_trace_start();
+void rn_trace_stop();
+// Returns a new, process-wide unique trace id.
+uint64_t rn_trace_next_id();
+// Returns a pointer to a copy of `name` that stays valid for the life of the
+// process, since events only keep pointers to their strings. Past a limit
+// on the number of strings, new ones are all interned as "(other)".
+const char* rn_trace_intern(const std::string& name);
+// `phase` is a Chrome trace-event phase: 'B', 'E', 'i', 's', 't' or 'f'.
+// `name` and `channel` must be string literals or interned strings.
+void rn_trace_event(const char* name, char phase, uint64_t trace_id, const char* channel);
+// Writes all buffered events to `path`. Returns the number of events written,
+// or -1 on I/O errors.
+int rn_trace_export(const char* path);
+
+// Registers the tracing methods on the rn_bridge binding.
+void rn_trace_init(v8::Local<v8::Object> exports);
+
+#endif
@@ -10,6 +10,10 @@ module.exports = {
             name: '[NODEJS MOBILE] Copy Node.js Project files',
             path: './scripts/ios-copy-nodejs-project.sh',
             execution_position: 'after_compile'
+          }, {
+            name: '[NODEJS MOBILE] Build Startup Snapshot',
+            path: './scripts/ios-build-startup-snapshot.sh',
+            execution_position: 'after_compile'
           }, {
             name: '[NODEJS MOBILE] Build Native Modules',
             path: './scripts/ios-build-native-modules.sh',
@@ -0,0 +1,109 @@
+const fs = require('fs');
+const path = require('path');
+const {spawnSync} = require('child_process');
+
+// Builds the V8 startup snapshot of the nodejs-project for one ABI.
+//
+// A snapshot can only be deserialized by the same Node.js binary that built
+// it, so it can't be built by the host's node. The builder command given by
+// the application runs the nodejs-mobile binary for the target ABI (e.g. on a
+// device, an emulator or a simulator) and is called as:
+//   <builder> <abi> <entry file> <output blob>
+// It must run `node --snapshot-blob <output blob> --build-snapshot <entry file>`.
+//
+// Next to the blob, a metadata file lets the launcher detect a stale blob at
+// runtime and fall back to a normal start.
+
+const SNAPSHOT_ENTRY = 'snapshot.js';
+const BLOB_NAME = 'startup.blob';
+
+// FNV-1a, 64 bits, as hex. Must match HashContents in rn-runtime.cpp.
+function hashContents(buffer) {
+  let hash = 0xcbf29ce484222325n;
+  for (const byte of buffer) {
+    hash ^= BigInt(byte);
+    hash = (hash * 0x100000001b3n) & 0xffffffffffffffffn;
+  }
+  return hash.toString(16).padStart(16, '0');
+}
+
+function readNodeVersion(headersDir) {
+  const header = fs.readFileSync(
+    path.join(headersDir, 'node_version.h'),
+    'utf8',
+  );
+  const part = (name) =>
+    header.match(new RegExp('#define ' + name + ' (\\d+)'))[1];
+  return [
+    part('NODE_MAJOR_VERSION'),
+    part('NODE_MINOR_VERSION'),
+    part('NODE_PATCH_VERSION'),
+  ].join('.');
+}
+
+function buildSnapshot(abi, projectPath, headersDir, outputPath, builder) {
+  const entryPath = path.join(projectPath, SNAPSHOT_ENTRY);
+  const blobPath = path.join(outputPath, BLOB_NAME);
+  const metadataPath = blobPath + '.json';
+
+  if (!fs.existsSync(entryPath)) {
+    // Nothing to snapshot. Don't ship a blob left by a previous build.
+    console.log('No ' + SNAPSHOT_ENTRY + ' in the nodejs-project, skipping the startup snapshot.');
+    fs.rmSync(outputPath, {recursive: true, force: true});
+    return 0;
+  }
+
+  const metadata = {
+    nodeVersion: readNodeVersion(headersDir),
+    abi: abi,
+    entry: SNAPSHOT_ENTRY,
+    entryHash: hashContents(fs.readFileSync(entryPath)),
+  };
+
+  if (fs.existsSync(blobPath) && fs.existsSync(metadataPath)) {
+    const previous = JSON.parse(fs.readFileSync(metadataPath, 'utf8'));
+    if (
+      previous.nodeVersion === metadata.nodeVersion &&
+      previous.abi === metadata.abi &&
+      previous.entryHash === metadata.entryHash
+    ) {
+      console.log('Startup snapshot for ' + abi + ' is up to date.');
+      return 0;
+    }
+  }
+
+  fs.rmSync(outputPath, {recursive: true, force: true});
+  fs.mkdirSync(outputPath, {recursive: true});
+  console.log('Building the startup snapshot for ' + abi + '.');
+  const quote = (arg) => "'" + arg.replace(/'/g, "'\\''") + "'";
+  const command = [builder, quote(abi), quote(entryPath), quote(blobPath)];
+  const result = spawnSync(command.join(' '), {
+    cwd: projectPath,
+    shell: true,
+    stdio: 'inherit',
+  });
+  if (result.status !== 0 || !fs.existsSync(blobPath)) {
+    console.error('The startup snapshot builder failed for ' + abi + '.');
+    fs.rmSync(outputPath, {recursive: true, force: true});
+    return 1;
+  }
+  fs.writeFileSync(metadataPath, JSON.stringify(metadata, null, 2));
+  return 0;
+}
+
+if (process.argv.length >= 7) {
+  process.exit(
+    buildSnapshot(
+      process.argv[2],
+      path.normalize(process.argv[3]),
+      path.normalize(process.argv[4]),
+      path.normalize(process.argv[5]),
+      process.argv[6],
+    ),
+  );
+} else {
+  console.error(
+    'Usage: build-startup-snapshot.js <abi> <nodejs-project path> <node headers path> <output path> <builder command>',
+  );
+  process.exit(1);
+}
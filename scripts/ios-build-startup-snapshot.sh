@@ -0,0 +1,50 @@
+#!/bin/sh
+set -e
+
+if [ -f ./.xcode.env ]; then
+  source "./.xcode.env";
+fi
+if [ -f ./.xcode.env.local ]; then
+  source "./.xcode.env.local";
+fi
+
+NODEJS_ASSETS_DIR="$( cd "$PROJECT_DIR" && cd ../nodejs-assets/ && pwd )"
+
+if [ -z "$NODEJS_MOBILE_SNAPSHOT_BUILDER" ]; then
+# If the snapshot builder is not set, look for it in the project's
+#nodejs-assets/SNAPSHOT_BUILDER.txt file.
+PREFERENCE_FILE_PATH="$NODEJS_ASSETS_DIR/SNAPSHOT_BUILDER.txt"
+  if [ -f "$PREFERENCE_FILE_PATH" ]; then
+    NODEJS_MOBILE_SNAPSHOT_BUILDER="$(cat "$PREFERENCE_FILE_PATH")"
+  fi
+fi
+
+# This is our nodejs-project folder that was copied to the Xcode build folder
+NODEPROJ="$CODESIGNING_FOLDER_PATH/nodejs-project"
+SNAPSHOT_DIR="$CODESIGNING_FOLDER_PATH/nodejs-snapshot"
+
+if [ -z "$NODEJS_MOBILE_SNAPSHOT_BUILDER" ]; then
+  rm -rf "$SNAPSHOT_DIR"
+  exit 0
+fi
+
+# Must match the names in rn-runtime.cpp.
+if [ "$PLATFORM_NAME" == "iphoneos" ]; then
+  SNAPSHOT_ABI="ios-arm64"
+elif [ "$NATIVE_ARCH" == "arm64" ]; then
+  SNAPSHOT_ABI="ios-arm64-simulator"
+else
+  SNAPSHOT_ABI="ios-x64-simulator"
+fi
+
+# Built outside of the app bundle, so unchanged snapshots aren't rebuilt.
+SNAPSHOT_BUILD_DIR="$DERIVED_FILE_DIR/nodejs-snapshot-$SNAPSHOT_ABI"
+SCRIPTS_DIR="$( cd "$PROJECT_DIR" && cd ../node_modules/@comapeo/nodejs-mobile-react-native/scripts/ && pwd )"
+NODEJS_HEADERS_DIR="$( cd "$PROJECT_DIR" && cd ../node_modules/@comapeo/nodejs-mobile-react-native/ios/libnode/include/node/ && pwd )"
+
+node "$SCRIPTS_DIR"/build-startup-snapshot.js "$SNAPSHOT_ABI" "$NODEPROJ" "$NODEJS_HEADERS_DIR" "$SNAPSHOT_BUILD_DIR" "$NODEJS_MOBILE_SNAPSHOT_BUILDER"
+
+rm -rf "$SNAPSHOT_DIR"
+if [ -d "$SNAPSHOT_BUILD_DIR" ]; then
+  rsync --archive "$SNAPSHOT_BUILD_DIR/" "$SNAPSHOT_DIR"
+fi
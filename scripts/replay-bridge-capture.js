@@ -0,0 +1,229 @@
+const fs = require('fs');
+const path = require('path');
+const Module = require('module');
+const {performance} = require('perf_hooks');
+
+// Replays a bridge capture, written by nodejs.capture or
+// rn_bridge.app.capture, against the nodejs-project on a host, and reports
+// the throughput and latency of its message handling.
+//
+// The project runs in the host's node, with the rn_bridge binding replaced
+// by one that delivers the captured messages to Node to the registered
+// channels, either at their original pace or as fast as possible, and
+// counts the messages the project sends back. The latency of a message is
+// the time from when it was due until its JavaScript handlers returned:
+// with --fast, it's due when it's delivered. Messages are delivered with a
+// trace id, so the channels report when their handlers are done, through
+// the binding's traceEvent.
+//
+// Usage: replay-bridge-capture.js <capture file> <main script> [--fast]
+//   [--include-system] [--settle-ms <ms>]
+// Messages of the _SYSTEM_ channel, e.g. pause and resume, are skipped
+// unless --include-system is given.
+
+const CAPTURE_MAGIC = 'RNCAPTR1'; // Must match RN_CAPTURE_MAGIC in rn-capture.h.
+const TO_NODE = 0;
+const SYSTEM_CHANNEL = '_SYSTEM_';
+const BUILTIN_MODULES = path.join(__dirname, '..', 'install', 'resources', 'nodejs-modules', 'builtin_modules');
+
+function readCapture(file) {
+  const buffer = fs.readFileSync(file);
+  if (buffer.toString('latin1', 0, CAPTURE_MAGIC.length) !== CAPTURE_MAGIC) {
+    throw new Error(file + ' is not a bridge capture.');
+  }
+  let offset = CAPTURE_MAGIC.length;
+  const varint = () => {
+    let value = 0;
+    let scale = 1;
+    for (;;) {
+      if (offset >= buffer.length) {
+        throw new Error('Truncated capture.');
+      }
+      const byte = buffer[offset++];
+      value += (byte & 0x7f) * scale;
+      scale *= 128;
+      if ((byte & 0x80) === 0) {
+        return value;
+      }
+    }
+  };
+  const string = () => {
+    const length = varint();
+    const value = buffer.toString('utf8', offset, offset + length);
+    offset += length;
+    return value;
+  };
+
+  const channels = [];
+  const messages = [];
+  let timeUs = 0;
+  while (offset < buffer.length) {
+    const direction = varint();
+    timeUs += varint();
+    const index = varint();
+    if (index === channels.length) {
+      channels.push(string());
+    }
+    messages.push({direction, timeUs, channel: channels[index], message: string()});
+  }
+  return messages;
+}
+
+function percentile(sorted, fraction) {
+  if (sorted.length === 0) {
+    return 0;
+  }
+  return sorted[Math.min(sorted.length - 1, Math.ceil(fraction * sorted.length) - 1)];
+}
+
+function replay(captureFile, mainScript, options) {
+  const messages = readCapture(captureFile);
+  const toNode = messages.filter(
+    (entry) => entry.direction === TO_NODE && (options.includeSystem || entry.channel !== SYSTEM_CHANNEL),
+  );
+  const capturedToApp = messages.length - messages.filter((entry) => entry.direction === TO_NODE).length;
+
+  const listeners = new Map();
+  // Messages due before their channel was registered, delivered on
+  // registration like the native side does.
+  const waiting = new Map();
+  const latencies = [];
+  // Due times of the messages whose handlers haven't returned, by trace id.
+  const inFlight = new Map();
+  let nextTraceId = 1;
+  let sentToApp = 0;
+
+  const handled = (traceId) => {
+    if (inFlight.has(traceId)) {
+      latencies.push(performance.now() - inFlight.get(traceId));
+      inFlight.delete(traceId);
+    }
+  };
+
+  const deliver = (entry, dueMs) => {
+    const listener = listeners.get(entry.channel);
+    if (!listener) {
+      if (!waiting.has(entry.channel)) {
+        waiting.set(entry.channel, []);
+      }
+      waiting.get(entry.channel).push({entry, dueMs});
+      return;
+    }
+    const traceId = nextTraceId++;
+    inFlight.set(traceId, dueMs);
+    try {
+      listener(entry.channel, entry.message, traceId);
+    } catch (err) {
+      console.error('Listener of ' + entry.channel + ' threw:', err);
+    }
+    // Channels emit their events on setImmediate, so this runs after the
+    // handlers, for the channels that don't trace them.
+    setImmediate(() => handled(traceId));
+  };
+
+  const binding = {
+    registerChannel(name, listener) {
+      listeners.set(name, listener);
+      const queued = waiting.get(name) || [];
+      waiting.delete(name);
+      queued.forEach(({entry, dueMs}) => deliver(entry, dueMs));
+    },
+    sendMessage() {
+      sentToApp++;
+    },
+    traceEvent(name, phase, traceId) {
+      if (name === 'js handler' && phase === 'E') {
+        handled(traceId);
+      }
+    },
+    getDataDir() {
+      return options.dataDir;
+    },
+    getNamespace() {
+      return '';
+    },
+  };
+  // The other methods of the binding do nothing.
+  const fakeBinding = new Proxy(binding, {
+    get: (target, name) => (name in target ? target[name] : () => undefined),
+  });
+  const linkedBinding = process._linkedBinding;
+  process._linkedBinding = (name) => (name === 'rn_bridge' ? fakeBinding : linkedBinding.call(process, name));
+
+  // Resolves rn-bridge like the runtime does.
+  process.env.NODE_PATH = [BUILTIN_MODULES, process.env.NODE_PATH].filter(Boolean).join(path.delimiter);
+  Module._initPaths();
+  process.argv = [process.argv[0], mainScript];
+  require(mainScript);
+
+  const report = (durationMs) => {
+    const sorted = latencies.slice().sort((a, b) => a - b);
+    let unrouted = 0;
+    waiting.forEach((queued) => (unrouted += queued.length));
+    console.log('Messages delivered:  ' + latencies.length + (unrouted ? ' (' + unrouted + ' to unregistered channels)' : ''));
+    console.log('Duration:            ' + durationMs.toFixed(1) + ' ms');
+    console.log('Throughput:          ' + (latencies.length / (durationMs / 1000)).toFixed(1) + ' messages/s');
+    console.log(
+      'Latency (ms):        p50 ' + percentile(sorted, 0.5).toFixed(3) + '  p90 ' + percentile(sorted, 0.9).toFixed(3) +
+        '  p99 ' + percentile(sorted, 0.99).toFixed(3) + '  max ' + percentile(sorted, 1).toFixed(3),
+    );
+    console.log('Messages to the app: ' + sentToApp + ' (' + capturedToApp + ' in the capture)');
+  };
+
+  // Starts once the main script's synchronous setup is done.
+  setImmediate(() => {
+    const start = performance.now();
+    const firstUs = toNode.length > 0 ? toNode[0].timeUs : 0;
+    let next = 0;
+    const finish = () => {
+      const durationMs = performance.now() - start;
+      setTimeout(() => {
+        report(durationMs);
+        process.exit(0);
+      }, options.settleMs);
+    };
+    const dueMs = (entry) => start + (entry.timeUs - firstUs) / 1000;
+    const step = () => {
+      if (options.fast && next < toNode.length) {
+        deliver(toNode[next++], performance.now());
+        setImmediate(step);
+        return;
+      }
+      // Delivers every message already due in a loop, as bursts captured
+      // with the same timestamp can be long.
+      while (next < toNode.length && dueMs(toNode[next]) <= performance.now()) {
+        const entry = toNode[next++];
+        deliver(entry, dueMs(entry));
+      }
+      if (next >= toNode.length) {
+        finish();
+        return;
+      }
+      setTimeout(step, dueMs(toNode[next]) - performance.now());
+    };
+    step();
+  });
+}
+
+const args = process.argv.slice(2);
+const positional = [];
+const options = {fast: false, includeSystem: false, settleMs: 1000, dataDir: require('os').tmpdir()};
+for (let i = 0; i < args.length; i++) {
+  if (args[i] === '--fast') {
+    options.fast = true;
+  } else if (args[i] === '--include-system') {
+    options.includeSystem = true;
+  } else if (args[i] === '--settle-ms') {
+    options.settleMs = parseInt(args[++i], 10) || 0;
+  } else {
+    positional.push(args[i]);
+  }
+}
+if (positional.length === 2) {
+  replay(path.resolve(positional[0]), path.resolve(positional[1]), options);
+} else {
+  console.error(
+    'Usage: replay-bridge-capture.js <capture file> <main script> [--fast] [--include-system] [--settle-ms <ms>]',
+  );
+  process.exit(1);
+}